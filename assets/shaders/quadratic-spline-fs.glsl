@@ -1,7 +1,12 @@
 #version 450
 
+// Set per pipeline (see PipelineKey)
+layout(constant_id = 0) const int curveType = 1; // 0 - solid, 1 - quadratic
+layout(constant_id = 1) const int antialiasing = 1; // 0 - none, 1 - analytic, 2 - multisample
+
 layout(location = 0) in vec4 fragColor;
 layout(location = 1) in vec2 fragTexCoord;
+layout(location = 2) flat in float fragCurveSign;
 
 layout(location = 0) out vec4 outColor;
 
@@ -17,17 +22,32 @@ void main() {
     vec2 px = dFdx(fragTexCoord);
     vec2 py = dFdy(fragTexCoord);
 
-    // Chain rule
-    float fx = (2.0 * fragTexCoord.x) * px.x - px.y;
-    float fy = (2.0 * fragTexCoord.x) * py.x - py.y;
+    // Solid (interior) triangle, or any non-fringe triangle of the solid variant,
+    // checked after the derivatives to keep them in uniform control flow
+    if (fragCurveSign == 0.0 || (curveType == 0 && fragCurveSign != 2.0)) {
+        outColor = fragColor;
+        return;
+    }
 
-    // Signed distance  
+    float sd;
+    if (fragCurveSign == 2.0) {
+        // Edge fringe, u is the distance to the edge in outline units
+        sd = fragTexCoord.x / length(vec2(px.x, py.x));
+    } else {
+        // Chain rule
+        float fx = (2.0 * fragTexCoord.x) * px.x - px.y;
+        float fy = (2.0 * fragTexCoord.x) * py.x - py.y;
 
-    float sd = (fragTexCoord.x * fragTexCoord.x - fragTexCoord.y) / sqrt(fx * fx + fy * fy);  
+        // Signed distance  
+
+        sd = (fragTexCoord.x * fragTexCoord.x - fragTexCoord.y) / sqrt(fx * fx + fy * fy);  
+        // Concave curves fill the outer side
+        sd *= fragCurveSign;
+    }
 
 
-    // Linear alpha
-    float alpha = 0.5 - sd;
+    // Linear alpha, or a hard edge at the curve (per sample with multisampling)
+    float alpha = antialiasing == 1 ? 0.5 - sd : (sd <= 0.0 ? 1.0 : -1.0);
 
     if (alpha > 1.0) {
         // Inside
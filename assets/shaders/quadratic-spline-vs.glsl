@@ -1,14 +1,30 @@
 #version 450
 
-layout(location = 0) in vec4 inPosition;
+layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec4 inColor;
 layout(location = 2) in vec2 inTexCoord;
 
 layout(location = 0) out vec4 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) flat out float fragCurveSign;
+
+// Per frame (see ViewUniforms)
+layout(set = 0, binding = 0) uniform View {
+	mat4 transform;
+	vec2 viewportSize;
+} view;
+// Per draw (see Pipeline::Transform)
+layout(push_constant) uniform DrawTransform {
+	vec2 axisX;
+	vec2 axisY;
+	vec2 offset;
+} draw;
 
 void main() {
-	gl_Position = inPosition;
+	// z is not depth, it's the curve sign (see Triangulation::CurveSign)
+	vec2 position = draw.axisX * inPosition.x + draw.axisY * inPosition.y + draw.offset;
+	gl_Position = view.transform * vec4(position, 0.0, 1.0);
 	fragColor = inColor;
 	fragTexCoord = inTexCoord;
+	fragCurveSign = inPosition.z;
 }
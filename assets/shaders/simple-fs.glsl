@@ -1,10 +0,0 @@
-#version 450
-
-layout(location = 0) in vec4 fragColor;
-layout(location = 1) in vec2 fragTexCoord;
-
-layout(location = 0) out vec4 outColor;
-
-void main() {
-	outColor = fragColor;
-}
\ No newline at end of file
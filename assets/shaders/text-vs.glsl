@@ -0,0 +1,35 @@
+#version 450
+
+// CompactVertex
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec4 inColor;
+layout(location = 2) in ivec4 inCurve; // uv * 2, curve sign
+// Per instance (see TextRenderer::Instance)
+layout(location = 3) in vec2 inOffset;
+layout(location = 4) in vec2 inScale;
+layout(location = 5) in vec4 inInstanceColor;
+
+layout(location = 0) out vec4 fragColor;
+layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) flat out float fragCurveSign;
+
+// Per frame (see ViewUniforms)
+layout(set = 0, binding = 0) uniform View {
+	mat4 transform;
+	vec2 viewportSize;
+} view;
+// Per draw (see Pipeline::Transform)
+layout(push_constant) uniform DrawTransform {
+	vec2 axisX;
+	vec2 axisY;
+	vec2 offset;
+} draw;
+
+void main() {
+	vec2 instancePosition = inPosition * inScale + inOffset;
+	vec2 position = draw.axisX * instancePosition.x + draw.axisY * instancePosition.y + draw.offset;
+	gl_Position = view.transform * vec4(position, 0.0, 1.0);
+	fragColor = inColor * inInstanceColor;
+	fragTexCoord = vec2(inCurve.xy) * 0.5;
+	fragCurveSign = float(inCurve.z);
+}
@@ -0,0 +1,138 @@
+// GPU memory per glyph as Mesh::Vertex and as CompactVertex, for a set of glyph-like outlines
+// triangulated in Curves mode (like the app's glyphs) at a few pixel sizes
+#include "mesh.hpp"
+#include "vertex_format.hpp"
+#include "triangulation/outline.hpp"
+#include "triangulation/triangulator.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+	struct Glyph {
+		std::string name;
+		Triangulation::Outline outline;
+	};
+
+	// Unit box glyphs, [-1, 1] like the ones CompactVertex stores
+	Triangulation::Outline MakeRing(const float outerRadius, const float innerRadius)
+	{
+		Triangulation::Outline outline;
+		for (const auto radius : { outerRadius, innerRadius }) {
+			outline.MoveTo({ 0.0f, -radius });
+			outline.QuadTo({ radius, -radius }, { radius, 0.0f });
+			outline.QuadTo({ radius, radius }, { 0.0f, radius });
+			outline.QuadTo({ -radius, radius }, { -radius, 0.0f });
+			outline.QuadTo({ -radius, -radius }, { 0.0f, -radius });
+			outline.Close();
+		}
+		return outline;
+	}
+	Triangulation::Outline MakeHeart(const float size)
+	{
+		Triangulation::Outline outline;
+		const auto point = [size](const float x, const float y) { return glm::vec2{ x, y } * size; };
+		outline.MoveTo(point(0.0f, 1.0f));
+		outline.CubicTo(point(-0.6f, 0.4f), point(-1.2f, -0.2f), point(-0.9f, -0.7f));
+		outline.CubicTo(point(-0.6f, -1.2f), point(-0.1f, -1.0f), point(0.0f, -0.5f));
+		outline.CubicTo(point(0.1f, -1.0f), point(0.6f, -1.2f), point(0.9f, -0.7f));
+		outline.CubicTo(point(1.2f, -0.2f), point(0.6f, 0.4f), point(0.0f, 1.0f));
+		outline.Close();
+		return outline;
+	}
+	// Lines only, like the straight parts of "E" or "Z"
+	Triangulation::Outline MakeStar(const int pointCount, const float outerRadius, const float innerRadius)
+	{
+		Triangulation::Outline outline;
+		for (int i = 0; i < pointCount * 2; i++) {
+			const auto angle = static_cast<float>(i) * 3.14159265f / static_cast<float>(pointCount);
+			const auto radius = i % 2 ? innerRadius : outerRadius;
+			const glm::vec2 point = { std::sin(angle) * radius, -std::cos(angle) * radius };
+			if (i == 0)
+				outline.MoveTo(point);
+			else
+				outline.LineTo(point);
+		}
+		outline.Close();
+		return outline;
+	}
+	// Straight sides with quadratic corners, like "D" or "O" in most fonts
+	Triangulation::Outline MakeRoundedBox(const float halfSize, const float cornerRadius)
+	{
+		Triangulation::Outline outline;
+		const auto a = halfSize - cornerRadius;
+		outline.MoveTo({ -a, -halfSize });
+		outline.LineTo({ a, -halfSize });
+		outline.QuadTo({ halfSize, -halfSize }, { halfSize, -a });
+		outline.LineTo({ halfSize, a });
+		outline.QuadTo({ halfSize, halfSize }, { a, halfSize });
+		outline.LineTo({ -a, halfSize });
+		outline.QuadTo({ -halfSize, halfSize }, { -halfSize, a });
+		outline.LineTo({ -halfSize, -a });
+		outline.QuadTo({ -halfSize, -halfSize }, { -a, -halfSize });
+		outline.Close();
+		return outline;
+	}
+
+	std::vector<Glyph> MakeGlyphs()
+	{
+		return {
+			{ "ring", MakeRing(0.9f, 0.55f) },
+			{ "thin ring", MakeRing(0.9f, 0.8f) },
+			{ "heart", MakeHeart(0.7f) },
+			{ "star 5", MakeStar(5, 0.9f, 0.4f) },
+			{ "star 12", MakeStar(12, 0.9f, 0.7f) },
+			{ "rounded box", MakeRoundedBox(0.8f, 0.3f) }
+		};
+	}
+}
+
+int main()
+{
+	const auto glyphs = MakeGlyphs();
+	std::cout << std::fixed << std::setprecision(1);
+	for (const float pixelSize : { 16.0f, 64.0f, 256.0f }) {
+		// The unit box spans pixelSize pixels
+		const glm::mat3 transform = {
+			{ pixelSize * 0.5f, 0.0f, 0.0f },
+			{ 0.0f, pixelSize * 0.5f, 0.0f },
+			{ 0.0f, 0.0f, 1.0f }
+		};
+		Triangulation::Triangulator triangulator({ .mode = Triangulation::Triangulator::Mode::Curves, .transform = transform });
+		std::size_t vertexCount = 0, indexCount = 0, fullSize = 0, compactSize = 0;
+		std::chrono::steady_clock::duration conversionTime{};
+		std::vector<CompactVertex> compactVertices;
+		for (const auto &glyph : glyphs) {
+			Triangulation::Geometry geometry;
+			if (!triangulator.Triangulate(glyph.outline, geometry)) {
+				std::cerr << glyph.name << " failed to triangulate" << std::endl;
+				return 1;
+			}
+			const auto start = std::chrono::steady_clock::now();
+			if (!ConvertVertices(std::span(geometry.vertices), compactVertices)) {
+				std::cerr << glyph.name << " doesn't fit CompactVertex" << std::endl;
+				return 1;
+			}
+			conversionTime += std::chrono::steady_clock::now() - start;
+			vertexCount += geometry.vertices.size();
+			indexCount += geometry.indices.size();
+			fullSize += GetGeometrySize<Mesh::Vertex>(geometry);
+			compactSize += GetGeometrySize<CompactVertex>(geometry);
+		}
+
+		// Indices included, they are 16-bit in both formats
+		const auto glyphCount = static_cast<double>(glyphs.size());
+		std::cout << pixelSize << " px, " << glyphs.size() << " glyphs: "
+			<< static_cast<double>(vertexCount) / glyphCount << " vertices and "
+			<< static_cast<double>(indexCount) / glyphCount << " indices per glyph, "
+			<< static_cast<double>(fullSize) / glyphCount << " bytes per glyph as Mesh::Vertex, "
+			<< static_cast<double>(compactSize) / glyphCount << " as CompactVertex ("
+			<< 100.0 * static_cast<double>(compactSize) / static_cast<double>(fullSize) << "%), converted in "
+			<< std::chrono::duration<double, std::micro>(conversionTime).count() << " us" << std::endl;
+	}
+	return 0;
+}
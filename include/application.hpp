@@ -1,8 +1,12 @@
 #pragma once
 
 #include "my_types.hpp"
+#include <filesystem>
 
 namespace Application {
+	// Shaders are read from and the glyph bundle is kept in it, "../assets" (relative to bin) by default
+	void SetAssetDirectory(const std::filesystem::path &directory);
+
 	bool OnInitialize(const CorePtr core);
 	void OnDestroy(const CorePtr core);
 	bool OnFrame(const CorePtr core);
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "frame_pacer.hpp"
+#include "memory_allocator.hpp"
 #include "my_types.hpp"
 #ifdef __USE_WAYLAND__
 #include "xdg-shell.h"
@@ -11,9 +13,15 @@
 #include <Windows.h>
 #endif // __PLATFORM_WINDOWS__
 #include <vulkan/vulkan.h>
+#include <algorithm>
 #include <cstdint>
+#include <filesystem>
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <utility>
 #include <vector>
 
 class Core : public std::enable_shared_from_this<Core> {
@@ -46,6 +54,12 @@ public:
 			onClose = nullptr;
 		}
 	};
+	struct WlCallbackListenerWrapper {
+		std::function<void(wl_callback *callback, uint32_t time)> onDone;
+		~WlCallbackListenerWrapper() {
+			onDone = nullptr;
+		}
+	};
 	struct XdgPopupListenerWrapper {
 		std::function<void(xdg_popup *popup, int32_t x, int32_t y, int32_t width, int32_t height)> onConfigure;
 		~XdgPopupListenerWrapper() {
@@ -64,15 +78,60 @@ public:
 		}
 	};
 #endif
+	// One per swapchain image (or offscreen image when headless)
 	struct SwapchainResources {
-		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
 		VkImage image = VK_NULL_HANDLE;
 		VkImageView imageView = VK_NULL_HANDLE;
 		VkFramebuffer framebuffer = VK_NULL_HANDLE;
-		VkSemaphore startSemaphore = VK_NULL_HANDLE;
-		VkSemaphore endSemaphore = VK_NULL_HANDLE;
+		// Rendered into and resolved to image when the sample count is above 1
+		VkImage multisampleImage = VK_NULL_HANDLE;
+		VkImageView multisampleImageView = VK_NULL_HANDLE;
+		MemoryAllocator::Allocation multisampleMemory;
+		// Headless only, image is ours and its pixels are copied into the readback buffer at the end of the frame
+		MemoryAllocator::Allocation imageMemory;
+		VkBuffer readbackBuffer = VK_NULL_HANDLE;
+		MemoryAllocator::Allocation readbackMemory;
+		uint64_t readbackFrame = 0; // frame number + 1 waiting in the readback buffer, 0 if none
+		// Signaled by the submission that rendered the image, waited on by its present
+		VkSemaphore presentSemaphore = VK_NULL_HANDLE;
+	};
+	// Secondary command buffers of one recording thread, pools can't be used by two threads at once
+	struct ThreadCommandPool {
+		std::thread::id thread;
+		VkCommandPool commandPool = VK_NULL_HANDLE;
+		std::vector<VkCommandBuffer> commandBuffers; // reused from the front every frame
+		std::size_t usedCount = 0;
+	};
+	// One per frame in flight, reused once the GPU is done with the frame that used it last
+	struct FrameResources {
+		// Reset as a whole instead of buffer by buffer
+		VkCommandPool commandPool = VK_NULL_HANDLE;
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		VkSemaphore acquireSemaphore = VK_NULL_HANDLE;
 		VkFence fence = VK_NULL_HANDLE;
-		VkFence lastFence = VK_NULL_HANDLE;
+		// Transient arena, host visible and coherent, bump allocated and rewound when the frame comes round
+		VkBuffer transientBuffer = VK_NULL_HANDLE;
+		MemoryAllocator::Allocation transientMemory;
+		VkDeviceSize transientCapacity = 0;
+		VkDeviceSize transientOffset = 0;
+		// Arenas outgrown during the frame and buffers retired up to its submission (see RetireBuffer),
+		// the frame's commands and the uploads flushed ahead of it may still read them
+		std::vector<std::pair<VkBuffer, MemoryAllocator::Allocation>> retiredBuffers;
+		// Made the first time a thread records in this frame, kept for the following ones
+		std::vector<std::unique_ptr<ThreadCommandPool>> threadCommandPools;
+	};
+	// Part of the current frame's transient arena, valid until the frame is done on the GPU
+	struct TransientAllocation {
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceSize offset = 0;
+		uint8_t *mapped = nullptr; // at offset
+	};
+	static constexpr uint32_t maxFramesInFlight = 4;
+	// How frames reach the screen, picked among the present modes the surface supports
+	enum class PresentPolicy : uint8_t {
+		LowLatency, // MAILBOX (the newest frame replaces a queued one), else IMMEDIATE (may tear), else FIFO
+		Vsync, // FIFO with one image above the minimum
+		PowerSaver // FIFO with the fewest images
 	};
 
 public:
@@ -90,13 +149,37 @@ public:
 			return nullptr;
 		return ptr;
 	}
+	// No window, surface or swapchain, frames are rendered into offscreen images and read back (see SetOnReadbackCallback).
+	// One image per frame in flight, so the readback of a frame waits until frameCount - 1 later frames are recorded
+	static CorePtr CreateHeadless(const uint32_t width, const uint32_t height, const uint32_t frameCount = 3) {
+		auto ptr = std::make_unique<Core>(Private());
+		ptr->isHeadless = true;
+		ptr->width = width;
+		ptr->height = height;
+		ptr->vkFramesInFlight = std::clamp(frameCount, 1u, maxFramesInFlight);
+		if (!ptr->Init())
+			return nullptr;
+		return ptr;
+	}
 
+	// Headless: renders frames back to back until RequestClose, then delivers the remaining readbacks
 	void Run();
+	void RequestClose() { isGoingToClose = true; }
+	// Wayland draws a frame only after this (or a resize), and no faster than the compositor asks for frames,
+	// so a still window costs nothing. Call it from onFrameCallback to animate
+	void RequestRedraw() { isDirty = true; }
+#ifdef __USE_WAYLAND__
+	// Polled along with the display, the callback runs on the thread in Run when poll reports any of events for fd.
+	// A second watch of the same fd replaces the first one
+	void AddFdWatch(const int fd, const short events, OnFdEventType callback);
+	void RemoveFdWatch(const int fd);
+#endif // __USE_WAYLAND__
 
 	void SetOnInitCallback(OnInitType callback) { onInitCallback = callback; }
 	void SetOnDestroyCallback(OnDestroyType callback) { onDestroyCallback = callback; }
 	void SetOnResizeCallback(OnResizeType callback) { onResizeCallback = callback; }
 	void SetOnFrameCallback(OnFrameType callback) { onFrameCallback = callback; }
+	void SetOnReadbackCallback(OnReadbackType callback) { onReadbackCallback = callback; }
 
 	VkInstance GetVulkanInstance() const { return vkInstance; }
 	VkPhysicalDevice GetVulkanPhysicalDevice() const { return vkPhysicalDevice; }
@@ -107,27 +190,103 @@ public:
 	VkCommandPool GetVulkanCommandPool() const { return vkCommandPool; }
 	VkSwapchainKHR GetVulkanSwapchain() const { return vkSwapchain; }
 	VkRenderPass GetVulkanRenderPass() const { return vkRenderPass; }
+	// Format of the swapchain images, or of the offscreen images (VK_FORMAT_R8G8B8A8_UNORM) when headless
+	VkFormat GetVulkanColorFormat() const { return vkSwapchainFormat; }
+	PresentPolicy GetPresentPolicy() const { return presentPolicy; }
+	// Recreates the swapchain if there is one already
+	bool SetPresentPolicy(const PresentPolicy policy);
+	VkPresentModeKHR GetVulkanPresentMode() const { return vkPresentMode; }
+	// Queried with every swapchain creation, empty when headless
+	const std::vector<VkPresentModeKHR>& GetVulkanSupportedPresentModes() const { return vkSupportedPresentModes; }
+	// Delays the start of frames while the present mode is FIFO, FIFO frames queue up and add latency otherwise
+	FramePacer& GetFramePacer() { return framePacer; }
+	// Samples of the render pass, pipelines have to be made with the same count (PipelineKey::samples)
+	VkSampleCountFlagBits GetVulkanSampleCount() const { return vkSampleCount; }
+	// MSAA for pipelines that don't use analytic antialiasing, lowered to what the device supports.
+	// Recreates the render pass, so call before pipelines are made (or make them again)
+	bool SetVulkanSampleCount(const VkSampleCountFlagBits sampleCount);
+	// Shared by every pipeline, Vulkan synchronizes it internally so pipelines can be created from any thread
+	VkPipelineCache GetVulkanPipelineCache() const { return vkPipelineCache; }
+	const VkPhysicalDeviceFeatures& GetVulkanEnabledFeatures() const { return vkEnabledFeatures; }
+	// limits.maxDrawIndexedIndexValue accounts for fullDrawIndexUint32 being enabled
+	const VkPhysicalDeviceProperties& GetVulkanPhysicalDeviceProperties() const { return vkPhysicalDeviceProperties; }
+	// VK_EXT_index_type_uint8
+	bool IsIndexTypeUint8Enabled() const { return isIndexTypeUint8Enabled; }
+	MemoryAllocatorPtr GetMemoryAllocator() const { return memoryAllocator; }
+	StagingBufferPtr GetStagingBuffer() const { return stagingBuffer; }
+	// Camera of the frame, set its transform to pan and zoom
+	ViewUniformsPtr GetViewUniforms() const { return viewUniforms; }
 	std::vector<SwapchainResources>& GetVulkanSwapchainResources() { return vkSwapchainResources; }
-	VkCommandBuffer GetVulkanCurrentFrameCommandBuffer() const { return vkSwapchainResources[vkNextFrame].commandBuffer; }
-	VkImage GetVulkanCurrentFrameImage() const { return vkSwapchainResources[vkNextFrame].image; }
-	VkImageView GetVulkanCurrentFrameImageView() const { return vkSwapchainResources[vkNextFrame].imageView; }
-	VkFramebuffer GetVulkanCurrentFrameFramebuffer() const { return vkSwapchainResources[vkNextFrame].framebuffer; }
-	VkSemaphore GetVulkanCurrentFrameStartSemaphore() const { return vkSwapchainResources[vkNextFrame].startSemaphore; }
-	VkSemaphore GetVulkanCurrentFrameEndSemaphore() const { return vkSwapchainResources[vkNextFrame].endSemaphore; }
-	VkFence GetVulkanCurrentFrameFence() const { return vkSwapchainResources[vkNextFrame].fence; }
-	VkFence GetVulkanCurrentFrameLastFence() const { return vkSwapchainResources[vkNextFrame].lastFence; }
+	std::vector<FrameResources>& GetVulkanFrameResources() { return vkFrames; }
+	// Frames the CPU may record ahead of the GPU, 2 by default. More hides CPU spikes, fewer cuts input latency
+	uint32_t GetVulkanFramesInFlight() const { return vkFramesInFlight; }
+	// Clamped to [1, maxFramesInFlight], waits for the device. Per-frame resources of others (see GetVulkanCurrentFrameIndex) have to follow
+	bool SetVulkanFramesInFlight(const uint32_t framesInFlight);
+	// Index of the frame in flight, below GetVulkanFramesInFlight.
+	// Resources indexed by it are no longer used by the GPU once onFrameCallback is called
+	uint32_t GetVulkanCurrentFrameIndex() const { return vkCurrentFrame; }
+	// The primary buffer of the frame, or the secondary one the calling thread is recording (see BeginSecondaryCommandBuffer)
+	VkCommandBuffer GetVulkanCurrentFrameCommandBuffer() const;
+	VkFence GetVulkanCurrentFrameFence() const { return vkFrames[vkCurrentFrame].fence; }
+	// The image acquired for the current frame
+	uint32_t GetVulkanCurrentImageIndex() const { return vkImageIndex; }
+	VkImage GetVulkanCurrentFrameImage() const { return vkSwapchainResources[vkImageIndex].image; }
+	VkImageView GetVulkanCurrentFrameImageView() const { return vkSwapchainResources[vkImageIndex].imageView; }
+	VkFramebuffer GetVulkanCurrentFrameFramebuffer() const { return vkSwapchainResources[vkImageIndex].framebuffer; }
+	// Per-frame upload space (instances, indirect commands, small uniforms) without a staging copy.
+	// Only valid while recording the current frame, the memory is reused framesInFlight frames later
+	// Thread safe
+	bool AllocateTransient(const VkDeviceSize size, const VkDeviceSize alignment, TransientAllocation &allocation);
+	// Destroys the buffer once the next submitted frame is done, by then the frames in flight and the uploads
+	// recorded so far (flushed ahead of that frame) are done with it too. For buffers frames may draw from (Mesh, MeshAtlas).
+	// Thread safe
+	void RetireBuffer(VkBuffer buffer, MemoryAllocator::Allocation allocation);
+
+	// Parallel recording, from any thread while onFrameCallback runs (and the callback waits for them).
+	// Begins a secondary buffer from the calling thread's pool of the current frame that continues the render pass,
+	// which has to be begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS. Until it's ended it's what
+	// GetVulkanCurrentFrameCommandBuffer returns on this thread, so Pipeline, Mesh, MeshAtlas and TextRenderer record into it.
+	// Secondary buffers don't inherit state, bind the pipeline in each of them. VK_NULL_HANDLE on failure
+	VkCommandBuffer BeginSecondaryCommandBuffer();
+	bool EndSecondaryCommandBuffer(const VkCommandBuffer commandBuffer);
+	// On the thread recording the frame, inside the render pass, in the given order
+	void ExecuteSecondaryCommandBuffers(std::span<const VkCommandBuffer> commandBuffers) const;
 	uint32_t GetWidth() const { return width; }
 	uint32_t GetHeight() const { return height; }
 
+	// Writes the pipeline cache to disk, done after onInitCallback and on destruction
+	bool SaveVulkanPipelineCache() const;
+	// "pipeline.cache" in the working directory by default. What's stored at the new path is merged into the cache
+	// (call it before onInitCallback makes the pipelines), and saves go there from now on
+	bool SetVulkanPipelineCachePath(const std::filesystem::path &path);
+	const std::filesystem::path& GetVulkanPipelineCachePath() const { return vkPipelineCachePath; }
+
+	bool IsHeadless() const { return isHeadless; }
+	// Headless: waits for every frame in flight and hands their pixels to onReadbackCallback in frame order
+	bool WaitForReadbacks();
+
 private:
 	bool Init();
 	bool Render();
+	bool RenderHeadless();
+	void DeliverReadback(SwapchainResources &swapchainResource);
 	bool OnResize();
 	void OnDestroy();
 
 #ifdef __USE_WAYLAND__
 	// Wayland
+	struct FdWatch {
+		int fd = -1;
+		short events = 0;
+		OnFdEventType callback;
+	};
+
 	bool InitWaylandWindow();
+	// Sleeps in poll until the display or a watched fd has something, or returns right away if a frame is due
+	bool DispatchWaylandEvents();
+	// Asks for the next frame callback, committed by the present that follows
+	void RequestWaylandFrame();
+	void CancelWaylandFrame();
 
 	wl_display *wlDisplay = nullptr;
 	wl_registry *wlRegistry = nullptr;
@@ -140,6 +299,9 @@ private:
 	std::unique_ptr<Core::XdgWmBaseListenerWrapper> xdgWmBaseListenerWrapper = std::make_unique<Core::XdgWmBaseListenerWrapper>();
 	std::unique_ptr<Core::XdgSurfaceListenerWrapper> xdgSurfaceListenerWrapper = std::make_unique<Core::XdgSurfaceListenerWrapper>();
 	std::unique_ptr<Core::XdgToplevelListenerWrapper> xdgToplevelListenerWrapper = std::make_unique<Core::XdgToplevelListenerWrapper>();
+	wl_callback *wlFrameCallback = nullptr; // the frame presented last is still waiting for the compositor
+	std::unique_ptr<Core::WlCallbackListenerWrapper> wlFrameCallbackListenerWrapper = std::make_unique<Core::WlCallbackListenerWrapper>();
+	std::vector<FdWatch> fdWatches;
 #endif
 
 #ifdef __PLATFORM_WINDOWS__
@@ -157,25 +319,60 @@ private:
 	bool InitVulkanDevice();
 	void InitVulkanGraphicsQueue();
 	bool InitVulkanSurface();
+	bool InitVulkanPipelineCache();
+	// A cache made from the file at path, empty if it isn't there or is from another device or driver
+	VkPipelineCache LoadVulkanPipelineCache(const std::filesystem::path &path) const;
 	bool InitVulkanCommandPool();
+	bool InitVulkanMemoryAllocator();
+	bool InitVulkanStagingBuffer();
+	bool InitVulkanViewUniforms();
+	bool InitVulkanFrames();
+	void DestroyVulkanFrames();
+	// Waits for the frame's previous submission, then recycles its command pool and transient arena
+	bool BeginFrame(FrameResources &frame);
+	// Hands the buffers retired so far to the frame about to be submitted, after the uploads are flushed
+	void TakeRetiredBuffers(FrameResources &frame);
+	ThreadCommandPool* GetThreadCommandPool(FrameResources &frame);
 	bool InitVulkanSwapchain();
+	bool CreateMultisampleImage(SwapchainResources &swapchainResource);
+	bool CreateOffscreenImage(SwapchainResources &swapchainResource);
 	void DestroyVulkanSwapchain();
 
 	VkInstance vkInstance = VK_NULL_HANDLE;
 	VkDebugUtilsMessengerEXT vkMessenger = VK_NULL_HANDLE;
 	VkPhysicalDevice vkPhysicalDevice = VK_NULL_HANDLE;
 	VkDevice vkDevice = VK_NULL_HANDLE;
+	VkPhysicalDeviceFeatures vkEnabledFeatures = {};
+	VkPhysicalDeviceProperties vkPhysicalDeviceProperties = {};
+	VkPipelineCache vkPipelineCache = VK_NULL_HANDLE;
+	std::filesystem::path vkPipelineCachePath = "pipeline.cache";
 	VkQueue vkGraphicsQueue = VK_NULL_HANDLE;
 	VkSurfaceKHR vkSurface = VK_NULL_HANDLE;
 	VkCommandPool vkCommandPool = VK_NULL_HANDLE;
+	MemoryAllocatorPtr memoryAllocator;
+	StagingBufferPtr stagingBuffer;
+	ViewUniformsPtr viewUniforms;
 	VkSwapchainKHR vkSwapchain = VK_NULL_HANDLE;
 	VkRenderPass vkRenderPass = VK_NULL_HANDLE;
 	std::vector<Core::SwapchainResources> vkSwapchainResources;
-	uint32_t vkFramesCount = 0;
+	std::vector<Core::FrameResources> vkFrames;
+	uint32_t vkImageCount = 0;
+	uint32_t vkFramesInFlight = 2;
 	uint32_t vkCurrentFrame = 0;
-	uint32_t vkNextFrame = 0;
+	uint32_t vkImageIndex = 0;
+	std::mutex transientMutex;
+	// Retired since the last submission, handed to the frame submitted next
+	std::vector<std::pair<VkBuffer, MemoryAllocator::Allocation>> pendingRetiredBuffers;
+	std::mutex retiredBuffersMutex;
+	std::mutex threadCommandPoolsMutex;
 	uint32_t vkQueueFamilyIndex = 0;
 	VkFormat vkSwapchainFormat = VK_FORMAT_UNDEFINED;
+	PresentPolicy presentPolicy = PresentPolicy::LowLatency;
+	VkPresentModeKHR vkPresentMode = VK_PRESENT_MODE_FIFO_KHR;
+	std::vector<VkPresentModeKHR> vkSupportedPresentModes;
+	FramePacer framePacer;
+	VkSampleCountFlagBits vkSampleCount = VK_SAMPLE_COUNT_1_BIT;
+	uint64_t headlessFrameNumber = 0;
 
 	// Common
 	uint32_t width = 1280;
@@ -186,10 +383,14 @@ private:
 	OnDestroyType onDestroyCallback;
 	OnResizeType onResizeCallback;
 	OnFrameType onFrameCallback;
+	OnReadbackType onReadbackCallback;
 
 	// bitfield
 	bool isInitialized : 1 = false;
 	bool resize : 1 = false;
 	bool readyToResize : 1 = false;
 	bool isGoingToClose : 1 = false;
+	bool isIndexTypeUint8Enabled : 1 = false;
+	bool isHeadless : 1 = false;
+	bool isDirty : 1 = true;
 };
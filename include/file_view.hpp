@@ -0,0 +1,65 @@
+#pragma once
+
+#include "my_types.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <limits>
+#include <memory>
+#include <span>
+
+// Read-only memory mapping of a whole file, pages are loaded by the OS on first touch.
+// The data stays valid as long as the view is alive, hand the pointer around to keep it so.
+// Nothing is copied on the way: shaders and bundles are read by the driver / staging buffer right from the page cache
+class FileView : public std::enable_shared_from_this<FileView> {
+	struct Private { explicit Private() = default; };
+public:
+	// How the data is going to be read, lets the OS tune readahead (madvise)
+	enum class AccessHint {
+		Normal,
+		Sequential, // read once front to back (shaders, uploads)
+		Random, // lookups into a big file (glyph tables)
+		WillNeed // start reading it in now
+	};
+
+	FileView() = delete;
+	FileView(const FileView &) = delete;
+	FileView(FileView &&) = delete;
+	FileView(Private) {}
+	~FileView();
+
+	// nullptr if the file can't be opened or mapped, an empty file gives an empty view
+	static FileViewPtr Create(const std::filesystem::path &filePath, const AccessHint hint = AccessHint::Normal)
+	{
+		auto ptr = std::make_shared<FileView>(Private());
+		if (!ptr->Init(filePath))
+			return nullptr;
+		ptr->Advise(hint);
+		return ptr;
+	}
+	// Maps the file and reads all of it into memory on another thread, start many and get them when needed
+	static std::future<FileViewPtr> CreateAsync(const std::filesystem::path &filePath, const AccessHint hint = AccessHint::Sequential);
+
+	// Applies to the pages of [offset, offset + size), clamped to the file
+	void Advise(const AccessHint hint, const std::size_t offset = 0, const std::size_t size = std::numeric_limits<std::size_t>::max()) const;
+	// Reads the range into memory on another thread (WillNeed alone only asks), keeps the view alive until done
+	std::future<void> Prefetch(const std::size_t offset = 0, const std::size_t size = std::numeric_limits<std::size_t>::max());
+
+	std::span<const uint8_t> GetData() const { return { data, size }; }
+	const uint8_t* GetPointer() const { return data; }
+	std::size_t GetSize() const { return size; }
+
+private:
+	bool Init(const std::filesystem::path &filePath);
+	// Page aligned part of [offset, offset + size) inside the file, false if it's empty
+	bool GetPageRange(const std::size_t offset, const std::size_t size, std::size_t &pageOffset, std::size_t &pageSize) const;
+	// Touches a byte per page
+	void Load(const std::size_t pageOffset, const std::size_t pageSize) const;
+
+	const uint8_t *data = nullptr;
+	std::size_t size = 0;
+#ifdef __PLATFORM_WINDOWS__
+	void *mapping = nullptr; // HANDLE
+#endif // __PLATFORM_WINDOWS__
+};
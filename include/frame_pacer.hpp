@@ -0,0 +1,44 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// Starts frames as late as a vsync'd (FIFO) swapchain allows. Without it the CPU records framesInFlight frames ahead
+// and then blocks on the fence or the acquire, so input is sampled that many refreshes before it's shown.
+// Measures how long every frame was blocked and moves a sleep in front of the next one to take that time,
+// keeping a margin, and backs off as soon as a frame misses its refresh
+class FramePacer {
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	// Averages in milliseconds
+	struct Statistics {
+		double interval = 0.0; // between presents
+		double wait = 0.0; // blocked on the frame fence and the acquire
+		double work = 0.0; // recording and submitting
+		double delay = 0.0; // slept before the frame
+		uint32_t missedCount = 0; // frames noticeably longer than the interval
+	};
+
+	FramePacer() = default;
+
+	// Disabled, GetDelay is always zero but the statistics are still gathered
+	void SetEnabled(const bool isEnabled);
+	bool IsEnabled() const { return isEnabled; }
+	// Forgets the measurements, for a new swapchain or present mode
+	void Reset();
+
+	// Time to sleep before the next frame starts waiting for its resources
+	Clock::duration GetDelay() const;
+	// After the present of a frame, delay is what GetDelay returned for it
+	void OnFrame(const Clock::duration delay, const Clock::duration wait, const Clock::duration work, const Clock::time_point presented);
+
+	Statistics GetStatistics() const { return statistics; }
+
+private:
+	Statistics statistics;
+	double delay = 0.0; // milliseconds
+	Clock::time_point lastPresented;
+	bool hasLastPresented = false;
+	bool isEnabled = true;
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "my_types.hpp"
+#include "range_allocator.hpp"
+#include <vulkan/vulkan.h>
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+// Sub-allocates device memory out of big blocks, one block list per memory type.
+// Host visible blocks stay mapped for their whole lifetime.
+// Allocate/Free are guarded by a mutex and may be called from any thread. That doesn't make mesh creation thread safe,
+// the uploads go through the StagingBuffer, which isn't
+class MemoryAllocator {
+	struct Private { explicit Private() = default; };
+	struct Block {
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		RangeAllocator ranges;
+		uint8_t *mapped = nullptr;
+		bool isDedicated = false; // made for a single allocation, released as soon as it is freed
+		bool isLinear = true; // buffers and optimal tiling images never share a block, so bufferImageGranularity doesn't matter
+	};
+public:
+	static constexpr VkDeviceSize defaultBlockSize = 64 * 1024 * 1024;
+
+	struct Allocation {
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkDeviceSize offset = 0;
+		VkDeviceSize size = 0;
+		uint8_t *mapped = nullptr; // at offset, nullptr if the memory isn't host visible
+		uint32_t memoryTypeIndex = 0;
+		uint32_t blockIndex = 0;
+	};
+	struct Statistics {
+		uint32_t blockCount = 0; // vkAllocateMemory calls currently alive
+		uint32_t allocationCount = 0;
+		VkDeviceSize reservedSize = 0; // sum of block sizes
+		VkDeviceSize usedSize = 0;
+	};
+
+	MemoryAllocator() = delete;
+	MemoryAllocator(const MemoryAllocator &) = delete;
+	MemoryAllocator(MemoryAllocator &&) = delete;
+	MemoryAllocator(Private) {}
+	~MemoryAllocator();
+
+	static MemoryAllocatorPtr Create(const VkPhysicalDevice vkPhysicalDevice, const VkDevice vkDevice, const VkDeviceSize blockSize = defaultBlockSize)
+	{
+		auto ptr = std::make_shared<MemoryAllocator>(Private());
+		if (!ptr->Init(vkPhysicalDevice, vkDevice, blockSize))
+			return nullptr;
+		return ptr;
+	}
+
+	// isLinear = false for optimal tiling images
+	bool Allocate(const VkMemoryRequirements &requirements, const VkMemoryPropertyFlags properties, Allocation &allocation, const bool isLinear = true);
+	void Free(Allocation &allocation);
+
+	// Creates a buffer and binds it to a fresh allocation
+	bool CreateBuffer(const VkDeviceSize size, const VkBufferUsageFlags usage, const VkMemoryPropertyFlags properties, VkBuffer &buffer, Allocation &allocation);
+	void DestroyBuffer(VkBuffer &buffer, Allocation &allocation);
+
+	std::tuple<uint32_t, ErrorFlag> FindMemoryType(const uint32_t typeFilter, const VkMemoryPropertyFlags properties) const;
+	const VkPhysicalDeviceMemoryProperties& GetMemoryProperties() const { return memoryProperties; }
+	Statistics GetStatistics();
+
+private:
+	bool Init(const VkPhysicalDevice vkPhysicalDevice, const VkDevice vkDevice, const VkDeviceSize blockSize);
+	bool CreateBlock(const uint32_t memoryTypeIndex, const VkDeviceSize size, const bool isDedicated, const bool isLinear, uint32_t &blockIndex);
+	void DestroyBlock(Block &block);
+
+	VkDevice vkDevice = VK_NULL_HANDLE;
+	VkPhysicalDeviceMemoryProperties memoryProperties = {};
+	VkDeviceSize blockSize = defaultBlockSize;
+
+	std::mutex mutex;
+	std::array<std::vector<Block>, VK_MAX_MEMORY_TYPES> blocks; // freed slots stay in place with memory = VK_NULL_HANDLE
+	uint32_t allocationCount = 0;
+};
@@ -1,11 +1,15 @@
 #pragma once
 
+#include "memory_allocator.hpp"
 #include "my_types.hpp"
+#include "triangulation/geometry.hpp"
+#include "vertex_format.hpp"
 #include <glm/glm.hpp>
 #include <vulkan/vulkan.h>
 #include <cstddef>
 #include <cstdint>
-#include <tuple>
+#include <span>
+#include <type_traits>
 #include <vector>
 
 class Mesh {
@@ -29,7 +33,7 @@ public:
 				VkVertexInputAttributeDescription{
 					.location = 0,
 					.binding = 0,
-					.format = VK_FORMAT_R32G32_SFLOAT,
+					.format = VK_FORMAT_R32G32B32_SFLOAT,
 					.offset = offsetof(Vertex, position)
 				},
 				VkVertexInputAttributeDescription{
@@ -47,9 +51,21 @@ public:
 			};
 			return attributeDescriptions;
 		}
+		static bool FromVertex(const Triangulation::Vertex &vertex, Vertex &converted) {
+			converted = { .position = vertex.position, .color = vertex.color, .uv = vertex.uv };
+			return true;
+		}
 	};
 	typedef std::vector<Vertex> Vertices;
 	typedef std::vector<uint16_t> Indices;
+	// For meshes with more than 65536 vertices (merged text blocks, big maps)
+	typedef std::vector<uint32_t> Indices32;
+	static_assert(sizeof(Vertex) == sizeof(Triangulation::Vertex) &&
+		offsetof(Vertex, position) == offsetof(Triangulation::Vertex, position) &&
+		offsetof(Vertex, color) == offsetof(Triangulation::Vertex, color) &&
+		offsetof(Vertex, uv) == offsetof(Triangulation::Vertex, uv), "Triangulation output must be uploadable as Mesh::Vertices");
+	static_assert(std::is_same_v<Indices, Triangulation::Indices>);
+	static_assert(VertexFormat<Vertex>);
 
 	Mesh() = delete;
 	Mesh(const Mesh &) = delete;
@@ -57,29 +73,76 @@ public:
 	Mesh(Private) {}
 	~Mesh();
 
-	static MeshPtr Create(const CorePtr core, const Mesh::Vertices &vertices, const Mesh::Indices &indices)
+	// Indices are stored with the narrowest type that fits the biggest one (8-bit with VK_EXT_index_type_uint8).
+	// Data is only read while uploading, vectors, arrays and mapped files all work without copies
+	static MeshPtr Create(const CorePtr core, std::span<const Mesh::Vertex> vertices, std::span<const uint16_t> indices)
+	{
+		return Mesh::Create<Mesh::Vertex>(core, vertices, indices);
+	}
+	static MeshPtr Create(const CorePtr core, std::span<const Mesh::Vertex> vertices, std::span<const uint32_t> indices)
+	{
+		return Mesh::Create<Mesh::Vertex>(core, vertices, indices);
+	}
+	static MeshPtr Create(const CorePtr core, const Triangulation::Geometry &geometry)
 	{
 		auto ptr = std::make_shared<Mesh>(Private());
-		if (!ptr->Init(core, vertices, indices))
+		if (!ptr->Init(core, geometry.vertices.data(), sizeof(Triangulation::Vertices::value_type) * geometry.vertices.size(), std::span(geometry.indices)))
 			return nullptr;
 		return ptr;
 	}
+	// Other vertex formats (see vertex_format.hpp), Mesh::Create<CompactVertex>(core, vertices, indices),
+	// Mesh::Create<CompactVertex>(core, geometry) converts the geometry first
+	template <VertexFormat VertexType>
+	static MeshPtr Create(const CorePtr core, std::span<const VertexType> vertices, std::span<const uint16_t> indices)
+	{
+		auto ptr = std::make_shared<Mesh>(Private());
+		if (!ptr->Init(core, vertices.data(), vertices.size_bytes(), indices))
+			return nullptr;
+		return ptr;
+	}
+	template <VertexFormat VertexType>
+	static MeshPtr Create(const CorePtr core, std::span<const VertexType> vertices, std::span<const uint32_t> indices)
+	{
+		auto ptr = std::make_shared<Mesh>(Private());
+		if (!ptr->Init(core, vertices.data(), vertices.size_bytes(), indices))
+			return nullptr;
+		return ptr;
+	}
+	// Raw vertices in whatever format the pipeline expects, uploaded straight from the given memory (i.e. a MeshBundle)
+	static MeshPtr Create(const CorePtr core, std::span<const uint8_t> vertexData, std::span<const uint16_t> indices)
+	{
+		auto ptr = std::make_shared<Mesh>(Private());
+		if (!ptr->Init(core, vertexData.data(), vertexData.size(), indices))
+			return nullptr;
+		return ptr;
+	}
+	template <VertexFormat VertexType>
+	static MeshPtr Create(const CorePtr core, const Triangulation::Geometry &geometry)
+	{
+		std::vector<VertexType> vertices;
+		if (!ConvertVertices(std::span(geometry.vertices), vertices))
+			return nullptr;
+		return Mesh::Create<VertexType>(core, vertices, geometry.indices);
+	}
 
 	void Bind();
 	void Draw();
 
+	VkIndexType GetIndexType() const { return indexType; }
+
 private:
-	bool Init(const CorePtr core, const Mesh::Vertices &vertices, const Mesh::Indices &indices);
-	bool CreateVertexBuffer(const CorePtr core, const Mesh::Vertices &vertices);
-	bool CreateIndexBuffer(const CorePtr core, const Mesh::Indices &indices);
-	static bool CreateBuffer(const VkPhysicalDevice vkPhysicalDevice, const VkDevice vkDevice, const VkDeviceSize size, const VkBufferUsageFlags usage, const VkMemoryPropertyFlags properties, VkBuffer &buffer, VkDeviceMemory &bufferMemory);
-	static void CopyBuffer(const VkDevice vkDevice, const VkQueue graphicsQueue, const VkCommandPool commandPool, const VkBuffer srcBuffer, const VkBuffer dstBuffer, const VkDeviceSize size);
-	static std::tuple<uint32_t, ErrorFlag> FindMemoryType(const VkPhysicalDevice vkPhysicalDevice, const uint32_t typeFilter, const VkMemoryPropertyFlags properties);
+	// Instantiated for uint16_t and uint32_t indices in mesh.cpp
+	template <typename IndexType>
+	bool Init(const CorePtr core, const void *vertexData, const VkDeviceSize vertexDataSize, std::span<const IndexType> indices);
+	bool CreateVertexBuffer(const CorePtr core, const void *vertexData, const VkDeviceSize vertexDataSize);
+	template <typename IndexType>
+	bool CreateIndexBuffer(const CorePtr core, std::span<const IndexType> indices);
 
 	CoreWeakPtr coreWeak;
 	VkBuffer vertexBuffer = VK_NULL_HANDLE;
-	VkDeviceMemory vertexBufferMemory = VK_NULL_HANDLE;
+	MemoryAllocator::Allocation vertexBufferMemory;
 	VkBuffer indexBuffer = VK_NULL_HANDLE;
-	VkDeviceMemory indexBufferMemory = VK_NULL_HANDLE;
+	MemoryAllocator::Allocation indexBufferMemory;
 	uint32_t indexCount = 0;
+	VkIndexType indexType = VK_INDEX_TYPE_UINT16;
 };
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "memory_allocator.hpp"
+#include "mesh.hpp"
+#include "my_types.hpp"
+#include "range_allocator.hpp"
+#include "triangulation/geometry.hpp"
+#include "vertex_format.hpp"
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+// Many meshes packed into one vertex and one index buffer, bind once and draw ranges.
+// Indices of every entry stay local (0-based), the entry's vertexOffset is added by vkCmdDrawIndexed,
+// so 16-bit indices are enough no matter how many vertices the atlas holds.
+// Add/Remove/Compact may move data around on the GPU: draws recorded before them (in the same frame) are invalid
+class MeshAtlas {
+	struct Private { explicit Private() = default; };
+public:
+	typedef uint32_t Handle;
+	static constexpr Handle invalidHandle = std::numeric_limits<Handle>::max();
+	static constexpr uint32_t defaultVertexCapacity = 64 * 1024;
+	static constexpr uint32_t defaultIndexCapacity = 3 * defaultVertexCapacity;
+
+	// Draw arguments of an entry, valid until the next Add/Remove/Compact
+	struct Range {
+		uint32_t firstIndex = 0;
+		int32_t vertexOffset = 0;
+		uint32_t indexCount = 0;
+	};
+	struct Statistics {
+		uint32_t entryCount = 0;
+		uint32_t vertexCount = 0;
+		uint32_t vertexCapacity = 0;
+		uint32_t indexCount = 0;
+		uint32_t indexCapacity = 0;
+	};
+
+	MeshAtlas() = delete;
+	MeshAtlas(const MeshAtlas &) = delete;
+	MeshAtlas(MeshAtlas &&) = delete;
+	MeshAtlas(Private) {}
+	~MeshAtlas();
+
+	static MeshAtlasPtr Create(const CorePtr core, const uint32_t vertexCapacity = defaultVertexCapacity, const uint32_t indexCapacity = defaultIndexCapacity, const uint32_t vertexStride = sizeof(Mesh::Vertex))
+	{
+		auto ptr = std::make_shared<MeshAtlas>(Private());
+		if (!ptr->Init(core, vertexCapacity, indexCapacity, vertexStride))
+			return nullptr;
+		return ptr;
+	}
+	template <VertexFormat VertexType>
+	static MeshAtlasPtr Create(const CorePtr core, const uint32_t vertexCapacity = defaultVertexCapacity, const uint32_t indexCapacity = defaultIndexCapacity)
+	{
+		return MeshAtlas::Create(core, vertexCapacity, indexCapacity, sizeof(VertexType));
+	}
+
+	// Returns invalidHandle on failure, grows the buffers if the data doesn't fit even after compaction
+	Handle Add(const void *vertexData, const uint32_t vertexCount, std::span<const Mesh::Indices::value_type> indices);
+	Handle Add(std::span<const Mesh::Vertex> vertices, std::span<const Mesh::Indices::value_type> indices)
+	{
+		return this->Add<Mesh::Vertex>(vertices, indices);
+	}
+	// invalidHandle if the atlas was created for another vertex format
+	template <VertexFormat VertexType>
+	Handle Add(std::span<const VertexType> vertices, std::span<const Mesh::Indices::value_type> indices)
+	{
+		if (sizeof(VertexType) != this->vertexStride)
+			return invalidHandle;
+		return this->Add(vertices.data(), static_cast<uint32_t>(vertices.size()), indices);
+	}
+	// Converted to VertexType, which has to be the vertex format the atlas was created for
+	template <VertexFormat VertexType = Mesh::Vertex>
+	Handle Add(const Triangulation::Geometry &geometry)
+	{
+		if (sizeof(VertexType) != this->vertexStride)
+			return invalidHandle;
+		// Same layout, uploaded as is
+		if constexpr (std::is_same_v<VertexType, Mesh::Vertex>)
+			return this->Add(geometry.vertices.data(), static_cast<uint32_t>(geometry.vertices.size()), geometry.indices);
+		std::vector<VertexType> vertices;
+		if (!ConvertVertices(std::span(geometry.vertices), vertices))
+			return invalidHandle;
+		return this->Add<VertexType>(vertices, geometry.indices);
+	}
+	void Remove(const Handle handle);
+	// Packs all entries to the front of the buffers, nothing moves if there are no holes
+	bool Compact();
+
+	bool IsValid(const Handle handle) const { return handle < entries.size() && entries[handle].isUsed; }
+	Range GetRange(const Handle handle) const { return IsValid(handle) ? entries[handle].range : Range{}; }
+	Statistics GetStatistics() const;
+
+	// Binds both buffers to the current frame, Pipeline::Bind doesn't touch them
+	void Bind() const;
+	// Expects Bind to be called after the last pipeline change that rebound buffers (i.e. Mesh::Draw)
+	void Draw(const Handle handle) const;
+
+	VkBuffer GetVertexBuffer() const { return vertexBuffer; }
+	VkBuffer GetIndexBuffer() const { return indexBuffer; }
+
+private:
+	struct Entry {
+		Range range;
+		uint32_t vertexCount = 0;
+		bool isUsed = false;
+	};
+
+	bool Init(const CorePtr core, const uint32_t vertexCapacity, const uint32_t indexCapacity, const uint32_t vertexStride);
+	bool CreateBuffers(const CorePtr core, const uint32_t vertexCapacity, const uint32_t indexCapacity, VkBuffer &vertexBuffer, MemoryAllocator::Allocation &vertexBufferMemory, VkBuffer &indexBuffer, MemoryAllocator::Allocation &indexBufferMemory) const;
+	// Packs all entries into buffers of the given capacity, new buffers are made if it differs from the current one
+	bool Repack(const uint32_t vertexCapacity, const uint32_t indexCapacity);
+
+	CoreWeakPtr coreWeak;
+	uint32_t vertexStride = 0;
+	VkBuffer vertexBuffer = VK_NULL_HANDLE;
+	MemoryAllocator::Allocation vertexBufferMemory;
+	VkBuffer indexBuffer = VK_NULL_HANDLE;
+	MemoryAllocator::Allocation indexBufferMemory;
+	RangeAllocator vertexRanges; // in vertices
+	RangeAllocator indexRanges; // in indices
+
+	std::vector<Entry> entries;
+	std::vector<Handle> freeHandles;
+};
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "file_view.hpp"
+#include "mesh.hpp"
+#include "my_types.hpp"
+#include "triangulation/geometry.hpp"
+#include "vertex_format.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+// Pre-triangulated meshes in one file, loaded with mmap and used in place:
+// header, entry table sorted by id, then all vertices and all indices as two blobs.
+// Offsets are aligned so the table can be read through a pointer cast and the blobs handed to the
+// staging buffer as they are, loading only checks that every range stays inside the file.
+// Native byte order, the version changes whenever the layout does.
+// The content key is up to the writer (a hash of what the meshes were made from), readers compare it to tell a stale bundle
+class MeshBundle {
+	struct Private { explicit Private() = default; };
+public:
+	typedef uint32_t Id;
+	static constexpr char magic[8] = { 'O', 'T', 'M', 'E', 'S', 'H', 'B', '\0' };
+	static constexpr uint32_t version = 2;
+	static constexpr uint64_t blobAlignment = 256;
+
+	enum class Format : uint32_t {
+		Vertex = 1, // Mesh::Vertex
+		CompactVertex = 2
+	};
+	template <VertexFormat VertexType>
+	static constexpr Format GetFormat()
+	{
+		if constexpr (std::is_same_v<VertexType, CompactVertex>)
+			return Format::CompactVertex;
+		else {
+			static_assert(std::is_same_v<VertexType, Mesh::Vertex>, "Vertex format can't be stored in a bundle");
+			return Format::Vertex;
+		}
+	}
+
+	struct Header {
+		char magic[8];
+		uint32_t version;
+		Format format;
+		uint32_t vertexStride;
+		uint32_t entryCount;
+		uint64_t entriesOffset;
+		uint64_t vertexDataOffset;
+		uint64_t vertexDataSize;
+		uint64_t indexDataOffset;
+		uint64_t indexDataSize;
+		uint64_t contentKey;
+	};
+	struct Entry {
+		Id id;
+		uint32_t vertexCount;
+		uint32_t indexCount;
+		uint32_t reserved;
+		uint64_t vertexOffset; // in bytes, from the start of the vertex blob
+		uint64_t indexOffset; // in bytes, from the start of the index blob
+	};
+	static_assert(sizeof(Header) == 72 && sizeof(Entry) == 32 && std::is_trivially_copyable_v<Header> && std::is_trivially_copyable_v<Entry>);
+
+	// Input of Save, indices are 16-bit and local to the mesh like Triangulation::Geometry ones
+	struct Item {
+		Id id;
+		const Triangulation::Geometry *geometry;
+	};
+
+	MeshBundle() = delete;
+	MeshBundle(const MeshBundle &) = delete;
+	MeshBundle(MeshBundle &&) = delete;
+	MeshBundle(Private) {}
+
+	// Maps the file, nullptr if it isn't a valid bundle of this version
+	static MeshBundlePtr Create(const std::filesystem::path &filePath)
+	{
+		auto ptr = std::make_shared<MeshBundle>(Private());
+		if (!ptr->Init(filePath))
+			return nullptr;
+		return ptr;
+	}
+	// Converts every geometry to VertexType and writes the bundle, ids have to be unique
+	template <VertexFormat VertexType>
+	static bool Save(const std::filesystem::path &filePath, std::span<const Item> items, const uint64_t contentKey = 0)
+	{
+		std::vector<std::vector<VertexType>> vertices(items.size());
+		std::vector<RawItem> rawItems(items.size());
+		for (size_t i = 0; i < items.size(); i++) {
+			if (!ConvertVertices(std::span(items[i].geometry->vertices), vertices[i]))
+				return false;
+			rawItems[i] = RawItem{ .id = items[i].id, .vertexData = vertices[i].data(), .vertexCount = static_cast<uint32_t>(vertices[i].size()), .indices = items[i].geometry->indices };
+		}
+		return SaveRaw(filePath, GetFormat<VertexType>(), sizeof(VertexType), contentKey, rawItems);
+	}
+
+	Format GetVertexFormat() const { return header->format; }
+	uint32_t GetVertexStride() const { return header->vertexStride; }
+	uint64_t GetContentKey() const { return header->contentKey; }
+	std::span<const Entry> GetEntries() const { return entries; }
+	// nullptr if there is no such id
+	const Entry* Find(const Id id) const;
+	// Point into the mapped file
+	std::span<const uint8_t> GetVertexData(const Entry &entry) const { return vertexData.subspan(entry.vertexOffset, static_cast<std::size_t>(entry.vertexCount) * header->vertexStride); }
+	std::span<const uint16_t> GetIndices(const Entry &entry) const { return indexData.subspan(entry.indexOffset / sizeof(uint16_t), entry.indexCount); }
+
+private:
+	struct RawItem {
+		Id id;
+		const void *vertexData;
+		uint32_t vertexCount;
+		std::span<const uint16_t> indices;
+	};
+
+	bool Init(const std::filesystem::path &filePath);
+	static bool SaveRaw(const std::filesystem::path &filePath, const Format format, const uint32_t vertexStride, const uint64_t contentKey, std::vector<RawItem> &items);
+
+	FileViewPtr file;
+	const Header *header = nullptr;
+	std::span<const Entry> entries;
+	std::span<const uint8_t> vertexData;
+	std::span<const uint16_t> indexData;
+};
@@ -1,17 +1,31 @@
 #pragma once
 
+#include <cstdint>
 #include <functional>
 #include <memory>
+#include <span>
 
 typedef std::shared_ptr<class Core> CorePtr;
 typedef std::weak_ptr<class Core> CoreWeakPtr;
 typedef std::shared_ptr<class Pipeline> PipelinePtr;
+typedef std::shared_ptr<class PipelineSet> PipelineSetPtr;
 typedef std::shared_ptr<class Mesh> MeshPtr;
+typedef std::shared_ptr<class MeshAtlas> MeshAtlasPtr;
+typedef std::shared_ptr<class StagingBuffer> StagingBufferPtr;
+typedef std::shared_ptr<class MemoryAllocator> MemoryAllocatorPtr;
+typedef std::shared_ptr<class TextRenderer> TextRendererPtr;
+typedef std::shared_ptr<class FileView> FileViewPtr;
+typedef std::shared_ptr<class MeshBundle> MeshBundlePtr;
+typedef std::shared_ptr<class ViewUniforms> ViewUniformsPtr;
 
 typedef std::function<bool(const CorePtr)> OnInitType;
 typedef std::function<void(const CorePtr)> OnDestroyType;
 typedef std::function<void(const CorePtr)> OnResizeType;
 typedef std::function<bool(const CorePtr)> OnFrameType;
+// Headless frame number (from 0), its tightly packed pixels (Core::GetVulkanColorFormat, GetWidth x GetHeight), valid during the call only
+typedef std::function<void(const CorePtr, uint64_t, std::span<const uint8_t>)> OnReadbackType;
+// Watched file descriptor and the poll revents it got
+typedef std::function<void(const CorePtr, int, short)> OnFdEventType;
 
 typedef bool ErrorFlag;
 
@@ -1,11 +1,17 @@
 #pragma once
 
+#include "file_view.hpp"
 #include "my_types.hpp"
+#include "pipeline_key.hpp"
 #include "utils.hpp"
+#include <glm/glm.hpp>
 #include <vulkan/vulkan.h>
 #include <array>
+#include <cstdint>
 #include <filesystem>
+#include <future>
 #include <optional>
+#include <span>
 #include <string>
 #include <vector>
 
@@ -46,50 +52,112 @@ class Pipeline
 		std::vector<VkDynamicState> states;
 	};
 public:
+	// Push constant of every pipeline, a 2D affine transform applied to the vertices before the view (see ViewUniforms):
+	// position = axisX * x + axisY * y + offset
+	struct Transform {
+		glm::vec2 axisX = { 1.0f, 0.0f };
+		glm::vec2 axisY = { 0.0f, 1.0f };
+		glm::vec2 offset = { 0.0f, 0.0f };
+
+		// Columns of a 2D homogeneous matrix
+		static Transform FromMatrix(const glm::mat3 &matrix)
+		{
+			return Transform{ .axisX = glm::vec2(matrix[0]), .axisY = glm::vec2(matrix[1]), .offset = glm::vec2(matrix[2]) };
+		}
+	};
+	static_assert(sizeof(Transform) == 24, "Has to match DrawTransform in the vertex shaders");
+
+	// Vertex buffer bindings and attributes of a pipeline, every type describes one binding,
+	// extra types are usually per instance data (see TextRenderer::Instance)
+	struct VertexInput {
+		std::vector<VkVertexInputBindingDescription> bindingDescriptions;
+		std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+
+		template <typename VertexType, typename... InstanceTypes>
+		static VertexInput Get()
+		{
+			VertexInput vertexInput = {
+				.bindingDescriptions = { VertexType::GetBindingDescription(), InstanceTypes::GetBindingDescription()... },
+				.attributeDescriptions = VertexType::GetAttributeDescriptions()
+			};
+			([&vertexInput] {
+				const auto instanceAttributeDescriptions = InstanceTypes::GetAttributeDescriptions();
+				vertexInput.attributeDescriptions.insert(vertexInput.attributeDescriptions.end(), instanceAttributeDescriptions.begin(), instanceAttributeDescriptions.end());
+			}(), ...);
+			return vertexInput;
+		}
+	};
+
 	Pipeline() = delete;
 	Pipeline(const Pipeline &) = delete;
 	Pipeline(Pipeline &&) = delete;
 	Pipeline(Private) {}
 	~Pipeline();
 
-	template <typename VertexType>
-	static PipelinePtr Create(const CorePtr core, const std::filesystem::path vertexShaderFilePath, const std::filesystem::path fragmentShaderFilePath)
+	// Template arguments make the VertexInput, the key picks the variant (see PipelineSet to share shaders between variants)
+	template <typename VertexType, typename... InstanceTypes>
+	static PipelinePtr Create(const CorePtr core, const std::filesystem::path vertexShaderFilePath, const std::filesystem::path fragmentShaderFilePath, const PipelineKey &key = {})
+	{
+		// The driver reads SPIR-V right from the mapped files, the views only have to outlive the call
+		const auto vertexShaderFile = FileView::Create(vertexShaderFilePath, FileView::AccessHint::Sequential);
+		const auto fragmentShaderFile = FileView::Create(fragmentShaderFilePath, FileView::AccessHint::Sequential);
+		if (!vertexShaderFile || !fragmentShaderFile)
+			return nullptr;
+		return Pipeline::Create<VertexType, InstanceTypes...>(core, vertexShaderFile->GetData(), fragmentShaderFile->GetData(), key);
+	}
+	// Create on a worker thread, shader compilation is the slow part of startup and the driver does it in parallel.
+	// Start all pipelines first, then wait for them; finished ones land in the Core's pipeline cache
+	template <typename VertexType, typename... InstanceTypes>
+	static std::future<PipelinePtr> CreateAsync(const CorePtr core, const std::filesystem::path vertexShaderFilePath, const std::filesystem::path fragmentShaderFilePath, const PipelineKey &key = {})
+	{
+		return std::async(std::launch::async, [core, vertexShaderFilePath, fragmentShaderFilePath, key]() {
+			return Pipeline::Create<VertexType, InstanceTypes...>(core, vertexShaderFilePath, fragmentShaderFilePath, key);
+		});
+	}
+	template <typename VertexType, typename... InstanceTypes>
+	static PipelinePtr Create(const CorePtr core, const std::string &vertexShaderCode, const std::string &fragmentShaderCode, const PipelineKey &key = {})
 	{
-		auto vertexShaderBuffer = ReadFile(vertexShaderFilePath);
-		auto fragmentShaderBuffer = ReadFile(fragmentShaderFilePath);
-		return Pipeline::Create<VertexType>(core, vertexShaderBuffer, fragmentShaderBuffer);
+		return Pipeline::Create<VertexType, InstanceTypes...>(core, AsBytes(vertexShaderCode), AsBytes(fragmentShaderCode), key);
 	}
-	template <typename VertexType>
-	static PipelinePtr Create(const CorePtr core, const std::string &vertexShaderCode, const std::string &fragmentShaderCode)
+	template <typename VertexType, typename... InstanceTypes>
+	static PipelinePtr Create(const CorePtr core, std::span<const uint8_t> vertexShaderCode, std::span<const uint8_t> fragmentShaderCode, const PipelineKey &key = {})
 	{
-		return Pipeline::Create<VertexType>(core, std::vector<uint8_t>{ vertexShaderCode.begin(), vertexShaderCode.end() }, std::vector<uint8_t>{ fragmentShaderCode.begin(), fragmentShaderCode.end() });
+		return Pipeline::Create(core, VertexInput::Get<VertexType, InstanceTypes...>(), vertexShaderCode, fragmentShaderCode, key);
 	}
-	template <typename VertexType>
-	static PipelinePtr Create(const CorePtr core, const std::vector<uint8_t> &vertexShaderCode, const std::vector<uint8_t> &fragmentShaderCode)
+	static PipelinePtr Create(const CorePtr core, const VertexInput &vertexInput, std::span<const uint8_t> vertexShaderCode, std::span<const uint8_t> fragmentShaderCode, const PipelineKey &key = {})
 	{
 		auto ptr = std::make_shared<Pipeline>(Private());
-		if (!ptr->Init(VertexType::GetBindingDescription(), VertexType::GetAttributeDescriptions(), core, vertexShaderCode, fragmentShaderCode))
+		if (!ptr->Init(core, vertexInput, vertexShaderCode, fragmentShaderCode, key))
 			return nullptr;
 		return ptr;
 	}
 
+	// Binds the pipeline, the view of the current frame and resets the transform to identity
 	void Bind() const;
+	// Transform of the following draws, until the next Bind or PushTransform
+	void PushTransform(const Transform &transform) const;
+
+	const PipelineKey& GetKey() const { return key; }
 
 private:
-	bool Init(const VkVertexInputBindingDescription &vertexInputBindingDescription, const std::vector<VkVertexInputAttributeDescription> &vertexInputAttributeDescriptions, const CorePtr core, const std::vector<uint8_t> &vertexShaderCode, const std::vector<uint8_t> &fragmentShaderCode);
-	static Pipeline::ShaderModuleWrapper CreateShaderModule(const VkDevice vkDevice, const std::vector<uint8_t> &code);
-	static constexpr std::array<VkPipelineShaderStageCreateInfo, 2> GetShadersStageCreateInfo(const VkShaderModule vertexShaderModule, const VkShaderModule fragmentShaderModule);
-	static constexpr VkPipelineVertexInputStateCreateInfo GetVertexInputStateCreateInfo(const VkVertexInputBindingDescription &vertexInputBindingDescription, const std::vector<VkVertexInputAttributeDescription> &vertexInputAttributeDescriptions);
+	bool Init(const CorePtr core, const VertexInput &vertexInput, std::span<const uint8_t> vertexShaderCode, std::span<const uint8_t> fragmentShaderCode, const PipelineKey &key);
+	static std::span<const uint8_t> AsBytes(const std::string &code) { return { reinterpret_cast<const uint8_t*>(code.data()), code.size() }; }
+	// SPIR-V is made of words, misaligned code is copied, aligned one (mappings, vectors) is used as is
+	static Pipeline::ShaderModuleWrapper CreateShaderModule(const VkDevice vkDevice, std::span<const uint8_t> code);
+	static constexpr std::array<VkPipelineShaderStageCreateInfo, 2> GetShadersStageCreateInfo(const VkShaderModule vertexShaderModule, const VkShaderModule fragmentShaderModule, const VkSpecializationInfo *specializationInfo);
+	static constexpr VkPipelineVertexInputStateCreateInfo GetVertexInputStateCreateInfo(const std::vector<VkVertexInputBindingDescription> &vertexInputBindingDescriptions, const std::vector<VkVertexInputAttributeDescription> &vertexInputAttributeDescriptions);
 	static constexpr VkPipelineInputAssemblyStateCreateInfo GetInputAssemblyStateCreateInfo();
 	static constexpr VkPipelineViewportStateCreateInfo GetViewportStateCreateInfo();
-	static constexpr VkPipelineRasterizationStateCreateInfo GetRasterizationStateCreateInfo();
-	static constexpr VkPipelineMultisampleStateCreateInfo GetMultisampleStateCreateInfo();
-	static constexpr VkPipelineColorBlendAttachmentState GetColorBlendAttachmentState();
+	static constexpr VkPipelineRasterizationStateCreateInfo GetRasterizationStateCreateInfo(const PipelineKey::Cull cull);
+	static constexpr VkPipelineMultisampleStateCreateInfo GetMultisampleStateCreateInfo(const VkSampleCountFlagBits samples, const bool isSampleShading);
+	static constexpr VkPipelineColorBlendAttachmentState GetColorBlendAttachmentState(const PipelineKey::Blend blend);
 	static constexpr VkPipelineColorBlendStateCreateInfo GetColorBlendStateCreateInfo(const VkPipelineColorBlendAttachmentState *colorBlendAttachmentState);
-	static VkPipelineLayout CreatePipelineLayout(const VkDevice vkDevice);
+	// Every pipeline layout is the same (view set + transform), so binding another pipeline keeps both bound
+	static VkPipelineLayout CreatePipelineLayout(const VkDevice vkDevice, const VkDescriptorSetLayout viewDescriptorSetLayout);
 
 	CoreWeakPtr coreWeak;
 	VkPipeline vkPipeline = VK_NULL_HANDLE;
 	VkPipelineLayout vkPipelineLayout = VK_NULL_HANDLE;
 	VkRenderPass vkRenderPass = VK_NULL_HANDLE;
+	PipelineKey key;
 };
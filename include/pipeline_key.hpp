@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// Everything that differs between pipelines made of the same shaders.
+// Fixed function state goes into the create info, the rest into specialization constants
+// (see quadratic-spline-fs.glsl), so one pair of shader files covers every variant.
+// Built like PipelineKey().WithBlend(PipelineKey::Blend::Opaque).WithCurve(PipelineKey::Curve::Solid)
+struct PipelineKey {
+	enum class Blend : uint8_t {
+		Opaque,
+		Alpha, // straight alpha
+		Premultiplied,
+		Additive
+	};
+	enum class Cull : uint8_t {
+		None,
+		Back,
+		Front
+	};
+	// constant_id 0. Cubics are approximated with quadratics by the triangulator, so there is no cubic variant
+	enum class Curve : uint8_t {
+		Solid, // every triangle is filled, curve coordinates are ignored
+		Quadratic // Loop-Blinn quadratic curve triangles
+	};
+	// constant_id 1
+	enum class Antialiasing : uint8_t {
+		None, // hard edge at the curve
+		Analytic, // coverage from the screen space distance to the curve or to a fringe edge (Triangulator::Options::fringeWidth)
+		Multisample // hard edge evaluated per sample, needs samples above 1 (Core::SetVulkanSampleCount)
+	};
+
+	Blend blend = Blend::Alpha;
+	Cull cull = Cull::Back;
+	Curve curve = Curve::Quadratic;
+	Antialiasing antialiasing = Antialiasing::Analytic;
+	// Has to match the render pass the pipeline is used with
+	VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+
+	constexpr PipelineKey WithBlend(const Blend value) const { auto key = *this; key.blend = value; return key; }
+	constexpr PipelineKey WithCull(const Cull value) const { auto key = *this; key.cull = value; return key; }
+	constexpr PipelineKey WithCurve(const Curve value) const { auto key = *this; key.curve = value; return key; }
+	constexpr PipelineKey WithAntialiasing(const Antialiasing value) const { auto key = *this; key.antialiasing = value; return key; }
+	constexpr PipelineKey WithSamples(const VkSampleCountFlagBits value) const { auto key = *this; key.samples = value; return key; }
+
+	constexpr bool operator==(const PipelineKey &) const = default;
+
+	// Every field gets its own bits, different keys never collide
+	constexpr uint64_t GetPacked() const
+	{
+		return static_cast<uint64_t>(blend) | static_cast<uint64_t>(cull) << 8 | static_cast<uint64_t>(curve) << 16 |
+			static_cast<uint64_t>(antialiasing) << 24 | static_cast<uint64_t>(samples) << 32;
+	}
+	struct Hash {
+		std::size_t operator()(const PipelineKey &key) const { return std::hash<uint64_t>()(key.GetPacked()); }
+	};
+
+	// Layout of the specialization constants, ids are the member indices
+	struct SpecializationData {
+		uint32_t curve;
+		uint32_t antialiasing;
+	};
+	constexpr SpecializationData GetSpecializationData() const
+	{
+		return SpecializationData{
+			.curve = static_cast<uint32_t>(curve),
+			.antialiasing = static_cast<uint32_t>(antialiasing)
+		};
+	}
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "file_view.hpp"
+#include "my_types.hpp"
+#include "pipeline.hpp"
+#include "pipeline_key.hpp"
+#include <cstddef>
+#include <filesystem>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+
+// One pair of shaders and a vertex input with every variant made of them.
+// The shader files stay mapped, a pipeline is created the first time its key is asked for
+// and shared by everybody asking for the same key afterwards. Can be used from any thread
+class PipelineSet {
+	struct Private { explicit Private() = default; };
+public:
+	PipelineSet() = delete;
+	PipelineSet(const PipelineSet &) = delete;
+	PipelineSet(PipelineSet &&) = delete;
+	PipelineSet(Private) {}
+
+	template <typename VertexType, typename... InstanceTypes>
+	static PipelineSetPtr Create(const CorePtr core, const std::filesystem::path &vertexShaderFilePath, const std::filesystem::path &fragmentShaderFilePath)
+	{
+		auto ptr = std::make_shared<PipelineSet>(Private());
+		if (!ptr->Init(core, Pipeline::VertexInput::Get<VertexType, InstanceTypes...>(), vertexShaderFilePath, fragmentShaderFilePath))
+			return nullptr;
+		return ptr;
+	}
+
+	// nullptr if the pipeline can't be created, failures aren't remembered
+	PipelinePtr Get(const PipelineKey &key);
+	// Creates the missing variants on worker threads, false if any of them fails
+	bool Prepare(std::span<const PipelineKey> keys);
+
+	std::size_t GetCount() const;
+
+private:
+	bool Init(const CorePtr core, Pipeline::VertexInput &&vertexInput, const std::filesystem::path &vertexShaderFilePath, const std::filesystem::path &fragmentShaderFilePath);
+	PipelinePtr CreatePipeline(const PipelineKey &key) const;
+	// Keeps the pipeline made first if another thread raced to create the same key
+	PipelinePtr Insert(const PipelineKey &key, PipelinePtr pipeline);
+
+	CoreWeakPtr coreWeak;
+	Pipeline::VertexInput vertexInput;
+	FileViewPtr vertexShaderFile;
+	FileViewPtr fragmentShaderFile;
+
+	mutable std::mutex mutex;
+	std::unordered_map<PipelineKey, PipelinePtr, PipelineKey::Hash> pipelines;
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+
+// Offset/size bookkeeping of one linear resource (a memory block, a buffer).
+// Free ranges are kept sorted by offset, first fit, neighbours are merged on free
+class RangeAllocator {
+public:
+	RangeAllocator() = default;
+	explicit RangeAllocator(const uint64_t size) { this->Reset(size); }
+
+	// Forgets every allocation
+	void Reset(const uint64_t size);
+	// Adds [GetSize(), size) to the free space, size can only grow
+	void Grow(const uint64_t size);
+	bool Allocate(const uint64_t size, const uint64_t alignment, uint64_t &offset);
+	void Free(const uint64_t offset, uint64_t size);
+
+	uint64_t GetSize() const { return size; }
+	uint64_t GetUsedSize() const { return usedSize; }
+	uint64_t GetFreeSize() const { return size - usedSize; }
+	bool IsEmpty() const { return !usedSize; }
+
+private:
+	uint64_t size = 0;
+	uint64_t usedSize = 0;
+	std::map<uint64_t, uint64_t> freeRanges; // offset -> size
+};
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "memory_allocator.hpp"
+#include "my_types.hpp"
+#include <vulkan/vulkan.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <span>
+#include <utility>
+#include <vector>
+
+// Persistently mapped ring buffer for host -> device buffer copies.
+// Copies are recorded into the current batch and submitted together on Flush (or when the ring runs out of space),
+// every batch has its own fence, so space is reclaimed as soon as the GPU is done with it, without idling the queue.
+// A batch starts with a barrier against vertex input of earlier submissions, so it's safe to overwrite buffers
+// that frames in flight still read from.
+// Not synchronized: Flush submits to the graphics queue the frames go to, so it's used from the rendering thread only
+class StagingBuffer {
+	struct Private { explicit Private() = default; };
+	struct Batch {
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		VkFence fence = VK_NULL_HANDLE;
+		VkDeviceSize size = 0; // ring bytes used by this batch, padding included
+		uint32_t copyCount = 0;
+		std::vector<std::pair<VkBuffer, MemoryAllocator::Allocation>> releases; // destroyed once the fence is signaled
+	};
+public:
+	static constexpr VkDeviceSize defaultCapacity = 8 * 1024 * 1024;
+	static constexpr uint32_t batchCount = 4;
+
+	StagingBuffer() = delete;
+	StagingBuffer(const StagingBuffer &) = delete;
+	StagingBuffer(StagingBuffer &&) = delete;
+	StagingBuffer(Private) {}
+	~StagingBuffer();
+
+	static StagingBufferPtr Create(const VkDevice vkDevice, const MemoryAllocatorPtr memoryAllocator, const uint32_t queueFamilyIndex, const VkQueue vkQueue, const VkDeviceSize capacity = defaultCapacity)
+	{
+		auto ptr = std::make_shared<StagingBuffer>(Private());
+		if (!ptr->Init(vkDevice, memoryAllocator, queueFamilyIndex, vkQueue, capacity))
+			return nullptr;
+		return ptr;
+	}
+
+	// Copies data into the ring and records a copy into dstBuffer, the data can be freed right after the call.
+	// The copy is visible to vertex/index fetch of everything submitted to the queue after the next Flush
+	bool Upload(const void *data, const VkDeviceSize size, const VkBuffer dstBuffer, const VkDeviceSize dstOffset = 0);
+	// Device side copies between two buffers, ordered after the uploads recorded before them
+	bool Copy(const VkBuffer srcBuffer, const VkBuffer dstBuffer, std::span<const VkBufferCopy> regions);
+	// Device side copies inside one buffer, regions may overlap, the data goes through the ring
+	bool Move(const VkBuffer buffer, std::span<const VkBufferCopy> regions);
+	// Destroys the buffer once the recorded copies and everything submitted before them are done.
+	// Frames submitted after the next Flush aren't covered, use Core::RetireBuffer for buffers they may draw from
+	void Release(VkBuffer buffer, MemoryAllocator::Allocation allocation);
+	// Submits recorded copies, doesn't wait for them
+	bool Flush();
+	// Submits recorded copies and waits until all of them are done
+	bool Finish();
+
+	VkDeviceSize GetCapacity() const { return capacity; }
+
+private:
+	bool Init(const VkDevice vkDevice, const MemoryAllocatorPtr memoryAllocator, const uint32_t queueFamilyIndex, const VkQueue vkQueue, const VkDeviceSize capacity);
+	bool CreateRing(const VkDeviceSize capacity);
+	void DestroyRing();
+	bool EnsureCapacity(const VkDeviceSize size);
+	bool Reserve(const VkDeviceSize size, VkDeviceSize &offset);
+	void RecordBarrier(const VkPipelineStageFlags srcStage, const VkAccessFlags srcAccess, const VkPipelineStageFlags dstStage, const VkAccessFlags dstAccess);
+	bool BeginBatch();
+	// Frees the space of finished batches, with wait = true blocks until the oldest one is finished
+	bool Retire(const bool wait);
+
+	VkDevice vkDevice = VK_NULL_HANDLE;
+	MemoryAllocatorPtr memoryAllocator;
+	VkQueue vkQueue = VK_NULL_HANDLE;
+	VkCommandPool vkCommandPool = VK_NULL_HANDLE;
+	VkBuffer vkBuffer = VK_NULL_HANDLE;
+	MemoryAllocator::Allocation bufferMemory;
+	uint8_t *mapped = nullptr;
+
+	VkDeviceSize capacity = 0;
+	VkDeviceSize head = 0; // next write position
+	VkDeviceSize used = 0; // bytes between the oldest unfinished batch and head
+
+	std::array<Batch, batchCount> batches;
+	std::deque<uint32_t> inFlight; // submission order
+	std::vector<uint32_t> freeBatches;
+	Batch *currentBatch = nullptr;
+};
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "mesh_atlas.hpp"
+#include "my_types.hpp"
+#include "triangulation/geometry.hpp"
+#include "vertex_format.hpp"
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.h>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+// Draws many copies of a few glyph meshes with instancing.
+// Every glyph is triangulated and uploaded once, a string only adds a small per-glyph instance record.
+// Queued instances are grouped by glyph and drawn with one indirect command per distinct glyph,
+// all of them in a single vkCmdDrawIndexedIndirect call when the device supports multiDrawIndirect.
+// Glyph meshes are stored as CompactVertex, so glyph outlines have to fit into [-1, 1].
+// Expects a pipeline created with Pipeline::Create<CompactVertex, TextRenderer::Instance> (see text-vs.glsl)
+class TextRenderer {
+	struct Private { explicit Private() = default; };
+public:
+	typedef uint32_t GlyphId;
+
+	// Glyph space -> world is position * scale + offset (then Pipeline::Transform and the view), the color is multiplied with the vertex color
+	struct Instance {
+		glm::vec2 offset;
+		glm::vec2 scale;
+		glm::vec4 color;
+
+		static VkVertexInputBindingDescription GetBindingDescription() {
+			VkVertexInputBindingDescription bindingDescription = {
+				.binding = 1,
+				.stride = sizeof(Instance),
+				.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE
+			};
+			return bindingDescription;
+		}
+		static std::vector<VkVertexInputAttributeDescription> GetAttributeDescriptions() {
+			std::vector<VkVertexInputAttributeDescription> attributeDescriptions = {
+				VkVertexInputAttributeDescription{
+					.location = 3,
+					.binding = 1,
+					.format = VK_FORMAT_R32G32_SFLOAT,
+					.offset = offsetof(Instance, offset)
+				},
+				VkVertexInputAttributeDescription{
+					.location = 4,
+					.binding = 1,
+					.format = VK_FORMAT_R32G32_SFLOAT,
+					.offset = offsetof(Instance, scale)
+				},
+				VkVertexInputAttributeDescription{
+					.location = 5,
+					.binding = 1,
+					.format = VK_FORMAT_R32G32B32A32_SFLOAT,
+					.offset = offsetof(Instance, color)
+				}
+			};
+			return attributeDescriptions;
+		}
+	};
+	// One glyph of a run, the offset is in glyph units from the run origin
+	struct Glyph {
+		GlyphId id;
+		glm::vec2 offset;
+	};
+	struct Statistics {
+		uint32_t glyphCount = 0;
+		uint32_t instanceCount = 0; // of the last Draw
+		uint32_t drawCount = 0; // indirect commands of the last Draw
+		uint32_t drawCallCount = 0; // vkCmdDraw* calls of the last Draw
+	};
+
+	TextRenderer() = delete;
+	TextRenderer(const TextRenderer &) = delete;
+	TextRenderer(TextRenderer &&) = delete;
+	TextRenderer(Private) {}
+	~TextRenderer() = default;
+
+	static TextRendererPtr Create(const CorePtr core)
+	{
+		auto ptr = std::make_shared<TextRenderer>(Private());
+		if (!ptr->Init(core))
+			return nullptr;
+		return ptr;
+	}
+
+	// Replaces the glyph if it's already known, fails if the geometry can't be converted to CompactVertex
+	bool AddGlyph(const GlyphId id, const Triangulation::Geometry &geometry);
+	// Every mesh of a CompactVertex bundle, mesh ids become glyph ids. Copied from the mapped file, the bundle can go afterwards
+	bool AddGlyphs(const MeshBundle &bundle);
+	bool HasGlyph(const GlyphId id) const { return glyphs.contains(id); }
+
+	// Unknown glyphs are skipped
+	void Add(const GlyphId id, const Instance &instance);
+	void AddRun(std::span<const Glyph> run, const glm::vec2 origin, const glm::vec2 scale, const glm::vec4 color);
+	// Records everything queued since the last Draw into the current frame and clears the queue.
+	// Binds its own vertex and index buffers, the pipeline has to be bound already.
+	// Glyphs of the same id are drawn together, so overlapping glyphs of different ids aren't drawn in queue order
+	bool Draw();
+
+	Statistics GetStatistics() const { return statistics; }
+
+private:
+	struct Queued {
+		MeshAtlas::Handle handle;
+		Instance instance;
+	};
+
+	bool Init(const CorePtr core);
+	void SetGlyph(const GlyphId id, const MeshAtlas::Handle handle);
+
+	CoreWeakPtr coreWeak;
+	MeshAtlasPtr atlas;
+	std::unordered_map<GlyphId, MeshAtlas::Handle> glyphs;
+	std::vector<Queued> queued;
+	Statistics statistics;
+};
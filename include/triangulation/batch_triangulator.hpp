@@ -0,0 +1,52 @@
+#pragma once
+
+#include "triangulation/geometry.hpp"
+#include "triangulation/outline.hpp"
+#include "triangulation/task_pool.hpp"
+#include "triangulation/triangulator.hpp"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace Triangulation {
+	// Triangulates many independent outlines (a whole font, an svg document) on a TaskPool.
+	// Every thread fills its own scratch geometry, then the results are copied in parallel into
+	// one contiguous vertex and index buffer at offsets from a prefix sum, nothing is shared while writing
+	class BatchTriangulator {
+	public:
+		// Where the outline ended up, indices are relative to firstVertex (draw with it as vertex offset)
+		struct Range {
+			uint32_t firstVertex = 0;
+			uint32_t vertexCount = 0;
+			uint32_t firstIndex = 0;
+			uint32_t indexCount = 0;
+			bool isValid = false; // false if the outline couldn't be triangulated (see Triangulator::Triangulate)
+		};
+
+		explicit BatchTriangulator(TaskPool &pool, const Triangulator::Options &options = {});
+
+		// Replaces the content of geometry and ranges (one per outline), returns false if any outline failed
+		bool Triangulate(std::span<const Outline> outlines, Geometry &geometry, std::vector<Range> &ranges);
+
+		const Triangulator::Options& GetOptions() const { return options; }
+		void SetOptions(const Triangulator::Options &options) { this->options = options; }
+
+	private:
+		struct ThreadData {
+			Triangulator triangulator;
+			Geometry outline; // one outline at a time, so indices start at 0
+			Geometry geometry; // everything the thread did so far
+		};
+		// Per outline, where its geometry is in the thread scratch buffers
+		struct Location {
+			uint32_t thread;
+			uint32_t firstVertex;
+			uint32_t firstIndex;
+		};
+
+		TaskPool &pool;
+		Triangulator::Options options;
+		std::vector<ThreadData> threadData;
+		std::vector<Location> locations;
+	};
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace Triangulation {
+	typedef std::array<glm::vec2, 3> QuadraticBezier;
+	typedef std::array<glm::vec2, 4> CubicBezier;
+
+	inline glm::vec2 Evaluate(const QuadraticBezier &curve, const float t)
+	{
+		const float mt = 1.0f - t;
+		return curve[0] * (mt * mt) + curve[1] * (2.0f * mt * t) + curve[2] * (t * t);
+	}
+	inline glm::vec2 Evaluate(const CubicBezier &curve, const float t)
+	{
+		const float mt = 1.0f - t;
+		return curve[0] * (mt * mt * mt) + curve[1] * (3.0f * mt * mt * t) + curve[2] * (3.0f * mt * t * t) + curve[3] * (t * t * t);
+	}
+
+	// de Casteljau split at t, returns the two halves
+	inline std::array<QuadraticBezier, 2> Split(const QuadraticBezier &curve, const float t)
+	{
+		const auto p01 = curve[0] + (curve[1] - curve[0]) * t;
+		const auto p12 = curve[1] + (curve[2] - curve[1]) * t;
+		const auto p012 = p01 + (p12 - p01) * t;
+		return {
+			QuadraticBezier{ curve[0], p01, p012 },
+			QuadraticBezier{ p012, p12, curve[2] }
+		};
+	}
+	inline std::array<CubicBezier, 2> Split(const CubicBezier &curve, const float t)
+	{
+		const auto p01 = curve[0] + (curve[1] - curve[0]) * t;
+		const auto p12 = curve[1] + (curve[2] - curve[1]) * t;
+		const auto p23 = curve[2] + (curve[3] - curve[2]) * t;
+		const auto p012 = p01 + (p12 - p01) * t;
+		const auto p123 = p12 + (p23 - p12) * t;
+		const auto p0123 = p012 + (p123 - p012) * t;
+		return {
+			CubicBezier{ curve[0], p01, p012, p0123 },
+			CubicBezier{ p0123, p123, p23, curve[3] }
+		};
+	}
+
+	// Parameters of the inflection points inside (0, 1), returns their count
+	uint32_t GetInflections(const CubicBezier &curve, std::array<float, 2> &inflections);
+
+	// Appends quadratics that stay within tolerance of the cubic (split at inflections first,
+	// then into equal pieces, the count comes from the third difference error bound)
+	void ApproximateCubic(const CubicBezier &curve, const float tolerance, std::vector<QuadraticBezier> &quadratics, const uint32_t maxPieceCount = 64);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "triangulation/bezier.hpp"
+#include <cstddef>
+#include <span>
+
+namespace Triangulation {
+	// Batch versions of Evaluate, positions are written as separate x and y arrays.
+	// They use SSE2/AVX/NEON when the compiler targets them and round exactly like Evaluate
+	// (as long as the compiler doesn't contract multiply-adds into FMA), the tail is done with Evaluate itself.
+	// The output spans must be at least as long as the input, returns how many points were written or 0 if they are not
+
+	// One curve at every t
+	std::size_t EvaluateBatch(const QuadraticBezier &curve, std::span<const float> t, std::span<float> x, std::span<float> y);
+	std::size_t EvaluateBatch(const CubicBezier &curve, std::span<const float> t, std::span<float> x, std::span<float> y);
+
+	// One curve at t = 1/n, 2/n ... 1 where n is the output size (the start point is skipped like in Flattener)
+	std::size_t EvaluateSteps(const QuadraticBezier &curve, std::span<float> x, std::span<float> y);
+	std::size_t EvaluateSteps(const CubicBezier &curve, std::span<float> x, std::span<float> y);
+
+	// Every curve at the same t
+	std::size_t EvaluateBatch(std::span<const QuadraticBezier> curves, const float t, std::span<float> x, std::span<float> y);
+	std::size_t EvaluateBatch(std::span<const CubicBezier> curves, const float t, std::span<float> x, std::span<float> y);
+
+	// Name of the instruction set the batch functions were compiled for
+	const char* GetBatchInstructionSet();
+}
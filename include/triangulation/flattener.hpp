@@ -0,0 +1,43 @@
+#pragma once
+
+#include "triangulation/bezier.hpp"
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace Triangulation {
+	// Splits curves into line segments that stay within tolerance after the transform is applied.
+	// The segment count comes from Wang's formula, so no recursion or per-segment error checks are needed
+	class Flattener {
+	public:
+		static constexpr uint32_t maxSegmentCount = 1024;
+
+		Flattener() = default;
+		// transform - outline space to pixels (affine, column-major), tolerance - in pixels
+		Flattener(const glm::mat3 &transform, const float tolerance);
+
+		uint32_t GetSegmentCount(const QuadraticBezier &curve) const;
+		uint32_t GetSegmentCount(const CubicBezier &curve) const;
+
+		// Writes the end points of GetSegmentCount(curve) segments (start point excluded, end point included)
+		// in outline space, returns how many points were written or 0 if the output is too small.
+		// Forward differencing, the rounding error grows along the curve (within 1e-4 of the size of the curve at maxSegmentCount)
+		std::size_t Flatten(const QuadraticBezier &curve, std::span<glm::vec2> output) const;
+		std::size_t Flatten(const CubicBezier &curve, std::span<glm::vec2> output) const;
+		// The same segments as separate x and y arrays, every point evaluated directly with the SIMD batch kernels
+		// (EvaluateSteps), so they round like Evaluate. Triangulator and Stroker flatten with these
+		std::size_t Flatten(const QuadraticBezier &curve, std::span<float> x, std::span<float> y) const;
+		std::size_t Flatten(const CubicBezier &curve, std::span<float> x, std::span<float> y) const;
+
+		// Largest stretch of the transform, converts pixel distances to outline units
+		float GetScale() const { return scale; }
+		// The same for any transform: spectral norm of its 2x2 part
+		static float GetTransformScale(const glm::mat3 &transform);
+		float GetTolerance() const { return tolerance; }
+
+	private:
+		float scale = 1.0f;
+		float tolerance = 0.25f;
+	};
+}
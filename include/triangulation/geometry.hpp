@@ -0,0 +1,35 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace Triangulation {
+	// position.z tells quadratic-spline-fs which part of the triangle to fill,
+	// curve triangles have uv (0,0), (0.5,0), (1,1) on start, control and end points
+	namespace CurveSign {
+		constexpr float Solid = 0.0f; // whole triangle
+		constexpr float Convex = 1.0f; // between the chord and the curve (u^2 - v < 0)
+		constexpr float Concave = -1.0f; // between the curve and the control point (u^2 - v > 0)
+		constexpr float Fringe = 2.0f; // edge fringe, uv.x is the signed distance to the edge in outline units (positive outside)
+	}
+
+	// Same memory layout as Mesh::Vertex, so the output can be uploaded as is
+	struct Vertex {
+		glm::vec3 position;
+		glm::vec4 color;
+		glm::vec2 uv;
+	};
+	typedef std::vector<Vertex> Vertices;
+	typedef std::vector<uint16_t> Indices;
+
+	struct Geometry {
+		Vertices vertices;
+		Indices indices;
+
+		void Clear() {
+			vertices.clear();
+			indices.clear();
+		}
+	};
+}
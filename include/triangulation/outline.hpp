@@ -0,0 +1,70 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Triangulation {
+	// Single contour, stored as a command stream plus the points they consume:
+	// Move - 1 point, Line - 1 point, Quad - 2 points (control, end), Cubic - 3 points (control, control, end).
+	// Fills always close it, strokes only when Close was called (otherwise the ends get caps)
+	class Contour {
+	public:
+		enum class Command : uint8_t {
+			Move,
+			Line,
+			Quad,
+			Cubic
+		};
+
+		void MoveTo(const glm::vec2 &point);
+		void LineTo(const glm::vec2 &point);
+		void QuadTo(const glm::vec2 &control, const glm::vec2 &point);
+		void CubicTo(const glm::vec2 &control1, const glm::vec2 &control2, const glm::vec2 &point);
+		void Close() { isClosed = true; }
+
+		const std::vector<Command>& GetCommands() const { return commands; }
+		const std::vector<glm::vec2>& GetPoints() const { return points; }
+		bool IsEmpty() const { return commands.size() < 2; }
+		bool IsClosed() const { return isClosed; }
+
+		// Exact, -0.0 and 0.0 are the same point
+		bool operator==(const Contour&) const = default;
+
+		static constexpr std::size_t GetPointCount(const Command command) {
+			switch (command) {
+			case Command::Quad: return 2;
+			case Command::Cubic: return 3;
+			default: return 1;
+			}
+		}
+
+	private:
+		std::vector<Command> commands;
+		std::vector<glm::vec2> points;
+		bool isClosed = false;
+	};
+
+	// Set of contours filled together (glyph or svg path), see Triangulator::FillRule
+	class Outline {
+	public:
+		// Each MoveTo starts a new contour, contours are closed implicitly
+		void MoveTo(const glm::vec2 &point);
+		void LineTo(const glm::vec2 &point);
+		void QuadTo(const glm::vec2 &control, const glm::vec2 &point);
+		void CubicTo(const glm::vec2 &control1, const glm::vec2 &control2, const glm::vec2 &point);
+		void Close();
+
+		const std::vector<Contour>& GetContours() const { return contours; }
+		bool IsEmpty() const;
+
+		bool operator==(const Outline&) const = default;
+
+	private:
+		Contour& GetCurrentContour();
+
+		std::vector<Contour> contours;
+		bool isClosed = true;
+	};
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "triangulation/flattener.hpp"
+#include "triangulation/geometry.hpp"
+#include "triangulation/outline.hpp"
+#include "triangulation/triangulator.hpp"
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace Triangulation {
+	// Turns the contours of an outline into the triangles of their stroke (svg stroke-*).
+	// Curves are flattened, every triangle is solid, so both spline pipeline variants can draw it.
+	// Joins and caps don't overlap the segments they connect, except where the inner corner of a join would reach past
+	// half of a segment (sharp turns between short segments): the segments overlap around the point then and the join
+	// is fanned from the point itself. The path crossing itself overlaps too, translucent strokes blend twice there
+	class Stroker {
+	public:
+		enum class Join : uint8_t {
+			Miter, // bevel past the miter limit
+			Round,
+			Bevel
+		};
+		enum class Cap : uint8_t {
+			Butt,
+			Round,
+			Square
+		};
+		struct Options {
+			// In outline units
+			float width = 1.0f;
+			Join join = Join::Miter;
+			Cap cap = Cap::Butt;
+			// Longest miter as a multiple of the width, like svg stroke-miterlimit
+			float miterLimit = 4.0f;
+			// Lengths of dashes and gaps in outline units, repeated twice if odd, empty for a solid stroke.
+			// The pattern starts over on every contour
+			std::vector<float> dashes = {};
+			float dashOffset = 0.0f;
+			// Outline space to pixels, used for the flattening and round join errors
+			glm::mat3 transform = glm::mat3(1.0f);
+			// Max distance in pixels between a curve (or an arc) and its line segments
+			float tolerance = 0.25f;
+			glm::vec4 color = { 1.0f, 1.0f, 1.0f, 1.0f };
+			Triangulator::Winding winding = Triangulator::Winding::CounterClockwise;
+		};
+
+		Stroker() = default;
+		explicit Stroker(const Options &options) : options(options) {}
+
+		// Appends the stroke to the geometry, returns false (and leaves the geometry as it was) if it doesn't fit into 16-bit indices
+		bool Stroke(const Outline &outline, Geometry &geometry);
+
+		const Options& GetOptions() const { return options; }
+		void SetOptions(const Options &options) { this->options = options; }
+
+	private:
+		void Flatten(const Contour &contour);
+		void StrokeDashed(const bool isClosed, Geometry &geometry);
+		void StrokePolyline(std::span<const glm::vec2> points, const bool isClosed, Geometry &geometry);
+		// Emits the join at point (the pair of vertices ending the incoming segment and the pair starting the outgoing one)
+		void EmitJoin(const glm::vec2 &point, const glm::vec2 &directionIn, const glm::vec2 &directionOut, const float lengthIn, const float lengthOut,
+			Geometry &geometry, uint32_t (&in)[2], uint32_t (&out)[2]);
+		// Cap on the side of direction, left and right are the vertices across the stroke end
+		void EmitCap(const glm::vec2 &point, const glm::vec2 &direction, const uint32_t left, const uint32_t right, Geometry &geometry);
+		// Fan around pivot from the vertex at center + from, turning by angle, to the vertex to
+		void EmitArc(const glm::vec2 &center, const uint32_t pivot, const uint32_t from, const glm::vec2 &fromOffset, const float angle, const uint32_t to, Geometry &geometry);
+		uint32_t AddVertex(const glm::vec2 &position, Geometry &geometry) const;
+		void AddTriangle(const uint32_t a, const uint32_t b, const uint32_t c, Geometry &geometry) const;
+
+		Options options;
+		Flattener flattener;
+		float halfWidth = 0.5f;
+		float maxArcStep = 0.0f; // radians, from the tolerance and the on-screen width
+		// Scratch buffers, reused between calls
+		std::vector<glm::vec2> points;
+		std::vector<glm::vec2> dashPoints;
+		std::vector<float> curveX, curveY; // one flattened curve
+	};
+}
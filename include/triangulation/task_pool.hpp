@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Triangulation {
+	// Fixed set of worker threads for data-parallel loops. Every thread owns a range of indices
+	// and takes them from the front, idle threads steal the back half of someone else's range,
+	// so uneven items (a CJK glyph next to a dot) don't leave cores waiting
+	class TaskPool {
+	public:
+		// Called with (index, thread index), thread index is in [0, GetThreadCount())
+		typedef std::function<void(std::size_t, uint32_t)> Function;
+
+		// threadCount includes the calling thread, 0 means one per hardware thread
+		explicit TaskPool(const uint32_t threadCount = 0);
+		~TaskPool();
+		TaskPool(const TaskPool&) = delete;
+		TaskPool& operator=(const TaskPool&) = delete;
+
+		// Runs function for every index in [0, count) and returns when all of them are done,
+		// the calling thread works as thread 0. Not reentrant
+		void ParallelFor(const std::size_t count, const Function &function);
+
+		uint32_t GetThreadCount() const { return threadCount; }
+
+	private:
+		// [begin, end) packed into one word so both ends change with a single compare-exchange
+		struct alignas(64) Range {
+			std::atomic<uint64_t> bounds;
+		};
+		static constexpr uint64_t Pack(const uint32_t begin, const uint32_t end) { return static_cast<uint64_t>(end) << 32 | begin; }
+
+		void WorkerLoop(const uint32_t threadIndex);
+		void Work(const uint32_t threadIndex);
+		bool Pop(const uint32_t threadIndex, uint32_t &index);
+		bool Steal(const uint32_t threadIndex);
+
+		uint32_t threadCount;
+		std::unique_ptr<Range[]> ranges;
+		std::vector<std::thread> threads;
+
+		std::mutex mutex;
+		std::condition_variable startCondition;
+		std::condition_variable doneCondition;
+		const Function *function = nullptr;
+		uint64_t generation = 0;
+		uint32_t busyCount = 0;
+		bool isStopping = false;
+	};
+}
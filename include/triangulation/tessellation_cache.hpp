@@ -0,0 +1,97 @@
+#pragma once
+
+#include "triangulation/geometry.hpp"
+#include "triangulation/outline.hpp"
+#include "triangulation/triangulator.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace Triangulation {
+	// Triangulated outlines kept in memory, so repeated glyphs (and the same glyph at a similar size) are only done once.
+	// Keyed by a content hash of the outline, a hash of the options that change the output and a tolerance bucket:
+	// the tolerance in outline units (pixels / transform scale) in steps of a quarter octave, so a glyph drawn
+	// at 16 and at 17 pixels shares one entry. Misses are triangulated with the finest tolerance of their bucket,
+	// so an entry is good enough for every request that lands in it. The fringe width is hashed in outline units too
+	// (rounded to 1/16 octave), the fringe of an entry is as wide on screen as requested within that.
+	// Lookups of different threads run in parallel, they only take the lock exclusively on a miss.
+	// Entries are evicted least recently used first once the memory budget is exceeded,
+	// geometries handed out stay alive as long as someone holds them
+	class TessellationCache {
+	public:
+		// Only hashes: entries keep a copy of their outline to tell a collision from a hit (a collision is a miss).
+		// The options hash isn't checked, it covers a handful of enums and the color, of which few combinations are in use,
+		// two of them colliding in 64 bits isn't a practical concern
+		struct Key {
+			uint64_t outlineHash = 0;
+			uint64_t optionsHash = 0;
+			int32_t toleranceBucket = 0;
+
+			bool operator==(const Key&) const = default;
+		};
+		struct Statistics {
+			uint64_t hitCount = 0;
+			uint64_t missCount = 0;
+			uint64_t evictionCount = 0;
+			std::size_t entryCount = 0;
+			std::size_t memorySize = 0;
+			std::size_t memoryBudget = 0;
+		};
+		typedef std::shared_ptr<const Geometry> GeometryPtr;
+
+		static constexpr std::size_t defaultMemoryBudget = 64 * 1024 * 1024;
+		static constexpr int32_t bucketsPerOctave = 4;
+
+		explicit TessellationCache(const std::size_t memoryBudget = defaultMemoryBudget) : memoryBudget(memoryBudget) {}
+		TessellationCache(const TessellationCache&) = delete;
+		TessellationCache& operator=(const TessellationCache&) = delete;
+
+		// Cached geometry of the outline, triangulated on a miss. nullptr if the triangulation failed (failures aren't cached)
+		GeometryPtr Triangulate(const Outline &outline, const Triangulator::Options &options);
+
+		static Key MakeKey(const Outline &outline, const Triangulator::Options &options);
+		// nullptr on a miss, the outline is the one the key was made of
+		GeometryPtr Find(const Key &key, const Outline &outline);
+		// Keeps the existing entry if another thread inserted the key first.
+		// If it holds another outline (hash collision), the geometry is returned without being cached
+		GeometryPtr Insert(const Key &key, const Outline &outline, Geometry &&geometry);
+
+		void Clear();
+		void SetMemoryBudget(const std::size_t memoryBudget);
+		Statistics GetStatistics() const;
+
+		static uint64_t Hash(const Outline &outline);
+		static int32_t GetToleranceBucket(const Triangulator::Options &options);
+		// Pixel tolerance to triangulate with so the result satisfies every request of the bucket
+		static float GetBucketTolerance(const int32_t toleranceBucket, const Triangulator::Options &options);
+
+	private:
+		struct KeyHash {
+			std::size_t operator()(const Key &key) const;
+		};
+		struct Entry {
+			Outline outline; // compared on a hit, the key is only its hash
+			GeometryPtr geometry;
+			std::size_t size = 0;
+			mutable std::atomic<uint64_t> lastUse = 0; // written by readers under the shared lock
+		};
+
+		static std::size_t GetMemorySize(const Geometry &geometry);
+		static std::size_t GetMemorySize(const Outline &outline);
+		// Drops least recently used entries until the cache is a bit under the budget, expects the exclusive lock
+		void Evict();
+
+		mutable std::shared_mutex mutex;
+		std::unordered_map<Key, Entry, KeyHash> entries;
+		std::size_t memorySize = 0;
+		std::size_t memoryBudget;
+
+		std::atomic<uint64_t> useClock = 0;
+		std::atomic<uint64_t> hitCount = 0;
+		std::atomic<uint64_t> missCount = 0;
+		uint64_t evictionCount = 0;
+	};
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "triangulation/bezier.hpp"
+#include "triangulation/flattener.hpp"
+#include "triangulation/geometry.hpp"
+#include "triangulation/outline.hpp"
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace Triangulation {
+	struct RingNesting;
+
+	class Triangulator {
+	public:
+		enum class Mode : uint8_t {
+			Flatten, // curves are split into line segments, everything is solid triangles
+			Curves // one Loop-Blinn triangle per quadratic segment (cubics are approximated) plus the interior polygon, for quadratic-spline shaders
+		};
+		// Which areas enclosed by the contours are filled. Contours may nest and touch but not cross each other
+		enum class FillRule : uint8_t {
+			EvenOdd, // inside an odd number of contours
+			NonZero // the directions of the contours around it don't cancel out (svg nonzero, TrueType and CFF glyphs)
+		};
+		enum class Winding : uint8_t {
+			CounterClockwise, // positive signed area in outline space (front facing for the default pipeline in NDC)
+			Clockwise
+		};
+		struct Options {
+			Mode mode = Mode::Flatten;
+			// Outline space to pixels, only used to measure the error
+			glm::mat3 transform = glm::mat3(1.0f);
+			// Max distance in pixels between a curve and its line segments (Flatten mode)
+			// or between a cubic and the quadratics replacing it (Curves mode)
+			float tolerance = 0.25f;
+			// Curves mode: how many times overlapping curve triangles may be halved
+			uint32_t maxCurveSubdivisions = 4;
+			glm::vec4 color = { 1.0f, 1.0f, 1.0f, 1.0f };
+			Winding winding = Winding::CounterClockwise;
+			FillRule fillRule = FillRule::EvenOdd;
+			// Width in pixels of the fringe around every straight edge, half inside and half outside of it,
+			// shaded by its distance to the edge (CurveSign::Fringe) for coverage antialiasing without MSAA.
+			// Curves mode only adds the outer half along its line segments, the curve triangles are antialiased by the shader.
+			// 0 leaves the edges hard, which is what multisampled pipelines want
+			float fringeWidth = 0.0f;
+		};
+
+		Triangulator() = default;
+		explicit Triangulator(const Options &options) : options(options) {}
+
+		// Appends the filled outline to the geometry. Returns false (and leaves the geometry as it was) if it doesn't fit into 16-bit indices
+		// or it can't be triangulated (contours crossing each other, self-intersecting contours the ear clipping gives up on)
+		bool Triangulate(const Outline &outline, Geometry &geometry);
+
+		const Options& GetOptions() const { return options; }
+		void SetOptions(const Options &options) { this->options = options; }
+
+	private:
+		struct Segment {
+			QuadraticBezier points; // lines keep the middle point as control
+			uint32_t contour;
+			bool isCurve;
+			bool isConcave;
+		};
+
+		bool TriangulateFlattened(const Outline &outline, Geometry &geometry);
+		bool TriangulateCurves(const Outline &outline, Geometry &geometry);
+		void Flatten(const Contour &contour);
+		void CollectSegments(const Contour &contour, const uint32_t contourIndex);
+		void ResolveCurveOverlaps();
+		bool ClassifyCurves(const uint32_t contourCount);
+		bool EmitInterior(Geometry &geometry, const std::size_t extraVertexCount);
+		void EmitFringes(Geometry &geometry, const std::vector<RingNesting> &nesting, const float innerDistance, const float outerDistance);
+
+		Options options;
+		Flattener flattener;
+		float snapEpsilon = 0.0f; // points of the outline closer than this are the same point
+		// Scratch buffers, reused between calls
+		std::vector<glm::vec2> points;
+		std::vector<float> curveX, curveY; // one flattened curve
+		std::vector<std::vector<uint32_t>> rings;
+		std::vector<uint32_t> triangles;
+		std::vector<Segment> segments;
+		std::vector<Segment> splitSegments;
+		std::vector<QuadraticBezier> quadratics;
+		std::vector<glm::vec2> fringeOffsets; // per point, from the inner to the outer side of the fringe
+		std::vector<bool> isFringed; // per point, whether the edge to the next one gets a fringe (empty for all)
+	};
+}
@@ -1,10 +1,8 @@
 #pragma once
 
 #include <vulkan/vk_enum_string_helper.h>
-#include <cstdint>
-#include <filesystem>
 #include <iostream>
-#include <vector>
+#include <string>
 
 #ifdef __INLINE_CHECK_VK_RESULT__
 constexpr bool print_vk_result(std::string name, VkResult result)
@@ -19,5 +17,3 @@ constexpr bool print_vk_result(std::string name, VkResult result)
 bool print_vk_result(std::string name, VkResult result);
 #endif // __INLINE_CHECK_VK_RESULT__
 #define CHECK_VK_RESULT(result) print_vk_result(#result, result)
-
-std::vector<uint8_t> ReadFile(const std::filesystem::path& filePath);
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "triangulation/geometry.hpp"
+#include <vulkan/vulkan.h>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+// Anything Pipeline::Create, Mesh::Create and MeshAtlas take as a vertex: describes its own input layout
+// and can be made from a triangulator vertex (returns false if the vertex isn't representable)
+template <typename VertexType>
+concept VertexFormat = std::is_trivially_copyable_v<VertexType> && requires(const Triangulation::Vertex &vertex, VertexType &converted) {
+	{ VertexType::GetBindingDescription() } -> std::same_as<VkVertexInputBindingDescription>;
+	{ VertexType::GetAttributeDescriptions() } -> std::same_as<std::vector<VkVertexInputAttributeDescription>>;
+	{ VertexType::FromVertex(vertex, converted) } -> std::same_as<bool>;
+};
+
+// 12 bytes instead of the 36 of Mesh::Vertex, for outlines that fit into NDC (or into a unit box scaled per instance):
+// snorm16 position, RGBA8 color and the Loop-Blinn coordinates as small integer codes.
+// Curve triangles only ever use the uv corners (0, 0), (0.5, 0) and (1, 1), so uv * 2 is stored,
+// the curve sign (Mesh::Vertex::position.z) rides along in the same attribute. Fringe vertices store the side of their edge
+// (-1, 0 or 1) as u, the shader only needs the distance up to a constant factor.
+// Use with shaders that read location 2 as ivec4 (see text-vs.glsl)
+struct CompactVertex {
+	int16_t position[2]; // snorm, [-1, 1]
+	uint8_t color[4]; // unorm
+	int8_t curve[4]; // u * 2 (fringes: side of the edge), v * 2, curve sign, unused
+
+	static VkVertexInputBindingDescription GetBindingDescription() {
+		VkVertexInputBindingDescription bindingDescription = {
+			.binding = 0,
+			.stride = sizeof(CompactVertex),
+			.inputRate = VK_VERTEX_INPUT_RATE_VERTEX
+		};
+		return bindingDescription;
+	}
+	static std::vector<VkVertexInputAttributeDescription> GetAttributeDescriptions() {
+		// All three formats are mandatory for vertex buffers
+		std::vector<VkVertexInputAttributeDescription> attributeDescriptions = {
+			VkVertexInputAttributeDescription{
+				.location = 0,
+				.binding = 0,
+				.format = VK_FORMAT_R16G16_SNORM,
+				.offset = offsetof(CompactVertex, position)
+			},
+			VkVertexInputAttributeDescription{
+				.location = 1,
+				.binding = 0,
+				.format = VK_FORMAT_R8G8B8A8_UNORM,
+				.offset = offsetof(CompactVertex, color)
+			},
+			VkVertexInputAttributeDescription{
+				.location = 2,
+				.binding = 0,
+				.format = VK_FORMAT_R8G8B8A8_SINT,
+				.offset = offsetof(CompactVertex, curve)
+			}
+		};
+		return attributeDescriptions;
+	}
+	// Fails for positions outside of [-1, 1] and for curve uvs other than the corners
+	static bool FromVertex(const Triangulation::Vertex &vertex, CompactVertex &compact);
+};
+static_assert(sizeof(CompactVertex) == 12);
+
+void ReportUnconvertibleVertex(const size_t index, const Triangulation::Vertex &vertex);
+// Converts all vertices or none, the failing vertex is reported to std::cerr
+template <VertexFormat VertexType>
+bool ConvertVertices(std::span<const Triangulation::Vertex> vertices, std::vector<VertexType> &converted)
+{
+	converted.resize(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++) {
+		if (!VertexType::FromVertex(vertices[i], converted[i])) {
+			ReportUnconvertibleVertex(i, vertices[i]);
+			converted.clear();
+			return false;
+		}
+	}
+	return true;
+}
+
+// GPU memory a geometry takes in the given format, vertices and indices
+template <VertexFormat VertexType>
+constexpr size_t GetGeometrySize(const Triangulation::Geometry &geometry)
+{
+	return sizeof(VertexType) * geometry.vertices.size() + sizeof(Triangulation::Indices::value_type) * geometry.indices.size();
+}
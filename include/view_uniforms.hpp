@@ -0,0 +1,63 @@
+#pragma once
+
+#include "memory_allocator.hpp"
+#include "my_types.hpp"
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.h>
+#include <cstdint>
+
+// The per-frame camera every pipeline reads: set 0, binding 0, a uniform buffer with a slice per frame in flight
+// picked with a dynamic offset. Panning and zooming only change this, vertex data stays as it is.
+// Owned by Core, which writes the slice of the frame being recorded right before submitting it
+class ViewUniforms {
+	struct Private { explicit Private() = default; };
+public:
+	// std140, matches View in the vertex shaders
+	struct Data {
+		glm::mat4 transform; // world -> NDC
+		glm::vec2 viewportSize; // in pixels
+		glm::vec2 reserved;
+	};
+	static_assert(sizeof(Data) == 80);
+
+	ViewUniforms() = delete;
+	ViewUniforms(const ViewUniforms &) = delete;
+	ViewUniforms(ViewUniforms &&) = delete;
+	ViewUniforms(Private) {}
+	~ViewUniforms();
+
+	static ViewUniformsPtr Create(const VkDevice vkDevice, const MemoryAllocatorPtr memoryAllocator, const VkDeviceSize minUniformBufferOffsetAlignment)
+	{
+		auto ptr = std::make_shared<ViewUniforms>(Private());
+		if (!ptr->Init(vkDevice, memoryAllocator, minUniformBufferOffsetAlignment))
+			return nullptr;
+		return ptr;
+	}
+
+	// Used from the frame being recorded on, the last value set before the frame is submitted wins
+	void SetTransform(const glm::mat4 &transform) { data.transform = transform; }
+	const glm::mat4& GetTransform() const { return data.transform; }
+
+	// Only while no frame is in flight (Core::InitVulkanFrames), the buffer is replaced if it has to grow
+	bool SetFrameCount(const uint32_t frameCount);
+	// Writes the current data into the slice of the frame
+	void Update(const uint32_t frameIndex, const uint32_t width, const uint32_t height);
+	// Binds the slice of the frame to set 0, any pipeline layout made by Pipeline works
+	void Bind(const VkCommandBuffer vkCommandBuffer, const VkPipelineLayout vkPipelineLayout, const uint32_t frameIndex) const;
+
+	VkDescriptorSetLayout GetDescriptorSetLayout() const { return vkDescriptorSetLayout; }
+
+private:
+	bool Init(const VkDevice vkDevice, const MemoryAllocatorPtr memoryAllocator, const VkDeviceSize minUniformBufferOffsetAlignment);
+
+	VkDevice vkDevice = VK_NULL_HANDLE;
+	MemoryAllocatorPtr memoryAllocator;
+	VkDescriptorSetLayout vkDescriptorSetLayout = VK_NULL_HANDLE;
+	VkDescriptorPool vkDescriptorPool = VK_NULL_HANDLE;
+	VkDescriptorSet vkDescriptorSet = VK_NULL_HANDLE;
+	VkBuffer buffer = VK_NULL_HANDLE;
+	MemoryAllocator::Allocation memory;
+	VkDeviceSize sliceSize = 0; // sizeof(Data) rounded up to minUniformBufferOffsetAlignment
+	uint32_t frameCount = 0;
+	Data data = { .transform = glm::mat4(1.0f), .viewportSize = { 0.0f, 0.0f }, .reserved = { 0.0f, 0.0f } };
+};
@@ -1,22 +1,51 @@
 #include "application.hpp"
 #include "core.hpp"
 #include "pipeline.hpp"
+#include "pipeline_key.hpp"
+#include "pipeline_set.hpp"
 #include "mesh.hpp"
+#include "mesh_atlas.hpp"
+#include "mesh_bundle.hpp"
+#include "text_renderer.hpp"
+#include "triangulation/bezier.hpp"
+#include "triangulation/flattener.hpp"
+#include "triangulation/stroker.hpp"
+#include "triangulation/task_pool.hpp"
+#include "triangulation/tessellation_cache.hpp"
+#include "triangulation/triangulator.hpp"
+#include <atomic>
 #include <filesystem>
 #include <memory>
+#include <span>
 #include <vector>
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/rotate_vector.hpp>
 
 namespace fs = std::filesystem;
 
 namespace {
+	fs::path assetDirectory = "../assets";
+	PipelineSetPtr splineShaders;
+	PipelineSetPtr textShaders;
 	PipelinePtr pipeline;
 	MeshPtr meshSplineSegments;
 	PipelinePtr pipelineSpline;
-	MeshPtr meshSplineTriangle;
-	MeshPtr meshSplineTriangle1;
-	MeshPtr meshSplineTriangle2;
+	// Everything drawn with pipelineSpline shares one pair of buffers
+	MeshAtlasPtr splineAtlas;
+	MeshAtlas::Handle meshSplineTriangle = MeshAtlas::invalidHandle;
+	MeshAtlas::Handle meshSplineTriangle1 = MeshAtlas::invalidHandle;
+	MeshAtlas::Handle meshSplineTriangle2 = MeshAtlas::invalidHandle;
+	MeshAtlas::Handle meshOutline = MeshAtlas::invalidHandle;
+	MeshAtlas::Handle meshCubicOutline = MeshAtlas::invalidHandle;
+	PipelinePtr pipelineText;
+	TextRendererPtr textRenderer;
+	// Records the layers of a frame into secondary command buffers in parallel
+	std::unique_ptr<Triangulation::TaskPool> recordingPool;
+	// Glyphs re-added at a similar size (after a resize, by another renderer) aren't triangulated again
+	Triangulation::TessellationCache tessellationCache;
+
+	enum GlyphIds : TextRenderer::GlyphId {
+		GlyphRing,
+		GlyphHeart
+	};
 
 	//// Quad Data
 	//const Mesh::Vertices vertices = {
@@ -30,120 +59,235 @@ namespace {
 	//	0, 1, 2, 2, 3, 0
 	//};
 	// Triangle Data
+	// z is Triangulation::CurveSign
 	const Mesh::Vertices splineVertices = {
-		{.position = {-0.5f, 0.5f, 0.0f}, .color = {0.5f, 0.5f, 0.5f, 1.0f}, .uv = {0.0f, 0.0f}},
-		{.position = {0.0f, -0.5f, 0.0f}, .color = {0.5f, 0.5f, 0.5f, 1.0f}, .uv = {0.5f, 0.0f}},
-		{.position = {0.5f, 0.5f, 0.0f}, .color = {0.5f, 0.5f, 0.5f, 1.0f}, .uv = {1.0f, 1.0f}},
+		{.position = {-0.5f, 0.5f, 1.0f}, .color = {0.5f, 0.5f, 0.5f, 1.0f}, .uv = {0.0f, 0.0f}},
+		{.position = {0.0f, -0.5f, 1.0f}, .color = {0.5f, 0.5f, 0.5f, 1.0f}, .uv = {0.5f, 0.0f}},
+		{.position = {0.5f, 0.5f, 1.0f}, .color = {0.5f, 0.5f, 0.5f, 1.0f}, .uv = {1.0f, 1.0f}},
 	};
 	const Mesh::Indices splineIndices = {
 		0, 1, 2
 	};
+
+	// Ring made of quadratics
+	Triangulation::Outline MakeRingOutline(const glm::vec2 center, const float outerRadius, const float innerRadius)
+	{
+		Triangulation::Outline outline;
+		for (const auto radius : { outerRadius, innerRadius }) {
+			outline.MoveTo(center + glm::vec2{ 0.0f, -radius });
+			outline.QuadTo(center + glm::vec2{ radius, -radius }, center + glm::vec2{ radius, 0.0f });
+			outline.QuadTo(center + glm::vec2{ radius, radius }, center + glm::vec2{ 0.0f, radius });
+			outline.QuadTo(center + glm::vec2{ -radius, radius }, center + glm::vec2{ -radius, 0.0f });
+			outline.QuadTo(center + glm::vec2{ -radius, -radius }, center + glm::vec2{ 0.0f, -radius });
+			outline.Close();
+		}
+		return outline;
+	}
+
+	// Heart made of cubics, control points reach 1.2 * size from the center
+	Triangulation::Outline MakeHeartOutline(const glm::vec2 center, const float size)
+	{
+		Triangulation::Outline outline;
+		const auto point = [&center, size](const float x, const float y) { return center + glm::vec2{ x, y } * size; };
+		outline.MoveTo(point(0.0f, 1.0f));
+		outline.CubicTo(point(-0.6f, 0.4f), point(-1.2f, -0.2f), point(-0.9f, -0.7f));
+		outline.CubicTo(point(-0.6f, -1.2f), point(-0.1f, -1.0f), point(0.0f, -0.5f));
+		outline.CubicTo(point(0.1f, -1.0f), point(0.6f, -1.2f), point(0.9f, -0.7f));
+		outline.CubicTo(point(1.2f, -0.2f), point(0.6f, 0.4f), point(0.0f, 1.0f));
+		outline.Close();
+		return outline;
+	}
+
+	// Changes with the outlines and with everything about their triangulation (options, tolerance bucket, fill rule...)
+	uint64_t GetGlyphsContentKey(std::span<const std::pair<TextRenderer::GlyphId, Triangulation::Outline>> glyphOutlines, const Triangulation::Triangulator::Options &options)
+	{
+		constexpr uint64_t hashPrime = 1099511628211ull;
+		uint64_t key = 14695981039346656037ull;
+		const auto add = [&key](const uint64_t value) { key = (key ^ value) * hashPrime; };
+		for (const auto &[id, outline] : glyphOutlines) {
+			const auto cacheKey = Triangulation::TessellationCache::MakeKey(outline, options);
+			add(id);
+			add(cacheKey.outlineHash);
+			add(cacheKey.optionsHash);
+			add(static_cast<uint32_t>(cacheKey.toleranceBucket));
+		}
+		return key;
+	}
+}
+
+void Application::SetAssetDirectory(const std::filesystem::path &directory)
+{
+	assetDirectory = directory;
 }
 
 bool Application::OnInitialize(const CorePtr core)
 {
-	pipeline = Pipeline::Create<Mesh::Vertex>(core, fs::path("../assets/shaders/simple-vs.spv"), fs::path("../assets/shaders/simple-fs.spv"));
-	if (!pipeline)
+	// One thread per layer of OnFrame at most
+	recordingPool = std::make_unique<Triangulation::TaskPool>(2);
+
+	// Solid lines and curves come from the same shaders, the variants only differ in specialization constants
+	const auto shaderDirectory = assetDirectory / "shaders";
+	splineShaders = PipelineSet::Create<Mesh::Vertex>(core, shaderDirectory / "quadratic-spline-vs.spv", shaderDirectory / "quadratic-spline-fs.spv");
+	textShaders = PipelineSet::Create<CompactVertex, TextRenderer::Instance>(core, shaderDirectory / "text-vs.spv", shaderDirectory / "quadratic-spline-fs.spv");
+	if (!splineShaders || !textShaders)
+		return false;
+	constexpr auto curveKey = PipelineKey();
+	constexpr auto solidKey = PipelineKey().WithCurve(PipelineKey::Curve::Solid);
+	// Compiled on worker threads, all variants of a set at once
+	const PipelineKey splineKeys[] = { curveKey, solidKey };
+	if (!splineShaders->Prepare(splineKeys) || !textShaders->Prepare(std::span(&curveKey, 1)))
 		return false;
-	pipelineSpline = Pipeline::Create<Mesh::Vertex>(core, fs::path("../assets/shaders/quadratic-spline-vs.spv"), fs::path("../assets/shaders/quadratic-spline-fs.spv"));
-	if (!pipelineSpline)
+	pipeline = splineShaders->Get(solidKey);
+	pipelineSpline = splineShaders->Get(curveKey);
+	pipelineText = textShaders->Get(curveKey);
+
+	// Curves are flattened against pixels, not NDC units
+	const auto width = static_cast<float>(core->GetWidth());
+	const auto height = static_cast<float>(core->GetHeight());
+	const glm::mat3 ndcToPixels = {
+		{ width * 0.5f, 0.0f, 0.0f },
+		{ 0.0f, height * 0.5f, 0.0f },
+		{ width * 0.5f, height * 0.5f, 1.0f }
+	};
+
+	splineAtlas = MeshAtlas::Create(core);
+	if (!splineAtlas)
 		return false;
 
-	meshSplineTriangle = Mesh::Create(core, splineVertices, splineIndices);
-	if (!meshSplineTriangle)
+	meshSplineTriangle = splineAtlas->Add(splineVertices, splineIndices);
+	if (meshSplineTriangle == MeshAtlas::invalidHandle)
 		return false;
 
 	// Split into two beziers
 	{
-		double t = 0.5;
-		auto v1 = (splineVertices[1].position - splineVertices[0].position);
-		auto p1 = v1;
-		p1 *= t;
-		p1 += splineVertices[0].position;
-		auto v2 = (splineVertices[2].position - splineVertices[1].position);
-		auto p2 = v2;
-		p2 *= t;
-		p2 += splineVertices[1].position;
-		auto v3 = (p2 - p1);
-		auto p3 = v3;
-		p3 *= t;
-		p3 += p1;
+		const Triangulation::QuadraticBezier curve = { glm::vec2(splineVertices[0].position), glm::vec2(splineVertices[1].position), glm::vec2(splineVertices[2].position) };
+		const auto [first, second] = Triangulation::Split(curve, 0.5f);
 
 		{
 			Mesh::Vertices vertices = {
-				{.position = splineVertices[0].position, .color = {1.0f, 0.0f, 0.0f, 0.5f}, .uv = {0.0f, 0.0f}},
-				{.position = p1, .color = {1.0f, 0.0f, 0.0f, 0.5f}, .uv = {0.5f, 0.0f}},
-				{.position = p3, .color = {1.0f, 0.0f, 0.0f, 0.5f}, .uv = {1.0f, 1.0f}},
+				{.position = {first[0], Triangulation::CurveSign::Convex}, .color = {1.0f, 0.0f, 0.0f, 0.5f}, .uv = {0.0f, 0.0f}},
+				{.position = {first[1], Triangulation::CurveSign::Convex}, .color = {1.0f, 0.0f, 0.0f, 0.5f}, .uv = {0.5f, 0.0f}},
+				{.position = {first[2], Triangulation::CurveSign::Convex}, .color = {1.0f, 0.0f, 0.0f, 0.5f}, .uv = {1.0f, 1.0f}},
 			};
-			meshSplineTriangle1 = Mesh::Create(core, vertices, splineIndices);
-			if (!meshSplineTriangle1)
+			meshSplineTriangle1 = splineAtlas->Add(vertices, splineIndices);
+			if (meshSplineTriangle1 == MeshAtlas::invalidHandle)
 				return false;
 		}
 		{
 			Mesh::Vertices vertices = {
-				{.position = p3, .color = {0.0f, 0.0f, 1.0f, 0.5f}, .uv = {0.0f, 0.0f}},
-				{.position = p2, .color = {0.0f, 0.0f, 1.0f, 0.5f}, .uv = {0.5f, 0.0f}},
-				{.position = splineVertices[2].position, .color = {0.0f, 0.0f, 1.0f, 0.5f}, .uv = {1.0f, 1.0f}},
+				{.position = {second[0], Triangulation::CurveSign::Convex}, .color = {0.0f, 0.0f, 1.0f, 0.5f}, .uv = {0.0f, 0.0f}},
+				{.position = {second[1], Triangulation::CurveSign::Convex}, .color = {0.0f, 0.0f, 1.0f, 0.5f}, .uv = {0.5f, 0.0f}},
+				{.position = {second[2], Triangulation::CurveSign::Convex}, .color = {0.0f, 0.0f, 1.0f, 0.5f}, .uv = {1.0f, 1.0f}},
 			};
-			meshSplineTriangle2 = Mesh::Create(core, vertices, splineIndices);
-			if (!meshSplineTriangle2)
+			meshSplineTriangle2 = splineAtlas->Add(vertices, splineIndices);
+			if (meshSplineTriangle2 == MeshAtlas::invalidHandle)
 				return false;
 		}
 	}
 
-	constexpr auto splineSegmentCount = 100;
-	constexpr auto splineSegmentsLineVertexCount = (splineSegmentCount + 1) * 2;
-	constexpr auto splineSegmentsLineIndexCount = splineSegmentCount * 6;
-	constexpr auto splineSegmentsPointVertexCount = (splineSegmentCount + 1) * 4;
-	constexpr auto splineSegmentsPointIndexCount = (splineSegmentCount + 1) * 6;
-	Mesh::Vertices vertices(splineSegmentsLineVertexCount + splineSegmentsPointVertexCount);
-	Mesh::Indices indices(splineSegmentsLineIndexCount + splineSegmentsPointIndexCount);
-	constexpr auto lineThickness = 0.000f;
-	constexpr auto pointSize = 0.003f;
-	for (int i = 0; i <= splineSegmentCount; i++) {
-		double t = i / (double)splineSegmentCount;
- 		auto v1 = (splineVertices[1].position - splineVertices[0].position);
-		auto p1 = v1;
-		p1 *= t;
-		p1 += splineVertices[0].position;
-		auto v2 = (splineVertices[2].position - splineVertices[1].position);
-		auto p2 = v2;
-		p2 *= t;
-		p2 += splineVertices[1].position;
-		auto v3 = (p2 - p1);
-		auto p3 = v3;
-		p3 *= t;
-		p3 += p1;
-		auto perpendicular = glm::vec3(glm::normalize(glm::rotate(glm::identity<glm::mat4>(), glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f)) * glm::vec4(v3, 0.0f)));
-		perpendicular *= lineThickness;
-
-		// Lines
-		vertices[i * 2 + 0] = { .position = p3 + perpendicular, .color = {1.0f, 1.0f, 1.0f, 1.0f}, .uv = {0.0f, 0.0f} };
-		vertices[i * 2 + 1] = { .position = p3 - perpendicular, .color = {1.0f, 1.0f, 1.0f, 1.0f}, .uv = {0.0f, 0.0f} };
-		// Points
-		vertices[splineSegmentsLineVertexCount + i * 4 + 0] = { .position = p3 + glm::vec3{-pointSize, -pointSize, 0.0f}, .color = {1.0f, 0.0f, 0.0f, 1.0f}, .uv = {0.0f, 0.0f} };
-		vertices[splineSegmentsLineVertexCount + i * 4 + 1] = { .position = p3 + glm::vec3{pointSize, -pointSize, 0.0f}, .color = {1.0f, 0.0f, 0.0f, 1.0f}, .uv = {0.0f, 0.0f} };
-		vertices[splineSegmentsLineVertexCount + i * 4 + 2] = { .position = p3 + glm::vec3{-pointSize, pointSize, 0.0f}, .color = {1.0f, 0.0f, 0.0f, 1.0f}, .uv = {0.0f, 0.0f} };
-		vertices[splineSegmentsLineVertexCount + i * 4 + 3] = { .position = p3 + glm::vec3{pointSize, pointSize, 0.0f}, .color = {1.0f, 0.0f, 0.0f, 1.0f}, .uv = {0.0f, 0.0f} };
-
-		if (i < splineSegmentCount) {
-			// Lines
-			indices[i * 6 + 0] = i * 2 + 0;
-			indices[i * 6 + 1] = i * 2 + 1;
-			indices[i * 6 + 2] = i * 2 + 2;
-			indices[i * 6 + 3] = i * 2 + 2;
-			indices[i * 6 + 4] = i * 2 + 1;
-			indices[i * 6 + 5] = i * 2 + 3;
+	// Ring glyph made of quadratics, filled with curve triangles so it stays smooth at any scale
+	{
+		const auto outline = MakeRingOutline({ -0.7f, -0.7f }, 0.2f, 0.12f);
+		Triangulation::Triangulator triangulator({ .mode = Triangulation::Triangulator::Mode::Curves, .transform = ndcToPixels, .color = { 1.0f, 0.8f, 0.2f, 1.0f } });
+		Triangulation::Geometry geometry;
+		if (!triangulator.Triangulate(outline, geometry))
+			return false;
+		meshOutline = splineAtlas->Add(geometry);
+		if (meshOutline == MeshAtlas::invalidHandle)
+			return false;
+	}
+
+	// Heart made of cubics, approximated with quadratics instead of flattening
+	{
+		const auto outline = MakeHeartOutline({ 0.7f, -0.7f }, 0.2f);
+		Triangulation::Triangulator triangulator({ .mode = Triangulation::Triangulator::Mode::Curves, .transform = ndcToPixels, .color = { 0.9f, 0.2f, 0.3f, 1.0f } });
+		Triangulation::Geometry geometry;
+		if (!triangulator.Triangulate(outline, geometry))
+			return false;
+		meshCubicOutline = splineAtlas->Add(geometry);
+		if (meshCubicOutline == MeshAtlas::invalidHandle)
+			return false;
+	}
+
+	// Unit sized glyphs (white, tinted per instance), triangulated once and repeated with instancing
+	{
+		textRenderer = TextRenderer::Create(core);
+		if (!textRenderer)
+			return false;
+
+		// Errors are measured at the size the glyphs are drawn with
+		constexpr auto glyphScale = 0.05f;
+		const glm::mat3 glyphToPixels = ndcToPixels * glm::mat3{
+			{ glyphScale, 0.0f, 0.0f },
+			{ 0.0f, glyphScale, 0.0f },
+			{ 0.0f, 0.0f, 1.0f }
+		};
+		// Straight edges get a fringe, the text pipeline antialiases analytically
+		const Triangulation::Triangulator::Options glyphOptions = { .mode = Triangulation::Triangulator::Mode::Curves, .transform = glyphToPixels, .fringeWidth = 1.0f };
+		const std::pair<TextRenderer::GlyphId, Triangulation::Outline> glyphOutlines[] = {
+			{ GlyphRing, MakeRingOutline({ 0.0f, 0.0f }, 1.0f, 0.6f) },
+			{ GlyphHeart, MakeHeartOutline({ 0.0f, 0.0f }, 0.8f) }
+		};
+		// Triangulated on the first start only, later starts map the bundle and upload straight from it.
+		// It's made again when the outlines or the options change (or the window size moves the tolerance bucket)
+		const auto glyphBundlePath = assetDirectory / "glyphs.bundle";
+		const auto glyphsContentKey = GetGlyphsContentKey(glyphOutlines, glyphOptions);
+		auto glyphBundle = fs::exists(glyphBundlePath) ? MeshBundle::Create(glyphBundlePath) : nullptr;
+		// Unmapped before it's replaced
+		if (glyphBundle && glyphBundle->GetContentKey() != glyphsContentKey)
+			glyphBundle = nullptr;
+		if (!glyphBundle) {
+			std::vector<Triangulation::TessellationCache::GeometryPtr> geometries;
+			std::vector<MeshBundle::Item> items;
+			for (const auto &[id, outline] : glyphOutlines) {
+				const auto geometry = tessellationCache.Triangulate(outline, glyphOptions);
+				if (!geometry)
+					return false;
+				geometries.push_back(geometry);
+				items.push_back({ .id = id, .geometry = geometry.get() });
+			}
+			if (MeshBundle::Save<CompactVertex>(glyphBundlePath, items, glyphsContentKey))
+				glyphBundle = MeshBundle::Create(glyphBundlePath);
+			// Not writable, use the geometry directly
+			if (!glyphBundle) {
+				for (const auto &item : items) {
+					if (!textRenderer->AddGlyph(item.id, *item.geometry))
+						return false;
+				}
+			}
 		}
-		// Points
-		indices[splineSegmentsLineIndexCount + i * 6 + 0] = splineSegmentsLineVertexCount + i * 4 + 0;
-		indices[splineSegmentsLineIndexCount + i * 6 + 1] = splineSegmentsLineVertexCount + i * 4 + 1;
-		indices[splineSegmentsLineIndexCount + i * 6 + 2] = splineSegmentsLineVertexCount + i * 4 + 2;
-		indices[splineSegmentsLineIndexCount + i * 6 + 3] = splineSegmentsLineVertexCount + i * 4 + 2;
-		indices[splineSegmentsLineIndexCount + i * 6 + 4] = splineSegmentsLineVertexCount + i * 4 + 1;
-		indices[splineSegmentsLineIndexCount + i * 6 + 5] = splineSegmentsLineVertexCount + i * 4 + 3;
+		if (glyphBundle && !textRenderer->AddGlyphs(*glyphBundle))
+			return false;
 	}
-	meshSplineSegments = Mesh::Create(core, vertices, indices);
+
+	// Stroke along the spline, flattened with the same on-screen tolerance as the outlines
+	const Triangulation::QuadraticBezier spline = { glm::vec2(splineVertices[0].position), glm::vec2(splineVertices[1].position), glm::vec2(splineVertices[2].position) };
+	Triangulation::Outline splineOutline;
+	splineOutline.MoveTo(spline[0]);
+	splineOutline.QuadTo(spline[1], spline[2]);
+	Triangulation::Stroker stroker({ .width = 0.004f, .join = Triangulation::Stroker::Join::Round, .cap = Triangulation::Stroker::Cap::Round, .transform = ndcToPixels });
+	Triangulation::Geometry splineSegments;
+	if (!stroker.Stroke(splineOutline, splineSegments))
+		return false;
+
+	// Points the flattener puts on the spline
+	const Triangulation::Flattener flattener(ndcToPixels, 0.25f);
+	const auto splineSegmentCount = flattener.GetSegmentCount(spline);
+	std::vector<glm::vec2> splinePoints(splineSegmentCount + 1);
+	splinePoints[0] = spline[0];
+	flattener.Flatten(spline, std::span(splinePoints).subspan(1));
+	constexpr auto pointSize = 0.003f;
+	for (const auto &point : splinePoints) {
+		const auto baseVertex = static_cast<uint16_t>(splineSegments.vertices.size());
+		const auto p3 = glm::vec3(point, Triangulation::CurveSign::Solid);
+		splineSegments.vertices.push_back({ .position = p3 + glm::vec3{-pointSize, -pointSize, 0.0f}, .color = {1.0f, 0.0f, 0.0f, 1.0f}, .uv = {0.0f, 0.0f} });
+		splineSegments.vertices.push_back({ .position = p3 + glm::vec3{pointSize, -pointSize, 0.0f}, .color = {1.0f, 0.0f, 0.0f, 1.0f}, .uv = {0.0f, 0.0f} });
+		splineSegments.vertices.push_back({ .position = p3 + glm::vec3{-pointSize, pointSize, 0.0f}, .color = {1.0f, 0.0f, 0.0f, 1.0f}, .uv = {0.0f, 0.0f} });
+		splineSegments.vertices.push_back({ .position = p3 + glm::vec3{pointSize, pointSize, 0.0f}, .color = {1.0f, 0.0f, 0.0f, 1.0f}, .uv = {0.0f, 0.0f} });
+		for (const uint16_t index : { 0, 1, 2, 2, 1, 3 })
+			splineSegments.indices.push_back(baseVertex + index);
+	}
+	meshSplineSegments = Mesh::Create(core, splineSegments);
 	if (!meshSplineSegments)
 		return false;
 
@@ -154,11 +298,47 @@ void Application::OnDestroy(const CorePtr core)
 {
 	(void)core;
 	pipeline = nullptr;
+	splineShaders = nullptr;
+	textShaders = nullptr;
 	meshSplineSegments = nullptr;
 	pipelineSpline = nullptr;
-	meshSplineTriangle = nullptr;
-	meshSplineTriangle1 = nullptr;
-	meshSplineTriangle2 = nullptr;
+	splineAtlas = nullptr;
+	pipelineText = nullptr;
+	textRenderer = nullptr;
+	recordingPool = nullptr;
+}
+
+namespace {
+	void RecordShapes()
+	{
+		pipelineSpline->Bind();
+		splineAtlas->Bind();
+		splineAtlas->Draw(meshSplineTriangle);
+
+		pipeline->Bind();
+		meshSplineSegments->Draw();
+
+		// Mesh::Draw rebinds its own buffers
+		pipelineSpline->Bind();
+		splineAtlas->Bind();
+		splineAtlas->Draw(meshSplineTriangle1);
+		splineAtlas->Draw(meshSplineTriangle2);
+		splineAtlas->Draw(meshOutline);
+		splineAtlas->Draw(meshCubicOutline);
+	}
+	void RecordText()
+	{
+		// A line of "text", every glyph is an instance of one of two meshes
+		constexpr auto glyphScale = 0.05f;
+		constexpr uint32_t glyphCount = 16;
+		TextRenderer::Glyph run[glyphCount];
+		for (uint32_t i = 0; i < glyphCount; i++)
+			run[i] = { .id = (i % 3) ? GlyphRing : GlyphHeart, .offset = { 2.2f * i, 0.0f } };
+		pipelineText->Bind();
+		textRenderer->AddRun(run, { -0.8f, 0.8f }, { glyphScale, glyphScale }, { 0.3f, 0.8f, 1.0f, 1.0f });
+		textRenderer->AddRun(run, { -0.8f, 0.9f }, { glyphScale, glyphScale }, { 1.0f, 0.6f, 0.2f, 1.0f });
+		textRenderer->Draw();
+	}
 }
 
 bool Application::OnFrame(const CorePtr core)
@@ -179,19 +359,28 @@ bool Application::OnFrame(const CorePtr core)
 		.pClearValues = &clearColor
 	};
 
-	vkCmdBeginRenderPass(vkCommandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-	pipelineSpline->Bind();
-	meshSplineTriangle->Draw();
+	vkCmdBeginRenderPass(vkCommandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
 
-	pipeline->Bind();
-	meshSplineSegments->Draw();
-
-	pipelineSpline->Bind();
-	meshSplineTriangle1->Draw();
-	meshSplineTriangle2->Draw();
+	// Each layer is recorded by whichever thread picks it up, and executed in layer order
+	constexpr void (*layers[])() = { RecordShapes, RecordText };
+	constexpr auto layerCount = std::size(layers);
+	VkCommandBuffer layerCommandBuffers[layerCount] = {};
+	std::atomic<bool> isRecorded = true;
+	recordingPool->ParallelFor(layerCount, [&](const std::size_t index, const uint32_t) {
+		const auto commandBuffer = core->BeginSecondaryCommandBuffer();
+		if (!commandBuffer) {
+			isRecorded = false;
+			return;
+		}
+		layers[index]();
+		if (!core->EndSecondaryCommandBuffer(commandBuffer))
+			isRecorded = false;
+		layerCommandBuffers[index] = commandBuffer;
+	});
+	if (isRecorded)
+		core->ExecuteSecondaryCommandBuffers(layerCommandBuffers);
 
 	vkCmdEndRenderPass(vkCommandBuffer);
 
-	return true;
+	return isRecorded;
 }
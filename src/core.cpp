@@ -1,13 +1,24 @@
 #include "core.hpp"
+#include "file_view.hpp"
+#include "memory_allocator.hpp"
+#include "staging_buffer.hpp"
 #include "utils.hpp"
+#include "view_uniforms.hpp"
 #include <vulkan/vk_enum_string_helper.h>
 #ifdef __USE_WAYLAND__
 #include <vulkan/vulkan_wayland.h>
+#include <poll.h>
+#include <cerrno>
 #elif defined(__PLATFORM_WINDOWS__)
 #include <vulkan/vulkan_win32.h>
 #endif
+#include <algorithm>
 #include <cstring>
+#include <fstream>
 #include <iostream>
+#include <limits>
+#include <random>
+#include <span>
 #include <string>
 
 // constexpr void print_vk_result(std::string name, VkResult result)
@@ -70,6 +81,16 @@ namespace {
 				onClose(toplevel);
 		}
 	}
+	void wlCallbackOnDoneListener(void *data, wl_callback *callback, uint32_t time)
+	{
+		if (data) {
+			if (auto onDone = reinterpret_cast<Core::WlCallbackListenerWrapper*>(data)->onDone)
+				onDone(callback, time);
+		}
+	}
+	const wl_callback_listener wlCallbackListener = {
+		.done = wlCallbackOnDoneListener
+	};
 	const xdg_toplevel_listener xdgToplevelListener = {
 		.configure = xdgToplevelOnConfigureListener,
 		.close = xdgToplevelOnCloseListener,
@@ -136,6 +157,7 @@ namespace {
 #endif // __PLATFORM_WINDOWS__
 
 	// Vulkan
+	// Headless instances only enable the first one
 	constexpr const char* const instanceExtensionNames[] = {
 		"VK_EXT_debug_utils",
 		"VK_KHR_surface",
@@ -150,6 +172,35 @@ namespace {
 		"VK_KHR_swapchain"
 	};
 	constexpr const std::size_t deviceExtensionCount = std::size(deviceExtensionNames);
+	// Secondary buffer the thread is recording between Core::BeginSecondaryCommandBuffer and EndSecondaryCommandBuffer
+	thread_local const Core *recordingCore = nullptr;
+	thread_local VkCommandBuffer recordingCommandBuffer = VK_NULL_HANDLE;
+
+	// FIFO is the only mode every surface supports
+	VkPresentModeKHR ChoosePresentMode(const Core::PresentPolicy policy, std::span<const VkPresentModeKHR> supported)
+	{
+		if (policy == Core::PresentPolicy::LowLatency) {
+			for (const auto mode : { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR }) {
+				if (std::find(supported.begin(), supported.end(), mode) != supported.end())
+					return mode;
+			}
+		}
+		return VK_PRESENT_MODE_FIFO_KHR;
+	}
+	uint32_t ChooseImageCount(const Core::PresentPolicy policy, const VkSurfaceCapabilitiesKHR &capabilities)
+	{
+		// One image above the minimum lets the CPU start on a frame while the display holds one and another one is queued,
+		// power saving makes do with the minimum
+		auto count = capabilities.minImageCount + (policy == Core::PresentPolicy::PowerSaver ? 0 : 1);
+		// maxImageCount 0 means there is no limit
+		if (capabilities.maxImageCount)
+			count = std::min(count, capabilities.maxImageCount);
+		return std::max(count, 1u);
+	}
+	bool IsPacedPresentMode(const VkPresentModeKHR mode)
+	{
+		return mode == VK_PRESENT_MODE_FIFO_KHR || mode == VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+	}
 	VkBool32 DebugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT severity,
 		VkDebugUtilsMessageTypeFlagsEXT type,
 		const VkDebugUtilsMessengerCallbackDataEXT* data,
@@ -193,10 +244,22 @@ Core::~Core()
 	CHECK_VK_RESULT(vkDeviceWaitIdle(this->vkDevice));
 
 	this->DestroyVulkanSwapchain();
+	this->DestroyVulkanFrames();
+	this->viewUniforms = nullptr;
+	this->stagingBuffer = nullptr;
+	for (auto &[buffer, memory] : this->pendingRetiredBuffers)
+		this->memoryAllocator->DestroyBuffer(buffer, memory);
+	this->pendingRetiredBuffers.clear();
+	this->memoryAllocator = nullptr;
 	if (this->vkCommandPool) {
 		vkDestroyCommandPool(this->vkDevice, this->vkCommandPool, nullptr);
 		this->vkCommandPool = nullptr;
 	}
+	if (this->vkPipelineCache) {
+		this->SaveVulkanPipelineCache();
+		vkDestroyPipelineCache(this->vkDevice, this->vkPipelineCache, nullptr);
+		this->vkPipelineCache = nullptr;
+	}
 	if (this->vkSurface) {
 		vkDestroySurfaceKHR(this->vkInstance, this->vkSurface, nullptr);
 		this->vkSurface = nullptr;
@@ -216,6 +279,7 @@ Core::~Core()
 		this->vkInstance = nullptr;
 	}
 #ifdef __USE_WAYLAND__
+	this->CancelWaylandFrame();
 	if (this->xdgToplevel) {
 		xdg_toplevel_destroy(this->xdgToplevel);
 		this->xdgToplevel = nullptr;
@@ -240,13 +304,13 @@ Core::~Core()
 bool Core::Init()
 {
 #ifdef __USE_WAYLAND__
-	if (!this->InitWaylandWindow()) {
+	if (!this->isHeadless && !this->InitWaylandWindow()) {
 		std::cerr << "Wayland: Failed to initialize" << std::endl;
 		return false;
 	}
 #endif // __USE_WAYLAND__
 #ifdef __PLATFORM_WINDOWS__
-	if (!this->InitWindowsWindow()) {
+	if (!this->isHeadless && !this->InitWindowsWindow()) {
 		std::cerr << "WinAPI: Failed to initialize" << std::endl;
 		return false;
 	}
@@ -345,6 +409,13 @@ bool Core::InitWaylandWindow()
 	};
 	xdg_toplevel_add_listener(this->xdgToplevel, &xdgToplevelListener, this->xdgToplevelListenerWrapper.get());
 
+	// The compositor wants the next frame
+	this->wlFrameCallbackListenerWrapper->onDone = [this](wl_callback *callback, uint32_t time) {
+		(void)callback;
+		(void)time;
+		this->CancelWaylandFrame();
+	};
+
 	// Fill info
 	xdg_toplevel_set_title(this->xdgToplevel, appTitle);
 	xdg_toplevel_set_app_id(this->xdgToplevel, appName);
@@ -360,6 +431,89 @@ bool Core::InitWaylandWindow()
 
 	return true;
 }
+
+void Core::RequestWaylandFrame()
+{
+	this->CancelWaylandFrame();
+	this->wlFrameCallback = wl_surface_frame(this->wlSurface);
+	if (this->wlFrameCallback)
+		wl_callback_add_listener(this->wlFrameCallback, &wlCallbackListener, this->wlFrameCallbackListenerWrapper.get());
+}
+
+void Core::CancelWaylandFrame()
+{
+	if (this->wlFrameCallback) {
+		wl_callback_destroy(this->wlFrameCallback);
+		this->wlFrameCallback = nullptr;
+	}
+}
+
+void Core::AddFdWatch(const int fd, const short events, OnFdEventType callback)
+{
+	this->RemoveFdWatch(fd);
+	this->fdWatches.push_back(FdWatch{ .fd = fd, .events = events, .callback = callback });
+}
+
+void Core::RemoveFdWatch(const int fd)
+{
+	std::erase_if(this->fdWatches, [fd](const FdWatch &watch) { return watch.fd == fd; });
+}
+
+bool Core::DispatchWaylandEvents()
+{
+	// Events already queued go first, a read can't be prepared until the queue is empty
+	while (wl_display_prepare_read(this->wlDisplay) != 0) {
+		if (wl_display_dispatch_pending(this->wlDisplay) < 0)
+			return false;
+	}
+	// A full socket isn't an error, poll tells when it can take the rest
+	bool isFlushed = true;
+	if (wl_display_flush(this->wlDisplay) < 0) {
+		if (errno != EAGAIN) {
+			wl_display_cancel_read(this->wlDisplay);
+			std::cerr << "Wayland: Failed to flush the display" << std::endl;
+			return false;
+		}
+		isFlushed = false;
+	}
+
+	// Watches may be added or removed by the callbacks below
+	const auto watches = this->fdWatches;
+	std::vector<pollfd> fds;
+	fds.reserve(watches.size() + 1);
+	fds.push_back(pollfd{ .fd = wl_display_get_fd(this->wlDisplay), .events = static_cast<short>(POLLIN | (isFlushed ? 0 : POLLOUT)), .revents = 0 });
+	for (const auto &watch : watches)
+		fds.push_back(pollfd{ .fd = watch.fd, .events = watch.events, .revents = 0 });
+
+	// Nothing to draw means nothing to do until some event arrives
+	const bool isFrameDue = (this->isDirty && !this->wlFrameCallback) || (this->readyToResize && this->resize) || this->isGoingToClose;
+	if (poll(fds.data(), fds.size(), isFrameDue ? 0 : -1) < 0 && errno != EINTR) {
+		wl_display_cancel_read(this->wlDisplay);
+		std::cerr << "Wayland: Failed to poll" << std::endl;
+		return false;
+	}
+
+	if (fds[0].revents & POLLIN) {
+		if (wl_display_read_events(this->wlDisplay) < 0)
+			return false;
+	}
+	else {
+		wl_display_cancel_read(this->wlDisplay);
+	}
+	if (fds[0].revents & (POLLERR | POLLHUP)) {
+		std::cerr << "Wayland: Lost the display connection" << std::endl;
+		return false;
+	}
+	if (wl_display_dispatch_pending(this->wlDisplay) < 0)
+		return false;
+
+	for (std::size_t i = 0; i < watches.size(); i++) {
+		if (fds[i + 1].revents && watches[i].callback)
+			watches[i].callback(this->shared_from_this(), watches[i].fd, fds[i + 1].revents);
+	}
+
+	return true;
+}
 #endif // __USE_WAYLAND__
 
 #ifdef __PLATFORM_WINDOWS__
@@ -413,15 +567,35 @@ bool Core::InitVulkan()
 		std::cerr << "Vulkan: Failed to create Vulkan device" << std::endl;
 		return false;
 	}
-	if (!this->InitVulkanSurface()) {
+	if (!this->isHeadless && !this->InitVulkanSurface()) {
 		std::cerr << "Vulkan: Failed to get create wayland surface" << std::endl;
 		return false;
 	}
 	this->InitVulkanGraphicsQueue();
+	if (!this->InitVulkanPipelineCache()) {
+		std::cerr << "Vulkan: Failed to create pipeline cache" << std::endl;
+		return false;
+	}
 	if (!this->InitVulkanCommandPool()) {
 		std::cerr << "Vulkan: Failed to create command pool" << std::endl;
 		return false;
 	}
+	if (!this->InitVulkanMemoryAllocator()) {
+		std::cerr << "Vulkan: Failed to create memory allocator" << std::endl;
+		return false;
+	}
+	if (!this->InitVulkanStagingBuffer()) {
+		std::cerr << "Vulkan: Failed to create staging buffer" << std::endl;
+		return false;
+	}
+	if (!this->InitVulkanViewUniforms()) {
+		std::cerr << "Vulkan: Failed to create view uniforms" << std::endl;
+		return false;
+	}
+	if (!this->InitVulkanFrames()) {
+		std::cerr << "Vulkan: Failed to create frames in flight" << std::endl;
+		return false;
+	}
 	if (!this->InitVulkanSwapchain()) {
 		std::cerr << "Vulkan: Failed to create swapchain" << std::endl;
 		return false;
@@ -448,7 +622,7 @@ bool Core::InitVulkanInstance()
 		.pApplicationInfo = &appInfo,
 		.enabledLayerCount = 0,
 		.ppEnabledLayerNames = nullptr,
-		.enabledExtensionCount = instanceExtensionCount,
+		.enabledExtensionCount = this->isHeadless ? 1 : static_cast<uint32_t>(instanceExtensionCount),
 		.ppEnabledExtensionNames = instanceExtensionNames
 	};
 
@@ -548,11 +722,15 @@ bool Core::InitVulkanDevice()
 	uint32_t i = 0;
 	for (const auto &currentQueueFamily : queueFamilies)
 	{
+		// Headless doesn't present
+		VkBool32 present = this->isHeadless;
 #ifdef __USE_WAYLAND__
-		VkBool32 present = vkGetPhysicalDeviceWaylandPresentationSupportKHR(this->vkPhysicalDevice, i, this->wlDisplay);
+		if (!present)
+			present = vkGetPhysicalDeviceWaylandPresentationSupportKHR(this->vkPhysicalDevice, i, this->wlDisplay);
 #endif // __USE_WAYLAND__
 #ifdef __PLATFORM_WINDOWS__
-		VkBool32 present = vkGetPhysicalDeviceWin32PresentationSupportKHR(this->vkPhysicalDevice, i);
+		if (!present)
+			present = vkGetPhysicalDeviceWin32PresentationSupportKHR(this->vkPhysicalDevice, i);
 #endif // __PLATFORM_WINDOWS__
 		if (present && (currentQueueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT))
 		{
@@ -561,6 +739,48 @@ bool Core::InitVulkanDevice()
 		}
 		i++;
 	}
+
+	// Optional features, enabled when the device has them
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(this->vkPhysicalDevice, &supportedFeatures);
+	this->vkEnabledFeatures = {};
+	this->vkEnabledFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+	this->vkEnabledFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+	this->vkEnabledFeatures.fullDrawIndexUint32 = supportedFeatures.fullDrawIndexUint32;
+	// Curves evaluated per sample with MSAA
+	this->vkEnabledFeatures.sampleRateShading = supportedFeatures.sampleRateShading;
+	vkGetPhysicalDeviceProperties(this->vkPhysicalDevice, &this->vkPhysicalDeviceProperties);
+	// Without fullDrawIndexUint32 32-bit indices are only guaranteed up to 2^24 - 1
+	if (this->vkEnabledFeatures.fullDrawIndexUint32)
+		this->vkPhysicalDeviceProperties.limits.maxDrawIndexedIndexValue = std::numeric_limits<uint32_t>::max();
+
+	// Optional extensions
+	std::vector<const char*> enabledDeviceExtensionNames(deviceExtensionNames, deviceExtensionNames + (this->isHeadless ? 0 : deviceExtensionCount));
+	uint32_t extensionPropertyCount = 0;
+	CHECK_VK_RESULT(vkEnumerateDeviceExtensionProperties(this->vkPhysicalDevice, nullptr, &extensionPropertyCount, nullptr));
+	std::vector<VkExtensionProperties> extensionProperties(extensionPropertyCount);
+	CHECK_VK_RESULT(vkEnumerateDeviceExtensionProperties(this->vkPhysicalDevice, nullptr, &extensionPropertyCount, extensionProperties.data()));
+	const auto hasExtension = [&extensionProperties](const std::string_view name) {
+		return std::any_of(extensionProperties.begin(), extensionProperties.end(), [name](const VkExtensionProperties &properties) { return name == properties.extensionName; });
+	};
+
+	// 8-bit indices for small meshes
+	VkPhysicalDeviceIndexTypeUint8FeaturesEXT indexTypeUint8Features = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_INDEX_TYPE_UINT8_FEATURES_EXT,
+		.pNext = nullptr,
+		.indexTypeUint8 = VK_FALSE
+	};
+	if (hasExtension(VK_EXT_INDEX_TYPE_UINT8_EXTENSION_NAME)) {
+		VkPhysicalDeviceFeatures2 features = {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+			.pNext = &indexTypeUint8Features,
+			.features = {}
+		};
+		vkGetPhysicalDeviceFeatures2(this->vkPhysicalDevice, &features);
+		if (indexTypeUint8Features.indexTypeUint8)
+			enabledDeviceExtensionNames.push_back(VK_EXT_INDEX_TYPE_UINT8_EXTENSION_NAME);
+	}
+	this->isIndexTypeUint8Enabled = indexTypeUint8Features.indexTypeUint8;
 	
 	float priority = 1;
 	VkDeviceQueueCreateInfo queueCreateInfo {
@@ -573,15 +793,15 @@ bool Core::InitVulkanDevice()
 	};
 	VkDeviceCreateInfo createInfo {
 		.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
-		.pNext = nullptr,
+		.pNext = this->isIndexTypeUint8Enabled ? &indexTypeUint8Features : nullptr,
 		.flags = 0,
 		.queueCreateInfoCount = 1,
 		.pQueueCreateInfos = &queueCreateInfo,
 		.enabledLayerCount = 0,
 		.ppEnabledLayerNames = nullptr,
-		.enabledExtensionCount = deviceExtensionCount,
-		.ppEnabledExtensionNames = deviceExtensionNames,
-		.pEnabledFeatures = nullptr
+		.enabledExtensionCount = static_cast<uint32_t>(enabledDeviceExtensionNames.size()),
+		.ppEnabledExtensionNames = enabledDeviceExtensionNames.data(),
+		.pEnabledFeatures = &this->vkEnabledFeatures
 	};
 	uint32_t layerPropertyCount = 0;
 	CHECK_VK_RESULT(vkEnumerateDeviceLayerProperties(this->vkPhysicalDevice, &layerPropertyCount, nullptr));
@@ -639,6 +859,94 @@ void Core::InitVulkanGraphicsQueue()
 {
 	vkGetDeviceQueue(this->vkDevice, this->vkQueueFamilyIndex, 0, &this->vkGraphicsQueue);
 }
+bool Core::InitVulkanPipelineCache()
+{
+	this->vkPipelineCache = this->LoadVulkanPipelineCache(this->vkPipelineCachePath);
+	return this->vkPipelineCache != nullptr;
+}
+VkPipelineCache Core::LoadVulkanPipelineCache(const std::filesystem::path &path) const
+{
+	// Drivers are supposed to reject foreign data themselves, not all of them do it gracefully,
+	// so data from another device or driver version is dropped here (VkPipelineCacheHeaderVersionOne)
+	std::span<const uint8_t> initialData;
+	const auto file = std::filesystem::exists(path) ? FileView::Create(path, FileView::AccessHint::Sequential) : nullptr;
+	if (file && file->GetSize() >= sizeof(VkPipelineCacheHeaderVersionOne)) {
+		VkPipelineCacheHeaderVersionOne header;
+		std::memcpy(&header, file->GetPointer(), sizeof(header));
+		if (header.headerSize >= sizeof(header) && header.headerSize <= file->GetSize() &&
+			header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+			header.vendorID == this->vkPhysicalDeviceProperties.vendorID &&
+			header.deviceID == this->vkPhysicalDeviceProperties.deviceID &&
+			std::memcmp(header.pipelineCacheUUID, this->vkPhysicalDeviceProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0)
+			initialData = file->GetData();
+		else
+			std::cout << "Vulkan: Pipeline cache " << path.string() << " is from another device or driver, starting empty" << std::endl;
+	}
+
+	VkPipelineCacheCreateInfo createInfo = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.initialDataSize = initialData.size(),
+		.pInitialData = initialData.data()
+	};
+	VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+	if (!CHECK_VK_RESULT(vkCreatePipelineCache(this->vkDevice, &createInfo, nullptr, &pipelineCache)) && !initialData.empty()) {
+		// Broken data, an empty cache still works
+		createInfo.initialDataSize = 0;
+		createInfo.pInitialData = nullptr;
+		CHECK_VK_RESULT(vkCreatePipelineCache(this->vkDevice, &createInfo, nullptr, &pipelineCache));
+	}
+
+	return pipelineCache;
+}
+bool Core::SetVulkanPipelineCachePath(const std::filesystem::path &path)
+{
+	this->vkPipelineCachePath = path;
+	if (!this->vkPipelineCache)
+		return true;
+	const auto loaded = this->LoadVulkanPipelineCache(path);
+	if (!loaded)
+		return false;
+	const auto isMerged = CHECK_VK_RESULT(vkMergePipelineCaches(this->vkDevice, this->vkPipelineCache, 1, &loaded));
+	vkDestroyPipelineCache(this->vkDevice, loaded, nullptr);
+	return isMerged;
+}
+bool Core::SaveVulkanPipelineCache() const
+{
+	if (!this->vkPipelineCache)
+		return false;
+	std::size_t size = 0;
+	if (!CHECK_VK_RESULT(vkGetPipelineCacheData(this->vkDevice, this->vkPipelineCache, &size, nullptr)))
+		return false;
+	std::vector<uint8_t> data(size);
+	if (!CHECK_VK_RESULT(vkGetPipelineCacheData(this->vkDevice, this->vkPipelineCache, &size, data.data())))
+		return false;
+	data.resize(size);
+
+	// Written next to the target and renamed, other instances starting meanwhile never read a half written file.
+	// The temporary name is unique, so instances exiting at the same time don't write into one file
+	std::error_code error;
+	auto temporaryPath = this->vkPipelineCachePath;
+	temporaryPath += ".tmp" + std::to_string(std::random_device()());
+	{
+		std::ofstream stream(temporaryPath, std::ios::binary | std::ios::trunc);
+		stream.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+		if (!stream) {
+			std::cerr << "File: " << temporaryPath.string() << " failed to write" << std::endl;
+			stream.close();
+			std::filesystem::remove(temporaryPath, error);
+			return false;
+		}
+	}
+	std::filesystem::rename(temporaryPath, this->vkPipelineCachePath, error);
+	if (error) {
+		std::cerr << "File: " << this->vkPipelineCachePath.string() << " failed to replace: " << error.message() << std::endl;
+		std::filesystem::remove(temporaryPath, error);
+		return false;
+	}
+	return true;
+}
 bool Core::InitVulkanCommandPool()
 {
 	VkCommandPoolCreateInfo createInfo = {
@@ -651,13 +959,297 @@ bool Core::InitVulkanCommandPool()
 
 	return this->vkCommandPool != nullptr;
 }
+bool Core::InitVulkanMemoryAllocator()
+{
+	this->memoryAllocator = MemoryAllocator::Create(this->vkPhysicalDevice, this->vkDevice);
+
+	return this->memoryAllocator != nullptr;
+}
+bool Core::InitVulkanStagingBuffer()
+{
+	this->stagingBuffer = StagingBuffer::Create(this->vkDevice, this->memoryAllocator, this->vkQueueFamilyIndex, this->vkGraphicsQueue);
+
+	return this->stagingBuffer != nullptr;
+}
+bool Core::InitVulkanViewUniforms()
+{
+	this->viewUniforms = ViewUniforms::Create(this->vkDevice, this->memoryAllocator, this->vkPhysicalDeviceProperties.limits.minUniformBufferOffsetAlignment);
+
+	return this->viewUniforms != nullptr;
+}
+bool Core::InitVulkanFrames()
+{
+	if (!this->viewUniforms->SetFrameCount(this->vkFramesInFlight))
+		return false;
+
+	this->vkFrames.resize(this->vkFramesInFlight);
+	for (auto &frame : this->vkFrames) {
+		// Never reset buffer by buffer, BeginFrame resets the whole pool
+		VkCommandPoolCreateInfo poolCreateInfo = {
+			.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+			.pNext = nullptr,
+			.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+			.queueFamilyIndex = this->vkQueueFamilyIndex
+		};
+		if (!CHECK_VK_RESULT(vkCreateCommandPool(this->vkDevice, &poolCreateInfo, nullptr, &frame.commandPool)))
+			return false;
+		VkCommandBufferAllocateInfo cbAllocInfo = {
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.pNext = nullptr,
+			.commandPool = frame.commandPool,
+			.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+			.commandBufferCount = 1
+		};
+		if (!CHECK_VK_RESULT(vkAllocateCommandBuffers(this->vkDevice, &cbAllocInfo, &frame.commandBuffer)))
+			return false;
+
+		VkSemaphoreCreateInfo semaphoreCreateInfo = {
+			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+			.pNext = nullptr,
+			.flags = 0
+		};
+		if (!CHECK_VK_RESULT(vkCreateSemaphore(this->vkDevice, &semaphoreCreateInfo, nullptr, &frame.acquireSemaphore)))
+			return false;
+		VkFenceCreateInfo fenceCreateInfo = {
+			.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+			.pNext = nullptr,
+			.flags = VK_FENCE_CREATE_SIGNALED_BIT
+		};
+		if (!CHECK_VK_RESULT(vkCreateFence(this->vkDevice, &fenceCreateInfo, nullptr, &frame.fence)))
+			return false;
+	}
+	this->vkCurrentFrame = 0;
+
+	return true;
+}
+void Core::DestroyVulkanFrames()
+{
+	for (auto &frame : this->vkFrames) {
+		for (auto &[buffer, memory] : frame.retiredBuffers)
+			this->memoryAllocator->DestroyBuffer(buffer, memory);
+		frame.retiredBuffers.clear();
+		if (frame.transientBuffer)
+			this->memoryAllocator->DestroyBuffer(frame.transientBuffer, frame.transientMemory);
+		for (auto &threadCommandPool : frame.threadCommandPools)
+			vkDestroyCommandPool(this->vkDevice, threadCommandPool->commandPool, nullptr);
+		frame.threadCommandPools.clear();
+		if (frame.fence) {
+			vkDestroyFence(this->vkDevice, frame.fence, nullptr);
+			frame.fence = nullptr;
+		}
+		if (frame.acquireSemaphore) {
+			vkDestroySemaphore(this->vkDevice, frame.acquireSemaphore, nullptr);
+			frame.acquireSemaphore = nullptr;
+		}
+		// Frees its command buffer too
+		if (frame.commandPool) {
+			vkDestroyCommandPool(this->vkDevice, frame.commandPool, nullptr);
+			frame.commandPool = nullptr;
+		}
+	}
+	this->vkFrames.clear();
+}
+bool Core::BeginFrame(FrameResources &frame)
+{
+	if (!CHECK_VK_RESULT(vkWaitForFences(this->vkDevice, 1, &frame.fence, VK_TRUE, std::numeric_limits<uint64_t>::max())))
+		return false;
+
+	for (auto &[buffer, memory] : frame.retiredBuffers)
+		this->memoryAllocator->DestroyBuffer(buffer, memory);
+	frame.retiredBuffers.clear();
+	frame.transientOffset = 0;
+
+	// Every command buffer of the frame at once, secondary ones included
+	for (auto &threadCommandPool : frame.threadCommandPools) {
+		if (!CHECK_VK_RESULT(vkResetCommandPool(this->vkDevice, threadCommandPool->commandPool, 0)))
+			return false;
+		threadCommandPool->usedCount = 0;
+	}
+	return CHECK_VK_RESULT(vkResetCommandPool(this->vkDevice, frame.commandPool, 0));
+}
+void Core::TakeRetiredBuffers(FrameResources &frame)
+{
+	std::lock_guard lock(this->retiredBuffersMutex);
+	frame.retiredBuffers.insert(frame.retiredBuffers.end(), this->pendingRetiredBuffers.begin(), this->pendingRetiredBuffers.end());
+	this->pendingRetiredBuffers.clear();
+}
+void Core::RetireBuffer(VkBuffer buffer, MemoryAllocator::Allocation allocation)
+{
+	if (!buffer)
+		return;
+	// Not on the current frame's list directly, between frames that's the next frame whose fence is older than the last submission
+	std::lock_guard lock(this->retiredBuffersMutex);
+	this->pendingRetiredBuffers.emplace_back(buffer, allocation);
+}
+bool Core::AllocateTransient(const VkDeviceSize size, const VkDeviceSize alignment, TransientAllocation &allocation)
+{
+	std::lock_guard lock(this->transientMutex);
+	auto &frame = this->vkFrames[this->vkCurrentFrame];
+	const auto align = std::max<VkDeviceSize>(alignment, 1);
+	auto offset = (frame.transientOffset + align - 1) / align * align;
+	if (!frame.transientBuffer || offset + size > frame.transientCapacity) {
+		// Recorded commands may point into the current arena, it goes once the frame is done
+		VkDeviceSize capacity = std::max<VkDeviceSize>(64 * 1024, frame.transientCapacity * 2);
+		while (capacity < size)
+			capacity *= 2;
+		if (frame.transientBuffer)
+			frame.retiredBuffers.emplace_back(frame.transientBuffer, frame.transientMemory);
+		frame.transientBuffer = VK_NULL_HANDLE;
+		frame.transientMemory = {};
+		frame.transientCapacity = 0;
+		if (!this->memoryAllocator->CreateBuffer(capacity,
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			frame.transientBuffer, frame.transientMemory)) {
+			std::cerr << "Vulkan: Failed to create transient buffer" << std::endl;
+			return false;
+		}
+		frame.transientCapacity = capacity;
+		offset = 0;
+	}
+	frame.transientOffset = offset + size;
+
+	allocation = TransientAllocation{
+		.buffer = frame.transientBuffer,
+		.offset = offset,
+		.mapped = frame.transientMemory.mapped + offset
+	};
+	return true;
+}
+VkCommandBuffer Core::GetVulkanCurrentFrameCommandBuffer() const
+{
+	if (recordingCore == this)
+		return recordingCommandBuffer;
+	return this->vkFrames[this->vkCurrentFrame].commandBuffer;
+}
+Core::ThreadCommandPool* Core::GetThreadCommandPool(FrameResources &frame)
+{
+	std::lock_guard lock(this->threadCommandPoolsMutex);
+	const auto thread = std::this_thread::get_id();
+	for (auto &threadCommandPool : frame.threadCommandPools) {
+		if (threadCommandPool->thread == thread)
+			return threadCommandPool.get();
+	}
+
+	auto threadCommandPool = std::make_unique<ThreadCommandPool>();
+	threadCommandPool->thread = thread;
+	VkCommandPoolCreateInfo createInfo = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+		.queueFamilyIndex = this->vkQueueFamilyIndex
+	};
+	if (!CHECK_VK_RESULT(vkCreateCommandPool(this->vkDevice, &createInfo, nullptr, &threadCommandPool->commandPool)))
+		return nullptr;
+	frame.threadCommandPools.push_back(std::move(threadCommandPool));
+	return frame.threadCommandPools.back().get();
+}
+VkCommandBuffer Core::BeginSecondaryCommandBuffer()
+{
+	if (recordingCore) {
+		std::cerr << "Vulkan: The thread is already recording a secondary command buffer" << std::endl;
+		return VK_NULL_HANDLE;
+	}
+	auto threadCommandPool = this->GetThreadCommandPool(this->vkFrames[this->vkCurrentFrame]);
+	if (!threadCommandPool)
+		return VK_NULL_HANDLE;
+
+	// Only this thread touches its pool, no lock needed past GetThreadCommandPool
+	if (threadCommandPool->usedCount == threadCommandPool->commandBuffers.size()) {
+		VkCommandBufferAllocateInfo allocInfo = {
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.pNext = nullptr,
+			.commandPool = threadCommandPool->commandPool,
+			.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+			.commandBufferCount = 1
+		};
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		if (!CHECK_VK_RESULT(vkAllocateCommandBuffers(this->vkDevice, &allocInfo, &commandBuffer)))
+			return VK_NULL_HANDLE;
+		threadCommandPool->commandBuffers.push_back(commandBuffer);
+	}
+	const auto commandBuffer = threadCommandPool->commandBuffers[threadCommandPool->usedCount];
+
+	VkCommandBufferInheritanceInfo inheritanceInfo = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+		.pNext = nullptr,
+		.renderPass = this->vkRenderPass,
+		.subpass = 0,
+		.framebuffer = this->vkSwapchainResources[this->vkImageIndex].framebuffer,
+		.occlusionQueryEnable = VK_FALSE,
+		.queryFlags = 0,
+		.pipelineStatistics = 0
+	};
+	VkCommandBufferBeginInfo beginInfo = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.pNext = nullptr,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+		.pInheritanceInfo = &inheritanceInfo
+	};
+	if (!CHECK_VK_RESULT(vkBeginCommandBuffer(commandBuffer, &beginInfo)))
+		return VK_NULL_HANDLE;
+	threadCommandPool->usedCount++;
+
+	recordingCore = this;
+	recordingCommandBuffer = commandBuffer;
+	return commandBuffer;
+}
+bool Core::EndSecondaryCommandBuffer(const VkCommandBuffer commandBuffer)
+{
+	if (recordingCore != this || recordingCommandBuffer != commandBuffer) {
+		std::cerr << "Vulkan: The secondary command buffer isn't recorded by this thread" << std::endl;
+		return false;
+	}
+	recordingCore = nullptr;
+	recordingCommandBuffer = VK_NULL_HANDLE;
+	return CHECK_VK_RESULT(vkEndCommandBuffer(commandBuffer));
+}
+void Core::ExecuteSecondaryCommandBuffers(std::span<const VkCommandBuffer> commandBuffers) const
+{
+	if (commandBuffers.empty())
+		return;
+	vkCmdExecuteCommands(this->vkFrames[this->vkCurrentFrame].commandBuffer, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
+}
+bool Core::SetVulkanFramesInFlight(const uint32_t framesInFlight)
+{
+	const auto count = std::clamp(framesInFlight, 1u, maxFramesInFlight);
+	if (count == this->vkFramesInFlight)
+		return true;
+	// Not created yet, InitVulkanFrames picks it up
+	if (this->vkFrames.empty()) {
+		this->vkFramesInFlight = count;
+		return true;
+	}
+
+	if (this->isHeadless && !this->WaitForReadbacks())
+		return false;
+	CHECK_VK_RESULT(vkDeviceWaitIdle(this->vkDevice));
+	this->DestroyVulkanFrames();
+	this->vkFramesInFlight = count;
+	if (!this->InitVulkanFrames())
+		return false;
+
+	// Headless images go with the frames
+	if (!this->isHeadless)
+		return true;
+	this->DestroyVulkanSwapchain();
+	return this->InitVulkanSwapchain();
+}
 bool Core::InitVulkanSwapchain()
 {
 	vkSwapchainFormat = VK_FORMAT_UNDEFINED;
-	int32_t width = 1920;
-	int32_t height = 1080;
-
-	{
+	int32_t width = 0;
+	int32_t height = 0;
+
+	if (this->isHeadless) {
+		// Mandatory color attachment format, and the byte order image files use
+		vkSwapchainFormat = VK_FORMAT_R8G8B8A8_UNORM;
+		// Image i is only ever rendered by frame in flight i
+		this->vkImageCount = this->vkFramesInFlight;
+		width = static_cast<int32_t>(this->width);
+		height = static_cast<int32_t>(this->height);
+	}
+	else {
 		VkSurfaceCapabilitiesKHR capabilities;
 		CHECK_VK_RESULT(vkGetPhysicalDeviceSurfaceCapabilitiesKHR(this->vkPhysicalDevice, this->vkSurface, &capabilities));
 		uint32_t formatsCount;
@@ -674,25 +1266,32 @@ bool Core::InitVulkanSwapchain()
 
 		vkSwapchainFormat = chosenFormat.format;
 
-		this->vkFramesCount = (capabilities.minImageCount + 1) < capabilities.maxImageCount ? capabilities.minImageCount + 1 : capabilities.maxImageCount;
-
-		width = ~capabilities.currentExtent.width ? capabilities.currentExtent.width : capabilities.maxImageExtent.width;
-		height = ~capabilities.currentExtent.height ? capabilities.currentExtent.height : capabilities.maxImageExtent.height;
-		if (this->width && this->height) {
-			width = this->width;
-			height = this->height;
-		}
-		else {
-			this->width = width;
-			this->height = height;
-		}
+		uint32_t presentModeCount = 0;
+		CHECK_VK_RESULT(vkGetPhysicalDeviceSurfacePresentModesKHR(this->vkPhysicalDevice, this->vkSurface, &presentModeCount, nullptr));
+		this->vkSupportedPresentModes.resize(presentModeCount);
+		CHECK_VK_RESULT(vkGetPhysicalDeviceSurfacePresentModesKHR(this->vkPhysicalDevice, this->vkSurface, &presentModeCount, this->vkSupportedPresentModes.data()));
+		this->vkSupportedPresentModes.resize(presentModeCount);
+		this->vkPresentMode = ChoosePresentMode(this->presentPolicy, this->vkSupportedPresentModes);
+		this->vkImageCount = ChooseImageCount(this->presentPolicy, capabilities);
+		this->framePacer.Reset();
+
+		// The surface takes the size of the swapchain when it has no current extent (Wayland), the window size is used then
+		VkExtent2D extent = capabilities.currentExtent;
+		if (extent.width == std::numeric_limits<uint32_t>::max() || extent.height == std::numeric_limits<uint32_t>::max())
+			extent = { .width = this->width, .height = this->height };
+		extent.width = std::clamp(extent.width, capabilities.minImageExtent.width, capabilities.maxImageExtent.width);
+		extent.height = std::clamp(extent.height, capabilities.minImageExtent.height, capabilities.maxImageExtent.height);
+		width = static_cast<int32_t>(extent.width);
+		height = static_cast<int32_t>(extent.height);
+		this->width = extent.width;
+		this->height = extent.height;
 
 		VkSwapchainCreateInfoKHR createInfo = {
 			.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
 			.pNext = nullptr,
 			.flags = 0,
 			.surface = this->vkSurface,
-			.minImageCount = this->vkFramesCount,
+			.minImageCount = this->vkImageCount,
 			.imageFormat = chosenFormat.format,
 			.imageColorSpace = chosenFormat.colorSpace,
 			.imageExtent = VkExtent2D{ .width = static_cast<uint32_t>(width), .height = static_cast<uint32_t>(height) },
@@ -707,29 +1306,51 @@ bool Core::InitVulkanSwapchain()
 #elif defined(__PLATFORM_WINDOWS__)
 			.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
 #endif
-			.presentMode = VK_PRESENT_MODE_MAILBOX_KHR,
+			.presentMode = this->vkPresentMode,
 			.clipped = VK_TRUE,
 			.oldSwapchain = VK_NULL_HANDLE
 		};
 		CHECK_VK_RESULT(vkCreateSwapchainKHR(this->vkDevice, &createInfo, nullptr, &this->vkSwapchain));
 	}
 
+	const bool isMultisampled = this->vkSampleCount != VK_SAMPLE_COUNT_1_BIT;
+	// Headless images are copied into the readback buffer right after the render pass
+	const auto finalLayout = this->isHeadless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 	{
-		VkAttachmentDescription attachments = {
-			.flags = 0,
-			.format = vkSwapchainFormat,
-			.samples = VK_SAMPLE_COUNT_1_BIT,
-			.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
-			.storeOp = VK_ATTACHMENT_STORE_OP_STORE,
-			.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
-			.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-			.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-			.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
+		// With MSAA the first attachment is the multisampled image and the second one the swapchain image it's resolved to,
+		// the multisampled data is never stored
+		VkAttachmentDescription attachments[] = {
+			{
+				.flags = 0,
+				.format = vkSwapchainFormat,
+				.samples = this->vkSampleCount,
+				.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+				.storeOp = isMultisampled ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE,
+				.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+				.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+				.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+				.finalLayout = isMultisampled ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : finalLayout
+			},
+			{
+				.flags = 0,
+				.format = vkSwapchainFormat,
+				.samples = VK_SAMPLE_COUNT_1_BIT,
+				.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+				.storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+				.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+				.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+				.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+				.finalLayout = finalLayout
+			}
 		};
 		VkAttachmentReference attachmentReference = {
 			.attachment = 0,
 			.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
 		};
+		VkAttachmentReference resolveAttachmentReference = {
+			.attachment = 1,
+			.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+		};
 		VkSubpassDescription subpass = {
 			.flags = 0,
 			.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
@@ -737,45 +1358,49 @@ bool Core::InitVulkanSwapchain()
 			.pInputAttachments = nullptr,
 			.colorAttachmentCount = 1,
 			.pColorAttachments = &attachmentReference,
-			.pResolveAttachments = nullptr,
+			.pResolveAttachments = isMultisampled ? &resolveAttachmentReference : nullptr,
 			.pDepthStencilAttachment = nullptr,
 			.preserveAttachmentCount = 0,
 			.pPreserveAttachments = nullptr
 		};
+		// The copy reads what the subpass wrote
+		VkSubpassDependency readbackDependency = {
+			.srcSubpass = 0,
+			.dstSubpass = VK_SUBPASS_EXTERNAL,
+			.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT,
+			.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+			.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+			.dependencyFlags = 0
+		};
 		VkRenderPassCreateInfo createInfo = {
 			.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
 			.pNext = nullptr,
 			.flags = 0,
-			.attachmentCount = 1,
-			.pAttachments = &attachments,
+			.attachmentCount = isMultisampled ? 2u : 1u,
+			.pAttachments = attachments,
 			.subpassCount = 1,
 			.pSubpasses = &subpass,
-			.dependencyCount = 0,
-			.pDependencies = nullptr
+			.dependencyCount = this->isHeadless ? 1u : 0u,
+			.pDependencies = this->isHeadless ? &readbackDependency : nullptr
 		};
 		CHECK_VK_RESULT(vkCreateRenderPass(this->vkDevice, &createInfo, nullptr, &this->vkRenderPass));
 	}
 
-	CHECK_VK_RESULT(vkGetSwapchainImagesKHR(this->vkDevice, this->vkSwapchain, &this->vkFramesCount, nullptr));
-	std::vector<VkImage> images(this->vkFramesCount);
-	CHECK_VK_RESULT(vkGetSwapchainImagesKHR(this->vkDevice, this->vkSwapchain, &this->vkFramesCount, images.data()));
-	this->vkSwapchainResources.resize(this->vkFramesCount);
-
-	VkCommandBufferAllocateInfo cbAllocInfo = {
-		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-		.pNext = nullptr,
-		.commandPool = this->vkCommandPool,
-		.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-		.commandBufferCount = this->vkFramesCount
-	};
-	std::vector<VkCommandBuffer> commandBuffers(this->vkFramesCount);
-	CHECK_VK_RESULT(vkAllocateCommandBuffers(this->vkDevice, &cbAllocInfo, commandBuffers.data()));
+	std::vector<VkImage> images(this->vkImageCount);
+	if (!this->isHeadless) {
+		CHECK_VK_RESULT(vkGetSwapchainImagesKHR(this->vkDevice, this->vkSwapchain, &this->vkImageCount, nullptr));
+		images.resize(this->vkImageCount);
+		CHECK_VK_RESULT(vkGetSwapchainImagesKHR(this->vkDevice, this->vkSwapchain, &this->vkImageCount, images.data()));
+	}
+	this->vkSwapchainResources.resize(this->vkImageCount);
 
 	for (std::size_t i = 0; i < images.size(); i++) {
 		auto &currentSwapchainResource = this->vkSwapchainResources[i];
 
-		currentSwapchainResource.commandBuffer = commandBuffers[i];
 		currentSwapchainResource.image = images[i];
+		if (this->isHeadless && !this->CreateOffscreenImage(currentSwapchainResource))
+			return false;
 
 		VkImageViewCreateInfo ivCreateInfo = {
 			.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
@@ -799,59 +1424,159 @@ bool Core::InitVulkanSwapchain()
 			}
 		};
 		CHECK_VK_RESULT(vkCreateImageView(this->vkDevice, &ivCreateInfo, nullptr, &currentSwapchainResource.imageView));
+		if (isMultisampled && !this->CreateMultisampleImage(currentSwapchainResource))
+			return false;
 
+		const VkImageView framebufferAttachments[] = { isMultisampled ? currentSwapchainResource.multisampleImageView : currentSwapchainResource.imageView, currentSwapchainResource.imageView };
 		VkFramebufferCreateInfo fbCreateInfo = {
 			.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
 			.pNext = nullptr,
 			.flags = 0,
 			.renderPass = this->vkRenderPass,
-			.attachmentCount = 1,
-			.pAttachments = &currentSwapchainResource.imageView,
+			.attachmentCount = isMultisampled ? 2u : 1u,
+			.pAttachments = framebufferAttachments,
 			.width = static_cast<uint32_t>(width),
 			.height = static_cast<uint32_t>(height),
 			.layers = 1
 		};
 		CHECK_VK_RESULT(vkCreateFramebuffer(this->vkDevice, &fbCreateInfo, nullptr, &currentSwapchainResource.framebuffer));
 
-		VkSemaphoreCreateInfo beginSemaphoreCreateInfo = {
-			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
-			.pNext = nullptr,
-			.flags = 0
-		};
-		CHECK_VK_RESULT(vkCreateSemaphore(this->vkDevice, &beginSemaphoreCreateInfo, nullptr, &currentSwapchainResource.startSemaphore));
-		VkSemaphoreCreateInfo endSemaphoreCreateInfo = {
-			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
-			.pNext = nullptr,
-			.flags = 0
-		};
-		CHECK_VK_RESULT(vkCreateSemaphore(this->vkDevice, &endSemaphoreCreateInfo, nullptr, &currentSwapchainResource.endSemaphore));
+		// Per image rather than per frame, an image is only acquired again once its present is done with the semaphore
+		if (!this->isHeadless) {
+			VkSemaphoreCreateInfo semaphoreCreateInfo = {
+				.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+				.pNext = nullptr,
+				.flags = 0
+			};
+			CHECK_VK_RESULT(vkCreateSemaphore(this->vkDevice, &semaphoreCreateInfo, nullptr, &currentSwapchainResource.presentSemaphore));
+		}
+	}
 
-		VkFenceCreateInfo fenceCreateInfo = {
-			.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
-			.pNext = nullptr,
-			.flags = VK_FENCE_CREATE_SIGNALED_BIT
-		};
-		CHECK_VK_RESULT(vkCreateFence(this->vkDevice, &fenceCreateInfo, nullptr, &currentSwapchainResource.fence));
+	return true;
+}
+bool Core::CreateMultisampleImage(SwapchainResources &swapchainResource)
+{
+	VkImageCreateInfo imageCreateInfo = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.imageType = VK_IMAGE_TYPE_2D,
+		.format = this->vkSwapchainFormat,
+		.extent = { this->width, this->height, 1 },
+		.mipLevels = 1,
+		.arrayLayers = 1,
+		.samples = this->vkSampleCount,
+		.tiling = VK_IMAGE_TILING_OPTIMAL,
+		.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
+		.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+		.queueFamilyIndexCount = 0,
+		.pQueueFamilyIndices = nullptr,
+		.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
+	};
+	if (!CHECK_VK_RESULT(vkCreateImage(this->vkDevice, &imageCreateInfo, nullptr, &swapchainResource.multisampleImage))) {
+		std::cerr << "Vulkan: Failed to create multisample image" << std::endl;
+		return false;
+	}
 
-		currentSwapchainResource.lastFence = VK_NULL_HANDLE;
+	// Never stored, so tilers can keep it in tile memory without backing it at all
+	VkMemoryRequirements requirements;
+	vkGetImageMemoryRequirements(this->vkDevice, swapchainResource.multisampleImage, &requirements);
+	VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	const auto &memoryProperties = this->memoryAllocator->GetMemoryProperties();
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+		if ((requirements.memoryTypeBits & (1u << i)) && (memoryProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)) {
+			properties = VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+			break;
+		}
 	}
+	if (!this->memoryAllocator->Allocate(requirements, properties, swapchainResource.multisampleMemory, false)) {
+		std::cerr << "Vulkan: Failed to allocate multisample image memory" << std::endl;
+		return false;
+	}
+	if (!CHECK_VK_RESULT(vkBindImageMemory(this->vkDevice, swapchainResource.multisampleImage, swapchainResource.multisampleMemory.memory, swapchainResource.multisampleMemory.offset)))
+		return false;
+
+	VkImageViewCreateInfo ivCreateInfo = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.image = swapchainResource.multisampleImage,
+		.viewType = VK_IMAGE_VIEW_TYPE_2D,
+		.format = this->vkSwapchainFormat,
+		.components = VkComponentMapping{
+			.r = VK_COMPONENT_SWIZZLE_IDENTITY,
+			.g = VK_COMPONENT_SWIZZLE_IDENTITY,
+			.b = VK_COMPONENT_SWIZZLE_IDENTITY,
+			.a = VK_COMPONENT_SWIZZLE_IDENTITY
+		},
+		.subresourceRange = VkImageSubresourceRange{
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.baseMipLevel = 0,
+			.levelCount = 1,
+			.baseArrayLayer = 0,
+			.layerCount = 1
+		}
+	};
+	return CHECK_VK_RESULT(vkCreateImageView(this->vkDevice, &ivCreateInfo, nullptr, &swapchainResource.multisampleImageView));
+}
+
+bool Core::CreateOffscreenImage(SwapchainResources &swapchainResource)
+{
+	VkImageCreateInfo imageCreateInfo = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.imageType = VK_IMAGE_TYPE_2D,
+		.format = this->vkSwapchainFormat,
+		.extent = { this->width, this->height, 1 },
+		.mipLevels = 1,
+		.arrayLayers = 1,
+		.samples = VK_SAMPLE_COUNT_1_BIT,
+		.tiling = VK_IMAGE_TILING_OPTIMAL,
+		.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+		.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+		.queueFamilyIndexCount = 0,
+		.pQueueFamilyIndices = nullptr,
+		.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
+	};
+	if (!CHECK_VK_RESULT(vkCreateImage(this->vkDevice, &imageCreateInfo, nullptr, &swapchainResource.image))) {
+		std::cerr << "Vulkan: Failed to create offscreen image" << std::endl;
+		return false;
+	}
+	VkMemoryRequirements requirements;
+	vkGetImageMemoryRequirements(this->vkDevice, swapchainResource.image, &requirements);
+	if (!this->memoryAllocator->Allocate(requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, swapchainResource.imageMemory, false)) {
+		std::cerr << "Vulkan: Failed to allocate offscreen image memory" << std::endl;
+		return false;
+	}
+	if (!CHECK_VK_RESULT(vkBindImageMemory(this->vkDevice, swapchainResource.image, swapchainResource.imageMemory.memory, swapchainResource.imageMemory.offset)))
+		return false;
+
+	// Read on the CPU, cached memory makes that a lot faster where there is a choice
+	VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	const auto &memoryProperties = this->memoryAllocator->GetMemoryProperties();
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+		if ((memoryProperties.memoryTypes[i].propertyFlags & (properties | VK_MEMORY_PROPERTY_HOST_CACHED_BIT)) == (properties | VK_MEMORY_PROPERTY_HOST_CACHED_BIT)) {
+			properties |= VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+			break;
+		}
+	}
+	const VkDeviceSize size = static_cast<VkDeviceSize>(this->width) * this->height * 4;
+	if (!this->memoryAllocator->CreateBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, properties, swapchainResource.readbackBuffer, swapchainResource.readbackMemory)) {
+		std::cerr << "Vulkan: Failed to create readback buffer" << std::endl;
+		return false;
+	}
+	swapchainResource.readbackFrame = 0;
 
 	return true;
 }
+
 void Core::DestroyVulkanSwapchain()
 {
 	for (auto &swapchainResource : this->vkSwapchainResources) {
-		if (swapchainResource.fence) {
-			vkDestroyFence(this->vkDevice, swapchainResource.fence, nullptr);
-			swapchainResource.fence = nullptr;
-		}
-		if (swapchainResource.startSemaphore) {
-			vkDestroySemaphore(this->vkDevice, swapchainResource.startSemaphore, nullptr);
-			swapchainResource.startSemaphore = nullptr;
-		}
-		if (swapchainResource.endSemaphore) {
-			vkDestroySemaphore(this->vkDevice, swapchainResource.endSemaphore, nullptr);
-			swapchainResource.endSemaphore = nullptr;
+		if (swapchainResource.presentSemaphore) {
+			vkDestroySemaphore(this->vkDevice, swapchainResource.presentSemaphore, nullptr);
+			swapchainResource.presentSemaphore = nullptr;
 		}
 		if (swapchainResource.framebuffer) {
 			vkDestroyFramebuffer(this->vkDevice, swapchainResource.framebuffer, nullptr);
@@ -861,10 +1586,24 @@ void Core::DestroyVulkanSwapchain()
 			vkDestroyImageView(this->vkDevice, swapchainResource.imageView, nullptr);
 			swapchainResource.imageView = nullptr;
 		}
-		if (swapchainResource.commandBuffer) {
-			vkFreeCommandBuffers(this->vkDevice, this->vkCommandPool, 1, &swapchainResource.commandBuffer);
-			swapchainResource.commandBuffer = nullptr;
+		// Swapchain images belong to the swapchain
+		if (swapchainResource.imageMemory.memory) {
+			vkDestroyImage(this->vkDevice, swapchainResource.image, nullptr);
+			this->memoryAllocator->Free(swapchainResource.imageMemory);
+		}
+		swapchainResource.image = nullptr;
+		if (swapchainResource.readbackBuffer)
+			this->memoryAllocator->DestroyBuffer(swapchainResource.readbackBuffer, swapchainResource.readbackMemory);
+		if (swapchainResource.multisampleImageView) {
+			vkDestroyImageView(this->vkDevice, swapchainResource.multisampleImageView, nullptr);
+			swapchainResource.multisampleImageView = nullptr;
+		}
+		if (swapchainResource.multisampleImage) {
+			vkDestroyImage(this->vkDevice, swapchainResource.multisampleImage, nullptr);
+			swapchainResource.multisampleImage = nullptr;
 		}
+		if (swapchainResource.multisampleMemory.memory)
+			this->memoryAllocator->Free(swapchainResource.multisampleMemory);
 	}
 	this->vkSwapchainResources.clear();
 	if (this->vkRenderPass) {
@@ -879,64 +1618,91 @@ void Core::DestroyVulkanSwapchain()
 
 bool Core::Render()
 {
-	// Wait for previous frame
-	auto &currentSwapchainResource = this->vkSwapchainResources[this->vkCurrentFrame];
+	if (this->isHeadless)
+		return this->RenderHeadless();
+
+	// FIFO blocks below until the display catches up, sleeping that time away first means fresher input in the frame
+	const auto delay = IsPacedPresentMode(this->vkPresentMode) ? this->framePacer.GetDelay() : FramePacer::Clock::duration::zero();
+	if (delay > FramePacer::Clock::duration::zero())
+		std::this_thread::sleep_for(delay);
+	const auto frameStart = FramePacer::Clock::now();
+
+	// Only waits for the submission framesInFlight frames back, the GPU keeps working on the later ones meanwhile
+	auto &frame = this->vkFrames[this->vkCurrentFrame];
+	if (!this->BeginFrame(frame))
+		return false;
 
-	CHECK_VK_RESULT(vkWaitForFences(this->vkDevice, 1, &currentSwapchainResource.fence, VK_TRUE, std::numeric_limits<uint64_t>::max()));
-	VkResult result = vkAcquireNextImageKHR(this->vkDevice, this->vkSwapchain, std::numeric_limits<uint64_t>::max(), currentSwapchainResource.startSemaphore, VK_NULL_HANDLE, &this->vkNextFrame);
-	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
-		CHECK_VK_RESULT(vkDeviceWaitIdle(this->vkDevice));
+	VkResult result = vkAcquireNextImageKHR(this->vkDevice, this->vkSwapchain, std::numeric_limits<uint64_t>::max(), frame.acquireSemaphore, VK_NULL_HANDLE, &this->vkImageIndex);
+	const auto acquired = FramePacer::Clock::now();
+	// Suboptimal still acquires the image and signals the semaphore, so the frame goes on and the present below resizes
+	if (result == VK_ERROR_OUT_OF_DATE_KHR) {
 		return OnResize();
 	}
 	else if (result < VK_SUCCESS) {
 		CHECK_VK_RESULT(result);
 	}
+	auto &swapchainResource = this->vkSwapchainResources[this->vkImageIndex];
 
-	auto &nextSwapchainResource = this->vkSwapchainResources[this->vkNextFrame];
-	if (nextSwapchainResource.lastFence) {
-		CHECK_VK_RESULT(vkWaitForFences(this->vkDevice, 1, &nextSwapchainResource.lastFence, VK_TRUE, std::numeric_limits<uint64_t>::max()));
-	}
-	nextSwapchainResource.lastFence = currentSwapchainResource.fence;
-
-	CHECK_VK_RESULT(vkResetFences(this->vkDevice, 1, &currentSwapchainResource.fence));
 	VkCommandBufferBeginInfo beginInfo {
 		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
 		.pNext = nullptr,
 		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
 		.pInheritanceInfo = nullptr
 	};
-	CHECK_VK_RESULT(vkBeginCommandBuffer(nextSwapchainResource.commandBuffer, &beginInfo));
+	CHECK_VK_RESULT(vkBeginCommandBuffer(frame.commandBuffer, &beginInfo));
 
 	// Prepare the current frame
 	if (onFrameCallback && !onFrameCallback(this->shared_from_this()))
 		return false;
+	// Read by the GPU only after the submission below, so the callback could still change it
+	this->viewUniforms->Update(this->vkCurrentFrame, this->width, this->height);
+
+	// Uploads recorded so far go to the queue ahead of the frame that uses them
+	if (!this->stagingBuffer->Flush())
+		return false;
+	this->TakeRetiredBuffers(frame);
 
 	// Present the current frame
-	CHECK_VK_RESULT(vkEndCommandBuffer(nextSwapchainResource.commandBuffer));
+	CHECK_VK_RESULT(vkEndCommandBuffer(frame.commandBuffer));
 	const VkPipelineStageFlags waitStageFlag = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 	VkSubmitInfo submitInfo = {
 		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
 		.pNext = nullptr,
 		.waitSemaphoreCount = 1,
-		.pWaitSemaphores = &currentSwapchainResource.startSemaphore,
+		.pWaitSemaphores = &frame.acquireSemaphore,
 		.pWaitDstStageMask = &waitStageFlag,
 		.commandBufferCount = 1,
-		.pCommandBuffers = &nextSwapchainResource.commandBuffer,
+		.pCommandBuffers = &frame.commandBuffer,
 		.signalSemaphoreCount = 1,
-		.pSignalSemaphores = &currentSwapchainResource.endSemaphore
+		.pSignalSemaphores = &swapchainResource.presentSemaphore
 	};
-	CHECK_VK_RESULT(vkQueueSubmit(this->vkGraphicsQueue, 1, &submitInfo, currentSwapchainResource.fence));
+	// Reset right before the submission that signals it, a frame that fails earlier leaves it signaled for BeginFrame
+	CHECK_VK_RESULT(vkResetFences(this->vkDevice, 1, &frame.fence));
+	if (!CHECK_VK_RESULT(vkQueueSubmit(this->vkGraphicsQueue, 1, &submitInfo, frame.fence)))
+		return false;
 	VkPresentInfoKHR presentInfo = {
 		.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
 		.pNext = nullptr,
 		.waitSemaphoreCount = 1,
-		.pWaitSemaphores = &currentSwapchainResource.endSemaphore,
+		.pWaitSemaphores = &swapchainResource.presentSemaphore,
 		.swapchainCount = 1,
 		.pSwapchains = &this->vkSwapchain,
-		.pImageIndices = &this->vkNextFrame,
+		.pImageIndices = &this->vkImageIndex,
 		.pResults = nullptr
 	};
+#ifdef __USE_WAYLAND__
+	// Goes out with the surface commit done by the present
+	this->RequestWaylandFrame();
+#endif // __USE_WAYLAND__
 	result = vkQueuePresentKHR(this->vkGraphicsQueue, &presentInfo);
+	const auto presented = FramePacer::Clock::now();
+	this->framePacer.OnFrame(delay, acquired - frameStart, presented - acquired, presented);
+	this->vkCurrentFrame = (this->vkCurrentFrame + 1) % this->vkFramesInFlight;
+#ifdef __USE_WAYLAND__
+	// Nothing was committed, the callback would never come
+	if (result < VK_SUCCESS)
+		this->CancelWaylandFrame();
+#endif // __USE_WAYLAND__
 	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
 		if (!OnResize())
 			return false;
@@ -945,24 +1711,160 @@ bool Core::Render()
 		CHECK_VK_RESULT(result);
 	}
 
-	this->vkCurrentFrame = (this->vkCurrentFrame + 1) % this->vkFramesCount;
+	return true;
+}
+
+bool Core::RenderHeadless()
+{
+	// No acquire, image i belongs to frame i
+	auto &frame = this->vkFrames[this->vkCurrentFrame];
+	auto &swapchainResource = this->vkSwapchainResources[this->vkCurrentFrame];
+	if (!this->BeginFrame(frame))
+		return false;
+	this->DeliverReadback(swapchainResource);
+	this->vkImageIndex = this->vkCurrentFrame;
 
+	VkCommandBufferBeginInfo beginInfo {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.pNext = nullptr,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+		.pInheritanceInfo = nullptr
+	};
+	CHECK_VK_RESULT(vkBeginCommandBuffer(frame.commandBuffer, &beginInfo));
+
+	// Has to record the render pass, the image is only defined after it
+	if (onFrameCallback && !onFrameCallback(this->shared_from_this()))
+		return false;
+	this->viewUniforms->Update(this->vkCurrentFrame, this->width, this->height);
+	if (!this->stagingBuffer->Flush())
+		return false;
+	this->TakeRetiredBuffers(frame);
+
+	// The render pass leaves the image in TRANSFER_SRC_OPTIMAL (and waits for its writes, see readbackDependency)
+	const VkBufferImageCopy region = {
+		.bufferOffset = 0,
+		.bufferRowLength = 0,
+		.bufferImageHeight = 0,
+		.imageSubresource = VkImageSubresourceLayers{
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.mipLevel = 0,
+			.baseArrayLayer = 0,
+			.layerCount = 1
+		},
+		.imageOffset = { 0, 0, 0 },
+		.imageExtent = { this->width, this->height, 1 }
+	};
+	vkCmdCopyImageToBuffer(frame.commandBuffer, swapchainResource.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, swapchainResource.readbackBuffer, 1, &region);
+	const VkMemoryBarrier hostBarrier = {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+		.pNext = nullptr,
+		.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_HOST_READ_BIT
+	};
+	vkCmdPipelineBarrier(frame.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &hostBarrier, 0, nullptr, 0, nullptr);
+	CHECK_VK_RESULT(vkEndCommandBuffer(frame.commandBuffer));
+
+	VkSubmitInfo submitInfo = {
+		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+		.pNext = nullptr,
+		.waitSemaphoreCount = 0,
+		.pWaitSemaphores = nullptr,
+		.pWaitDstStageMask = nullptr,
+		.commandBufferCount = 1,
+		.pCommandBuffers = &frame.commandBuffer,
+		.signalSemaphoreCount = 0,
+		.pSignalSemaphores = nullptr
+	};
+	// Reset right before the submission that signals it, so WaitForReadbacks never waits on a frame that failed earlier
+	CHECK_VK_RESULT(vkResetFences(this->vkDevice, 1, &frame.fence));
+	if (!CHECK_VK_RESULT(vkQueueSubmit(this->vkGraphicsQueue, 1, &submitInfo, frame.fence)))
+		return false;
+	// Picked up the next time this frame comes round, or by WaitForReadbacks
+	swapchainResource.readbackFrame = ++this->headlessFrameNumber;
+
+	this->vkCurrentFrame = (this->vkCurrentFrame + 1) % this->vkFramesInFlight;
+
+	return true;
+}
+
+void Core::DeliverReadback(SwapchainResources &swapchainResource)
+{
+	if (!swapchainResource.readbackFrame)
+		return;
+	const auto frame = swapchainResource.readbackFrame - 1;
+	swapchainResource.readbackFrame = 0;
+	if (this->onReadbackCallback)
+		this->onReadbackCallback(this->shared_from_this(), frame, std::span<const uint8_t>(swapchainResource.readbackMemory.mapped, static_cast<std::size_t>(this->width) * this->height * 4));
+}
+
+bool Core::WaitForReadbacks()
+{
+	if (!this->isHeadless)
+		return true;
+	// Oldest frame first, it's the one the ring would reuse next
+	const auto count = std::min(this->vkSwapchainResources.size(), this->vkFrames.size());
+	for (std::size_t i = 0; i < count; i++) {
+		const auto index = (this->vkCurrentFrame + i) % count;
+		// Never submitted (or already delivered), its fence may be reset with nothing to signal it
+		if (!this->vkSwapchainResources[index].readbackFrame)
+			continue;
+		if (!CHECK_VK_RESULT(vkWaitForFences(this->vkDevice, 1, &this->vkFrames[index].fence, VK_TRUE, std::numeric_limits<uint64_t>::max())))
+			return false;
+		this->DeliverReadback(this->vkSwapchainResources[index]);
+	}
 	return true;
 }
 
 bool Core::OnResize()
 {
+	// Frames in flight would be lost with their images
+	if (this->isHeadless && !this->WaitForReadbacks())
+		return false;
 	CHECK_VK_RESULT(vkDeviceWaitIdle(this->vkDevice));
 
+	// The frames in flight don't depend on the swapchain and stay
 	this->DestroyVulkanSwapchain();
 	if (!this->InitVulkanSwapchain())
 		return false;
-
-	this->vkCurrentFrame = 0;
+	// The new images have nothing in them yet
+	this->isDirty = true;
 
 	return true;
 }
 
+bool Core::SetPresentPolicy(const PresentPolicy policy)
+{
+	if (policy == this->presentPolicy)
+		return true;
+	this->presentPolicy = policy;
+
+	// Not created yet (or headless), InitVulkanSwapchain picks it up
+	if (this->isHeadless || this->vkSwapchainResources.empty())
+		return true;
+	return this->OnResize();
+}
+
+bool Core::SetVulkanSampleCount(const VkSampleCountFlagBits sampleCount)
+{
+	// Highest supported count not above the requested one, 1 is always supported
+	const auto supported = this->vkPhysicalDeviceProperties.limits.framebufferColorSampleCounts;
+	auto count = VK_SAMPLE_COUNT_1_BIT;
+	for (auto bit = static_cast<uint32_t>(sampleCount); bit > 1; bit >>= 1) {
+		if (supported & bit) {
+			count = static_cast<VkSampleCountFlagBits>(bit);
+			break;
+		}
+	}
+	if (count == this->vkSampleCount)
+		return true;
+	this->vkSampleCount = count;
+
+	// Not created yet, InitVulkanSwapchain picks it up
+	if (this->vkSwapchainResources.empty())
+		return true;
+	return this->OnResize();
+}
+
 void Core::OnDestroy()
 {
 	CHECK_VK_RESULT(vkDeviceWaitIdle(this->vkDevice));
@@ -979,6 +1881,16 @@ void Core::Run()
 		std::cerr << "Failed to initialize application" << std::endl;
 		return;
 	}
+	// Most pipelines are made during initialization, keep them even if the app doesn't exit cleanly
+	this->SaveVulkanPipelineCache();
+	if (this->isHeadless) {
+		while (!this->isGoingToClose) {
+			if (!this->Render())
+				break;
+		}
+		this->WaitForReadbacks();
+		return;
+	}
 #ifdef __USE_WAYLAND__
 	while (!this->isGoingToClose) {
 		if (this->readyToResize && this->resize) {
@@ -996,10 +1908,17 @@ void Core::Run()
 			wl_surface_commit(this->wlSurface);
 		}
 
-		if (!this->Render())
+		// Cleared first, so onFrameCallback can ask for the next one
+		if (this->isDirty && !this->wlFrameCallback) {
+			this->isDirty = false;
+			if (!this->Render())
+				break;
+		}
+
+		if (!this->DispatchWaylandEvents()) {
+			std::cerr << "Wayland: Failed to dispatch events" << std::endl;
 			break;
-		
-		wl_display_dispatch(this->wlDisplay);
+		}
 	}
 #endif // __USE_WAYLAND__
 #ifdef __PLATFORM_WINDOWS__
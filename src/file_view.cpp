@@ -0,0 +1,165 @@
+#include "file_view.hpp"
+#include <algorithm>
+#include <iostream>
+#ifdef __PLATFORM_WINDOWS__
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else // __PLATFORM_WINDOWS__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // __PLATFORM_WINDOWS__
+
+namespace {
+	std::size_t GetPageSize()
+	{
+#ifdef __PLATFORM_WINDOWS__
+		static const auto pageSize = []() {
+			SYSTEM_INFO systemInfo;
+			GetSystemInfo(&systemInfo);
+			return static_cast<std::size_t>(systemInfo.dwPageSize);
+		}();
+#else // __PLATFORM_WINDOWS__
+		static const auto pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+#endif // __PLATFORM_WINDOWS__
+		return pageSize;
+	}
+}
+
+FileView::~FileView()
+{
+#ifdef __PLATFORM_WINDOWS__
+	if (this->data)
+		UnmapViewOfFile(this->data);
+	if (this->mapping)
+		CloseHandle(this->mapping);
+#else // __PLATFORM_WINDOWS__
+	if (this->data)
+		munmap(const_cast<uint8_t*>(this->data), this->size);
+#endif // __PLATFORM_WINDOWS__
+}
+
+bool FileView::Init(const std::filesystem::path &filePath)
+{
+#ifdef __PLATFORM_WINDOWS__
+	const auto file = CreateFileW(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		std::cerr << "File: " << filePath.string() << " failed to open" << std::endl;
+		return false;
+	}
+	MyDefer closeFile([file]() { CloseHandle(file); });
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize)) {
+		std::cerr << "File: " << filePath.string() << " failed to get size" << std::endl;
+		return false;
+	}
+	this->size = static_cast<std::size_t>(fileSize.QuadPart);
+	if (!this->size)
+		return true;
+
+	this->mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (this->mapping)
+		this->data = static_cast<const uint8_t*>(MapViewOfFile(this->mapping, FILE_MAP_READ, 0, 0, 0));
+#else // __PLATFORM_WINDOWS__
+	const auto file = open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+	if (file < 0) {
+		std::cerr << "File: " << filePath.string() << " failed to open" << std::endl;
+		return false;
+	}
+	// The mapping keeps its own reference to the file
+	MyDefer closeFile([file]() { close(file); });
+	struct stat fileStat;
+	if (fstat(file, &fileStat) != 0) {
+		std::cerr << "File: " << filePath.string() << " failed to get size" << std::endl;
+		return false;
+	}
+	this->size = static_cast<std::size_t>(fileStat.st_size);
+	if (!this->size)
+		return true;
+
+	const auto mapped = mmap(nullptr, this->size, PROT_READ, MAP_PRIVATE, file, 0);
+	if (mapped != MAP_FAILED)
+		this->data = static_cast<const uint8_t*>(mapped);
+#endif // __PLATFORM_WINDOWS__
+
+	if (!this->data) {
+		std::cerr << "File: " << filePath.string() << " failed to map" << std::endl;
+		this->size = 0;
+		return false;
+	}
+	return true;
+}
+
+std::future<FileViewPtr> FileView::CreateAsync(const std::filesystem::path &filePath, const AccessHint hint)
+{
+	return std::async(std::launch::async, [filePath, hint]() -> FileViewPtr {
+		auto view = FileView::Create(filePath, hint);
+		if (view) {
+			view->Advise(AccessHint::WillNeed);
+			view->Load(0, view->GetSize());
+		}
+		return view;
+	});
+}
+
+void FileView::Advise(const AccessHint hint, const std::size_t offset, const std::size_t size) const
+{
+	std::size_t pageOffset, pageSize;
+	if (!this->GetPageRange(offset, size, pageOffset, pageSize))
+		return;
+#ifdef __PLATFORM_WINDOWS__
+	// Windows only has an equivalent of WillNeed
+	if (hint == AccessHint::WillNeed) {
+		WIN32_MEMORY_RANGE_ENTRY range = { .VirtualAddress = const_cast<uint8_t*>(this->data + pageOffset), .NumberOfBytes = pageSize };
+		PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+	}
+#else // __PLATFORM_WINDOWS__
+	int advice = POSIX_MADV_NORMAL;
+	switch (hint) {
+	case AccessHint::Normal: advice = POSIX_MADV_NORMAL; break;
+	case AccessHint::Sequential: advice = POSIX_MADV_SEQUENTIAL; break;
+	case AccessHint::Random: advice = POSIX_MADV_RANDOM; break;
+	case AccessHint::WillNeed: advice = POSIX_MADV_WILLNEED; break;
+	}
+	// Only a hint, failing is harmless
+	posix_madvise(const_cast<uint8_t*>(this->data + pageOffset), pageSize, advice);
+#endif // __PLATFORM_WINDOWS__
+}
+
+std::future<void> FileView::Prefetch(const std::size_t offset, const std::size_t size)
+{
+	std::size_t pageOffset, pageSize;
+	if (!this->GetPageRange(offset, size, pageOffset, pageSize)) {
+		std::promise<void> done;
+		done.set_value();
+		return done.get_future();
+	}
+	this->Advise(AccessHint::WillNeed, pageOffset, pageSize);
+	return std::async(std::launch::async, [self = this->shared_from_this(), pageOffset, pageSize]() {
+		self->Load(pageOffset, pageSize);
+	});
+}
+
+bool FileView::GetPageRange(const std::size_t offset, const std::size_t size, std::size_t &pageOffset, std::size_t &pageSize) const
+{
+	if (!this->data || offset >= this->size)
+		return false;
+	const auto end = offset + std::min(size, this->size - offset);
+	pageOffset = offset / GetPageSize() * GetPageSize();
+	pageSize = end - pageOffset;
+	return true;
+}
+
+void FileView::Load(const std::size_t pageOffset, const std::size_t pageSize) const
+{
+	// Volatile, so the reads aren't optimized away
+	const volatile uint8_t *bytes = this->data + pageOffset;
+	uint8_t sum = 0;
+	for (std::size_t i = 0; i < pageSize; i += GetPageSize())
+		sum ^= bytes[i];
+	if (pageSize)
+		sum ^= bytes[pageSize - 1];
+	static_cast<void>(sum);
+}
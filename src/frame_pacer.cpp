@@ -0,0 +1,82 @@
+#include "frame_pacer.hpp"
+#include <algorithm>
+
+namespace {
+	typedef std::chrono::duration<double, std::milli> Milliseconds;
+
+	// Weight of the newest frame in the averages
+	constexpr double smoothing = 0.1;
+	// Longer gaps between presents are idle time (nothing to draw), not slow frames
+	constexpr double idleFactor = 4.0;
+	// A frame this much longer than the average interval missed its refresh
+	constexpr double missFactor = 1.5;
+	// Blocked time kept in every frame to absorb jitter, a share of the interval but at least minMargin
+	constexpr double marginShare = 0.1;
+	constexpr double minMargin = 0.5;
+
+	double Average(const double average, const double value)
+	{
+		return average + (value - average) * smoothing;
+	}
+}
+
+void FramePacer::SetEnabled(const bool isEnabled)
+{
+	this->isEnabled = isEnabled;
+	if (!isEnabled)
+		this->delay = 0.0;
+}
+
+void FramePacer::Reset()
+{
+	this->statistics = Statistics{};
+	this->delay = 0.0;
+	this->hasLastPresented = false;
+}
+
+FramePacer::Clock::duration FramePacer::GetDelay() const
+{
+	if (!this->isEnabled || this->delay <= 0.0)
+		return Clock::duration::zero();
+	return std::chrono::duration_cast<Clock::duration>(Milliseconds(this->delay));
+}
+
+void FramePacer::OnFrame(const Clock::duration delay, const Clock::duration wait, const Clock::duration work, const Clock::time_point presented)
+{
+	const auto delayTime = Milliseconds(delay).count();
+	const auto waitTime = Milliseconds(wait).count();
+	const auto workTime = Milliseconds(work).count();
+	this->statistics.delay = Average(this->statistics.delay, delayTime);
+	this->statistics.wait = Average(this->statistics.wait, waitTime);
+	this->statistics.work = Average(this->statistics.work, workTime);
+
+	const auto interval = this->hasLastPresented ? Milliseconds(presented - this->lastPresented).count() : 0.0;
+	this->lastPresented = presented;
+	const bool wasPresented = this->hasLastPresented;
+	this->hasLastPresented = true;
+	if (!wasPresented)
+		return;
+	if (this->statistics.interval <= 0.0) {
+		this->statistics.interval = interval;
+		return;
+	}
+	if (interval > this->statistics.interval * idleFactor)
+		return;
+
+	const bool isMissed = interval > this->statistics.interval * missFactor;
+	this->statistics.interval = Average(this->statistics.interval, interval);
+	if (isMissed)
+		this->statistics.missedCount++;
+	if (!this->isEnabled)
+		return;
+
+	// Slept too long (or the frame got heavier), give the time back quickly
+	if (isMissed) {
+		this->delay *= 0.5;
+		return;
+	}
+	// Whatever was still blocked beyond the margin can be slept before the frame instead
+	const auto margin = std::max(minMargin, this->statistics.interval * marginShare);
+	const auto target = std::max(0.0, delayTime + waitTime - margin);
+	this->delay = std::clamp(Average(this->delay, target), 0.0, this->statistics.interval);
+}
@@ -1,17 +1,51 @@
 #include "core.hpp"
 #include "application.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <string_view>
 
-int main()
+int main(int argc, char **argv)
 {
-	auto core = Core::Create();
+	// --headless renders a single frame without a window and writes it to frame.ppm,
+	// --assets <directory> replaces ../assets, --pipeline-cache <file> replaces pipeline.cache
+	bool isHeadless = false;
+	std::filesystem::path pipelineCachePath;
+	for (int i = 1; i < argc; i++) {
+		const std::string_view argument = argv[i];
+		if (argument == "--headless")
+			isHeadless = true;
+		else if (argument == "--assets" && i + 1 < argc)
+			Application::SetAssetDirectory(argv[++i]);
+		else if (argument == "--pipeline-cache" && i + 1 < argc)
+			pipelineCachePath = argv[++i];
+	}
+	auto core = isHeadless ? Core::CreateHeadless(1280, 720) : Core::Create();
 	if (!core)
 		return 1;
+	if (!pipelineCachePath.empty())
+		core->SetVulkanPipelineCachePath(pipelineCachePath);
 
 	core->SetOnInitCallback(Application::OnInitialize);
 	core->SetOnDestroyCallback(Application::OnDestroy);
-	core->SetOnFrameCallback(Application::OnFrame);
+	if (!isHeadless)
+		core->SetOnFrameCallback(Application::OnFrame);
+	else {
+		core->SetOnFrameCallback([](const CorePtr core) {
+			core->RequestClose();
+			return Application::OnFrame(core);
+		});
+		core->SetOnReadbackCallback([](const CorePtr core, uint64_t, std::span<const uint8_t> pixels) {
+			std::ofstream file("frame.ppm", std::ios::binary);
+			file << "P6\n" << core->GetWidth() << " " << core->GetHeight() << "\n255\n";
+			for (std::size_t i = 0; i + 3 < pixels.size(); i += 4)
+				file.write(reinterpret_cast<const char*>(pixels.data() + i), 3);
+		});
+	}
 
 	core->Run();
 
 	return 0;
-}
\ No newline at end of file
+}
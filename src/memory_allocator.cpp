@@ -0,0 +1,223 @@
+#include "memory_allocator.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <iostream>
+
+MemoryAllocator::~MemoryAllocator()
+{
+	if (this->allocationCount)
+		std::cerr << "Vulkan: " << this->allocationCount << " device memory allocations are still alive" << std::endl;
+	for (auto &typeBlocks : this->blocks) {
+		for (auto &block : typeBlocks)
+			this->DestroyBlock(block);
+		typeBlocks.clear();
+	}
+}
+
+bool MemoryAllocator::Init(const VkPhysicalDevice vkPhysicalDevice, const VkDevice vkDevice, const VkDeviceSize blockSize)
+{
+	this->vkDevice = vkDevice;
+	this->blockSize = blockSize;
+	vkGetPhysicalDeviceMemoryProperties(vkPhysicalDevice, &this->memoryProperties);
+
+	return this->vkDevice != VK_NULL_HANDLE;
+}
+
+std::tuple<uint32_t, ErrorFlag> MemoryAllocator::FindMemoryType(const uint32_t typeFilter, const VkMemoryPropertyFlags properties) const
+{
+	for (uint32_t i = 0; i < this->memoryProperties.memoryTypeCount; i++) {
+		if ((typeFilter & (1 << i)) && (this->memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+			return {i, false};
+		}
+	}
+
+	std::cerr << "Vulkan: Failed to find suitable memory type!" << std::endl;
+	return {0, true};
+}
+
+bool MemoryAllocator::Allocate(const VkMemoryRequirements &requirements, const VkMemoryPropertyFlags properties, Allocation &allocation, const bool isLinear)
+{
+	const auto [memoryTypeIndex, errorFlag] = this->FindMemoryType(requirements.memoryTypeBits, properties);
+	if (errorFlag)
+		return false;
+
+	// Small heaps (like the 256 MiB device local + host visible one) shouldn't go to a single block
+	const auto heapSize = this->memoryProperties.memoryHeaps[this->memoryProperties.memoryTypes[memoryTypeIndex].heapIndex].size;
+	const auto typeBlockSize = std::max<VkDeviceSize>(std::min(this->blockSize, heapSize / 8), 1024 * 1024);
+	const auto alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+
+	std::lock_guard lock(this->mutex);
+	auto &typeBlocks = this->blocks[memoryTypeIndex];
+	uint32_t blockIndex = 0;
+	VkDeviceSize offset = 0;
+	bool isFound = false;
+	if (requirements.size > typeBlockSize / 2) {
+		if (!this->CreateBlock(memoryTypeIndex, requirements.size, true, isLinear, blockIndex))
+			return false;
+		isFound = typeBlocks[blockIndex].ranges.Allocate(requirements.size, alignment, offset);
+	}
+	else {
+		for (blockIndex = 0; blockIndex < typeBlocks.size(); blockIndex++) {
+			auto &block = typeBlocks[blockIndex];
+			if (!block.memory || block.isDedicated || block.isLinear != isLinear)
+				continue;
+			if ((isFound = block.ranges.Allocate(requirements.size, alignment, offset)))
+				break;
+		}
+		if (!isFound) {
+			if (!this->CreateBlock(memoryTypeIndex, typeBlockSize, false, isLinear, blockIndex))
+				return false;
+			isFound = typeBlocks[blockIndex].ranges.Allocate(requirements.size, alignment, offset);
+		}
+	}
+	if (!isFound) {
+		std::cerr << "Vulkan: Failed to sub-allocate " << requirements.size << " bytes" << std::endl;
+		return false;
+	}
+
+	auto &block = typeBlocks[blockIndex];
+	this->allocationCount++;
+	allocation = Allocation{
+		.memory = block.memory,
+		.offset = offset,
+		.size = requirements.size,
+		.mapped = block.mapped ? block.mapped + offset : nullptr,
+		.memoryTypeIndex = memoryTypeIndex,
+		.blockIndex = blockIndex
+	};
+	return true;
+}
+
+void MemoryAllocator::Free(Allocation &allocation)
+{
+	if (!allocation.memory)
+		return;
+
+	std::lock_guard lock(this->mutex);
+	auto &block = this->blocks[allocation.memoryTypeIndex][allocation.blockIndex];
+	if (block.memory != allocation.memory) {
+		std::cerr << "Vulkan: Freeing memory that doesn't belong to the allocator" << std::endl;
+		return;
+	}
+	this->allocationCount--;
+	if (block.isDedicated) {
+		this->DestroyBlock(block);
+	}
+	else {
+		block.ranges.Free(allocation.offset, allocation.size);
+		// Keep one empty block per memory type around, so a mesh recreated every frame doesn't hit vkAllocateMemory
+		const auto &typeBlocks = this->blocks[allocation.memoryTypeIndex];
+		if (block.ranges.IsEmpty() && std::any_of(typeBlocks.begin(), typeBlocks.end(), [&block](const Block &other) {
+			return &other != &block && other.memory && !other.isDedicated && other.ranges.IsEmpty();
+		}))
+			this->DestroyBlock(block);
+	}
+	allocation = Allocation{};
+}
+
+bool MemoryAllocator::CreateBuffer(const VkDeviceSize size, const VkBufferUsageFlags usage, const VkMemoryPropertyFlags properties, VkBuffer &buffer, Allocation &allocation)
+{
+	VkBufferCreateInfo bufferInfo = {
+		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.size = size,
+		.usage = usage,
+		.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+		.queueFamilyIndexCount = 0,
+		.pQueueFamilyIndices = nullptr
+	};
+
+	if (!CHECK_VK_RESULT(vkCreateBuffer(this->vkDevice, &bufferInfo, nullptr, &buffer))) {
+		std::cerr << "Vulkan: Failed to create buffer" << std::endl;
+		return false;
+	}
+
+	VkMemoryRequirements memRequirements;
+	vkGetBufferMemoryRequirements(this->vkDevice, buffer, &memRequirements);
+	if (!this->Allocate(memRequirements, properties, allocation)) {
+		std::cerr << "Vulkan: Failed to allocate buffer memory" << std::endl;
+		vkDestroyBuffer(this->vkDevice, buffer, nullptr);
+		buffer = VK_NULL_HANDLE;
+		return false;
+	}
+
+	if (!CHECK_VK_RESULT(vkBindBufferMemory(this->vkDevice, buffer, allocation.memory, allocation.offset))) {
+		this->DestroyBuffer(buffer, allocation);
+		return false;
+	}
+
+	return true;
+}
+
+void MemoryAllocator::DestroyBuffer(VkBuffer &buffer, Allocation &allocation)
+{
+	if (buffer) {
+		vkDestroyBuffer(this->vkDevice, buffer, nullptr);
+		buffer = VK_NULL_HANDLE;
+	}
+	this->Free(allocation);
+}
+
+MemoryAllocator::Statistics MemoryAllocator::GetStatistics()
+{
+	std::lock_guard lock(this->mutex);
+	Statistics statistics;
+	statistics.allocationCount = this->allocationCount;
+	for (const auto &typeBlocks : this->blocks) {
+		for (const auto &block : typeBlocks) {
+			if (!block.memory)
+				continue;
+			statistics.blockCount++;
+			statistics.reservedSize += block.ranges.GetSize();
+			statistics.usedSize += block.ranges.GetUsedSize();
+		}
+	}
+	return statistics;
+}
+
+bool MemoryAllocator::CreateBlock(const uint32_t memoryTypeIndex, const VkDeviceSize size, const bool isDedicated, const bool isLinear, uint32_t &blockIndex)
+{
+	VkMemoryAllocateInfo allocInfo = {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+		.pNext = nullptr,
+		.allocationSize = size,
+		.memoryTypeIndex = memoryTypeIndex
+	};
+	Block block;
+	if (!CHECK_VK_RESULT(vkAllocateMemory(this->vkDevice, &allocInfo, nullptr, &block.memory))) {
+		std::cerr << "Vulkan: Failed to allocate memory block" << std::endl;
+		return false;
+	}
+	if (this->memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+		void *data;
+		if (!CHECK_VK_RESULT(vkMapMemory(this->vkDevice, block.memory, 0, VK_WHOLE_SIZE, 0, &data))) {
+			vkFreeMemory(this->vkDevice, block.memory, nullptr);
+			return false;
+		}
+		block.mapped = static_cast<uint8_t*>(data);
+	}
+	block.ranges.Reset(size);
+	block.isDedicated = isDedicated;
+	block.isLinear = isLinear;
+
+	// Reuse the slot of a released block, allocations keep their block index
+	auto &typeBlocks = this->blocks[memoryTypeIndex];
+	const auto slot = std::find_if(typeBlocks.begin(), typeBlocks.end(), [](const Block &block) { return !block.memory; });
+	blockIndex = static_cast<uint32_t>(slot - typeBlocks.begin());
+	if (slot == typeBlocks.end())
+		typeBlocks.push_back(std::move(block));
+	else
+		*slot = std::move(block);
+	return true;
+}
+
+void MemoryAllocator::DestroyBlock(Block &block)
+{
+	if (!block.memory)
+		return;
+	if (block.mapped)
+		vkUnmapMemory(this->vkDevice, block.memory);
+	vkFreeMemory(this->vkDevice, block.memory, nullptr);
+	block = Block{};
+}
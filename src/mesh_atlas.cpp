@@ -0,0 +1,262 @@
+#include "core.hpp"
+#include "mesh_atlas.hpp"
+#include "staging_buffer.hpp"
+#include <algorithm>
+#include <iostream>
+
+MeshAtlas::~MeshAtlas()
+{
+	if (const auto core = this->coreWeak.lock()) {
+		// Frames in flight may still draw from them
+		core->RetireBuffer(this->vertexBuffer, this->vertexBufferMemory);
+		core->RetireBuffer(this->indexBuffer, this->indexBufferMemory);
+		this->vertexBuffer = VK_NULL_HANDLE;
+		this->indexBuffer = VK_NULL_HANDLE;
+	}
+}
+
+bool MeshAtlas::Init(const CorePtr core, const uint32_t vertexCapacity, const uint32_t indexCapacity, const uint32_t vertexStride)
+{
+	if (!core->GetVulkanDevice())
+		return false;
+	if (!vertexCapacity || !indexCapacity || !vertexStride)
+		return false;
+
+	this->coreWeak = core;
+	this->vertexStride = vertexStride;
+	if (!this->CreateBuffers(core, vertexCapacity, indexCapacity, this->vertexBuffer, this->vertexBufferMemory, this->indexBuffer, this->indexBufferMemory))
+		return false;
+	this->vertexRanges.Reset(vertexCapacity);
+	this->indexRanges.Reset(indexCapacity);
+
+	return true;
+}
+
+bool MeshAtlas::CreateBuffers(const CorePtr core, const uint32_t vertexCapacity, const uint32_t indexCapacity, VkBuffer &vertexBuffer, MemoryAllocator::Allocation &vertexBufferMemory, VkBuffer &indexBuffer, MemoryAllocator::Allocation &indexBufferMemory) const
+{
+	const auto memoryAllocator = core->GetMemoryAllocator();
+	// Transfer source too, compaction copies out of them
+	if (!memoryAllocator->CreateBuffer(static_cast<VkDeviceSize>(vertexCapacity) * this->vertexStride,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		vertexBuffer, vertexBufferMemory))
+		return false;
+	if (!memoryAllocator->CreateBuffer(sizeof(Mesh::Indices::value_type) * static_cast<VkDeviceSize>(indexCapacity),
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		indexBuffer, indexBufferMemory)) {
+		memoryAllocator->DestroyBuffer(vertexBuffer, vertexBufferMemory);
+		return false;
+	}
+
+	return true;
+}
+
+MeshAtlas::Handle MeshAtlas::Add(const void *vertexData, const uint32_t vertexCount, std::span<const Mesh::Indices::value_type> indices)
+{
+	const auto core = this->coreWeak.lock();
+	if (!core)
+		return invalidHandle;
+	if (!vertexCount || indices.empty() || indices.size() > std::numeric_limits<uint32_t>::max()) {
+		std::cerr << "Vulkan: Can't add an empty mesh to the atlas" << std::endl;
+		return invalidHandle;
+	}
+	const auto indexCount = static_cast<uint32_t>(indices.size());
+
+	uint64_t vertexOffset = 0, firstIndex = 0;
+	const auto reserve = [this, vertexCount, indexCount, &vertexOffset, &firstIndex]() {
+		if (!this->vertexRanges.Allocate(vertexCount, 1, vertexOffset))
+			return false;
+		if (!this->indexRanges.Allocate(indexCount, 1, firstIndex)) {
+			this->vertexRanges.Free(vertexOffset, vertexCount);
+			return false;
+		}
+		return true;
+	};
+	if (!reserve()) {
+		// Either fragmented or full
+		const auto grownCapacity = [](const RangeAllocator &ranges, const uint32_t count) {
+			if (ranges.GetFreeSize() >= count)
+				return ranges.GetSize();
+			return std::max(ranges.GetSize() * 2, ranges.GetUsedSize() + count);
+		};
+		const auto vertexCapacity = grownCapacity(this->vertexRanges, vertexCount);
+		const auto indexCapacity = grownCapacity(this->indexRanges, indexCount);
+		if (vertexCapacity > std::numeric_limits<int32_t>::max() || indexCapacity > std::numeric_limits<uint32_t>::max()) {
+			std::cerr << "Vulkan: Mesh atlas can't grow any further" << std::endl;
+			return invalidHandle;
+		}
+		if (!this->Repack(static_cast<uint32_t>(vertexCapacity), static_cast<uint32_t>(indexCapacity)) || !reserve()) {
+			std::cerr << "Vulkan: Failed to find space in the mesh atlas" << std::endl;
+			return invalidHandle;
+		}
+	}
+
+	const auto stagingBuffer = core->GetStagingBuffer();
+	if (!stagingBuffer->Upload(vertexData, static_cast<VkDeviceSize>(vertexCount) * this->vertexStride, this->vertexBuffer, vertexOffset * this->vertexStride) ||
+		!stagingBuffer->Upload(indices.data(), indices.size_bytes(), this->indexBuffer, firstIndex * sizeof(Mesh::Indices::value_type))) {
+		this->vertexRanges.Free(vertexOffset, vertexCount);
+		this->indexRanges.Free(firstIndex, indexCount);
+		return invalidHandle;
+	}
+
+	Handle handle;
+	if (this->freeHandles.empty()) {
+		handle = static_cast<Handle>(this->entries.size());
+		this->entries.emplace_back();
+	}
+	else {
+		handle = this->freeHandles.back();
+		this->freeHandles.pop_back();
+	}
+	this->entries[handle] = Entry{
+		.range = Range{
+			.firstIndex = static_cast<uint32_t>(firstIndex),
+			.vertexOffset = static_cast<int32_t>(vertexOffset),
+			.indexCount = indexCount
+		},
+		.vertexCount = vertexCount,
+		.isUsed = true
+	};
+	return handle;
+}
+
+void MeshAtlas::Remove(const Handle handle)
+{
+	if (!this->IsValid(handle))
+		return;
+	auto &entry = this->entries[handle];
+	this->vertexRanges.Free(static_cast<uint64_t>(entry.range.vertexOffset), entry.vertexCount);
+	this->indexRanges.Free(entry.range.firstIndex, entry.range.indexCount);
+	entry = Entry{};
+	this->freeHandles.push_back(handle);
+}
+
+bool MeshAtlas::Compact()
+{
+	return this->Repack(static_cast<uint32_t>(this->vertexRanges.GetSize()), static_cast<uint32_t>(this->indexRanges.GetSize()));
+}
+
+bool MeshAtlas::Repack(const uint32_t vertexCapacity, const uint32_t indexCapacity)
+{
+	const auto core = this->coreWeak.lock();
+	if (!core)
+		return false;
+
+	// Keeps the relative order, so in place every region moves towards the start
+	std::vector<Handle> byVertex, byIndex;
+	for (Handle handle = 0; handle < this->entries.size(); handle++) {
+		if (this->entries[handle].isUsed) {
+			byVertex.push_back(handle);
+			byIndex.push_back(handle);
+		}
+	}
+	std::sort(byVertex.begin(), byVertex.end(), [this](const Handle a, const Handle b) { return this->entries[a].range.vertexOffset < this->entries[b].range.vertexOffset; });
+	std::sort(byIndex.begin(), byIndex.end(), [this](const Handle a, const Handle b) { return this->entries[a].range.firstIndex < this->entries[b].range.firstIndex; });
+
+	// Neighbours that stay neighbours become one region
+	const auto addRegion = [](std::vector<VkBufferCopy> &regions, const VkDeviceSize srcOffset, const VkDeviceSize dstOffset, const VkDeviceSize size) {
+		if (!regions.empty() && regions.back().srcOffset + regions.back().size == srcOffset && regions.back().dstOffset + regions.back().size == dstOffset)
+			regions.back().size += size;
+		else
+			regions.push_back(VkBufferCopy{ .srcOffset = srcOffset, .dstOffset = dstOffset, .size = size });
+	};
+	std::vector<Range> packed(this->entries.size());
+	std::vector<VkBufferCopy> vertexRegions, indexRegions;
+	uint32_t vertexCount = 0, indexCount = 0;
+	for (const auto handle : byVertex) {
+		const auto &entry = this->entries[handle];
+		addRegion(vertexRegions, static_cast<VkDeviceSize>(entry.range.vertexOffset) * this->vertexStride, static_cast<VkDeviceSize>(vertexCount) * this->vertexStride, static_cast<VkDeviceSize>(entry.vertexCount) * this->vertexStride);
+		packed[handle].vertexOffset = static_cast<int32_t>(vertexCount);
+		vertexCount += entry.vertexCount;
+	}
+	for (const auto handle : byIndex) {
+		const auto &entry = this->entries[handle];
+		constexpr VkDeviceSize indexSize = sizeof(Mesh::Indices::value_type);
+		addRegion(indexRegions, entry.range.firstIndex * indexSize, indexCount * indexSize, entry.range.indexCount * indexSize);
+		packed[handle].firstIndex = indexCount;
+		packed[handle].indexCount = entry.range.indexCount;
+		indexCount += entry.range.indexCount;
+	}
+	if (vertexCapacity < vertexCount || indexCapacity < indexCount)
+		return false;
+
+	const auto stagingBuffer = core->GetStagingBuffer();
+	const auto isResized = vertexCapacity != this->vertexRanges.GetSize() || indexCapacity != this->indexRanges.GetSize();
+	if (isResized) {
+		VkBuffer newVertexBuffer, newIndexBuffer;
+		MemoryAllocator::Allocation newVertexBufferMemory, newIndexBufferMemory;
+		if (!this->CreateBuffers(core, vertexCapacity, indexCapacity, newVertexBuffer, newVertexBufferMemory, newIndexBuffer, newIndexBufferMemory))
+			return false;
+		if (!stagingBuffer->Copy(this->vertexBuffer, newVertexBuffer, vertexRegions) ||
+			!stagingBuffer->Copy(this->indexBuffer, newIndexBuffer, indexRegions)) {
+			stagingBuffer->Release(newVertexBuffer, newVertexBufferMemory);
+			stagingBuffer->Release(newIndexBuffer, newIndexBufferMemory);
+			return false;
+		}
+		// The current frame may have drawn from the old ones already
+		core->RetireBuffer(this->vertexBuffer, this->vertexBufferMemory);
+		core->RetireBuffer(this->indexBuffer, this->indexBufferMemory);
+		this->vertexBuffer = newVertexBuffer;
+		this->vertexBufferMemory = newVertexBufferMemory;
+		this->indexBuffer = newIndexBuffer;
+		this->indexBufferMemory = newIndexBufferMemory;
+	}
+	else {
+		// Nothing to do for regions that are already in place
+		const auto isInPlace = [](const VkBufferCopy &region) { return region.srcOffset == region.dstOffset; };
+		std::erase_if(vertexRegions, isInPlace);
+		std::erase_if(indexRegions, isInPlace);
+		if (!stagingBuffer->Move(this->vertexBuffer, vertexRegions) || !stagingBuffer->Move(this->indexBuffer, indexRegions))
+			return false;
+	}
+
+	// Everything is at the front now
+	this->vertexRanges.Reset(vertexCapacity);
+	this->indexRanges.Reset(indexCapacity);
+	uint64_t offset;
+	if (vertexCount)
+		this->vertexRanges.Allocate(vertexCount, 1, offset);
+	if (indexCount)
+		this->indexRanges.Allocate(indexCount, 1, offset);
+	for (Handle handle = 0; handle < this->entries.size(); handle++) {
+		if (this->entries[handle].isUsed)
+			this->entries[handle].range = packed[handle];
+	}
+
+	return true;
+}
+
+MeshAtlas::Statistics MeshAtlas::GetStatistics() const
+{
+	return Statistics{
+		.entryCount = static_cast<uint32_t>(this->entries.size() - this->freeHandles.size()),
+		.vertexCount = static_cast<uint32_t>(this->vertexRanges.GetUsedSize()),
+		.vertexCapacity = static_cast<uint32_t>(this->vertexRanges.GetSize()),
+		.indexCount = static_cast<uint32_t>(this->indexRanges.GetUsedSize()),
+		.indexCapacity = static_cast<uint32_t>(this->indexRanges.GetSize())
+	};
+}
+
+void MeshAtlas::Bind() const
+{
+	if (const auto core = this->coreWeak.lock()) {
+		const auto vkCommandBuffer = core->GetVulkanCurrentFrameCommandBuffer();
+
+		VkBuffer vertexBuffers[] = { this->vertexBuffer };
+		VkDeviceSize offsets[] = { 0 };
+		vkCmdBindVertexBuffers(vkCommandBuffer, 0, 1, vertexBuffers, offsets);
+
+		vkCmdBindIndexBuffer(vkCommandBuffer, this->indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+	}
+}
+
+void MeshAtlas::Draw(const Handle handle) const
+{
+	if (!this->IsValid(handle))
+		return;
+	if (const auto core = this->coreWeak.lock()) {
+		const auto &range = this->entries[handle].range;
+		vkCmdDrawIndexed(core->GetVulkanCurrentFrameCommandBuffer(), range.indexCount, 1, range.firstIndex, range.vertexOffset, 0);
+	}
+}
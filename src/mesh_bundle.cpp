@@ -0,0 +1,145 @@
+#include "mesh_bundle.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+	constexpr uint64_t AlignUp(const uint64_t value, const uint64_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	// [offset, offset + size) inside [0, limit), without overflowing
+	constexpr bool IsInside(const uint64_t offset, const uint64_t size, const uint64_t limit)
+	{
+		return offset <= limit && size <= limit - offset;
+	}
+}
+
+bool MeshBundle::Init(const std::filesystem::path &filePath)
+{
+	// Entries are usually uploaded one after another
+	this->file = FileView::Create(filePath, FileView::AccessHint::Sequential);
+	if (!this->file)
+		return false;
+
+	const auto data = this->file->GetData();
+	const auto fail = [&filePath](const char *reason) {
+		std::cerr << "MeshBundle: " << filePath.string() << " " << reason << std::endl;
+		return false;
+	};
+	if (data.size() < sizeof(Header))
+		return fail("is too small");
+	// Mappings start at a page boundary, so the aligned offsets below are aligned in memory too
+	this->header = reinterpret_cast<const Header*>(data.data());
+	if (std::memcmp(this->header->magic, magic, sizeof(magic)) != 0)
+		return fail("is not a mesh bundle");
+	if (this->header->version != version)
+		return fail("has an unsupported version");
+
+	const auto &header = *this->header;
+	const auto expectedStride = header.format == Format::Vertex ? sizeof(Mesh::Vertex) : header.format == Format::CompactVertex ? sizeof(CompactVertex) : 0;
+	if (!expectedStride || header.vertexStride != expectedStride)
+		return fail("has an unknown vertex format");
+	if (header.entriesOffset % alignof(Entry) || header.vertexDataOffset % blobAlignment || header.indexDataOffset % blobAlignment ||
+		!IsInside(header.entriesOffset, static_cast<uint64_t>(header.entryCount) * sizeof(Entry), data.size()) ||
+		!IsInside(header.vertexDataOffset, header.vertexDataSize, data.size()) ||
+		!IsInside(header.indexDataOffset, header.indexDataSize, data.size()))
+		return fail("has broken offsets");
+
+	this->entries = { reinterpret_cast<const Entry*>(data.data() + header.entriesOffset), header.entryCount };
+	this->vertexData = data.subspan(header.vertexDataOffset, header.vertexDataSize);
+	this->indexData = { reinterpret_cast<const uint16_t*>(data.data() + header.indexDataOffset), header.indexDataSize / sizeof(uint16_t) };
+	for (size_t i = 0; i < this->entries.size(); i++) {
+		const auto &entry = this->entries[i];
+		if ((i && entry.id <= this->entries[i - 1].id) || entry.indexOffset % sizeof(uint16_t) ||
+			!IsInside(entry.vertexOffset, static_cast<uint64_t>(entry.vertexCount) * header.vertexStride, header.vertexDataSize) ||
+			!IsInside(entry.indexOffset, static_cast<uint64_t>(entry.indexCount) * sizeof(uint16_t), header.indexDataSize))
+			return fail("has a broken entry table");
+	}
+
+	return true;
+}
+
+const MeshBundle::Entry* MeshBundle::Find(const Id id) const
+{
+	const auto it = std::lower_bound(this->entries.begin(), this->entries.end(), id, [](const Entry &entry, const Id id) { return entry.id < id; });
+	return it != this->entries.end() && it->id == id ? &*it : nullptr;
+}
+
+bool MeshBundle::SaveRaw(const std::filesystem::path &filePath, const Format format, const uint32_t vertexStride, const uint64_t contentKey, std::vector<RawItem> &items)
+{
+	std::sort(items.begin(), items.end(), [](const RawItem &a, const RawItem &b) { return a.id < b.id; });
+	if (std::adjacent_find(items.begin(), items.end(), [](const RawItem &a, const RawItem &b) { return a.id == b.id; }) != items.end()) {
+		std::cerr << "MeshBundle: duplicate ids" << std::endl;
+		return false;
+	}
+
+	// Layout
+	Header header = {
+		.magic = {},
+		.version = version,
+		.format = format,
+		.vertexStride = vertexStride,
+		.entryCount = static_cast<uint32_t>(items.size()),
+		.entriesOffset = sizeof(Header),
+		.vertexDataOffset = 0,
+		.vertexDataSize = 0,
+		.indexDataOffset = 0,
+		.indexDataSize = 0,
+		.contentKey = contentKey
+	};
+	std::memcpy(header.magic, magic, sizeof(magic));
+	std::vector<Entry> entries(items.size());
+	for (size_t i = 0; i < items.size(); i++) {
+		entries[i] = Entry{
+			.id = items[i].id,
+			.vertexCount = items[i].vertexCount,
+			.indexCount = static_cast<uint32_t>(items[i].indices.size()),
+			.reserved = 0,
+			.vertexOffset = header.vertexDataSize,
+			.indexOffset = header.indexDataSize
+		};
+		header.vertexDataSize += static_cast<uint64_t>(items[i].vertexCount) * vertexStride;
+		header.indexDataSize += sizeof(uint16_t) * items[i].indices.size();
+	}
+	header.vertexDataOffset = AlignUp(header.entriesOffset + sizeof(Entry) * entries.size(), blobAlignment);
+	header.indexDataOffset = AlignUp(header.vertexDataOffset + header.vertexDataSize, blobAlignment);
+
+	// Written next to the target and renamed, a crash never leaves a half written bundle behind
+	auto temporaryPath = filePath;
+	temporaryPath += ".tmp";
+	{
+		std::ofstream stream(temporaryPath, std::ios::binary | std::ios::trunc);
+		if (!stream.is_open()) {
+			std::cerr << "MeshBundle: " << temporaryPath.string() << " failed to open" << std::endl;
+			return false;
+		}
+		const auto padTo = [&stream](const uint64_t offset) {
+			static constexpr char zeros[blobAlignment] = {};
+			const auto position = static_cast<uint64_t>(stream.tellp());
+			stream.write(zeros, static_cast<std::streamsize>(offset - position));
+		};
+		stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		stream.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(sizeof(Entry) * entries.size()));
+		padTo(header.vertexDataOffset);
+		for (const auto &item : items)
+			stream.write(static_cast<const char*>(item.vertexData), static_cast<std::streamsize>(static_cast<uint64_t>(item.vertexCount) * vertexStride));
+		padTo(header.indexDataOffset);
+		for (const auto &item : items)
+			stream.write(reinterpret_cast<const char*>(item.indices.data()), static_cast<std::streamsize>(sizeof(uint16_t) * item.indices.size()));
+		if (!stream) {
+			std::cerr << "MeshBundle: " << temporaryPath.string() << " failed to write" << std::endl;
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporaryPath, filePath, error);
+	if (error) {
+		std::cerr << "MeshBundle: " << filePath.string() << " failed to replace: " << error.message() << std::endl;
+		return false;
+	}
+	return true;
+}
@@ -1,6 +1,9 @@
 #include "core.hpp"
 #include "pipeline.hpp"
 #include "utils.hpp"
+#include "view_uniforms.hpp"
+#include <cstddef>
+#include <cstring>
 #include <iostream>
 
 Pipeline::~Pipeline()
@@ -44,18 +47,28 @@ void Pipeline::Bind() const
 			.extent = swapChainExtent
 		};
 		vkCmdSetScissor(vkCommandBuffer, 0, 1, &scissor);
+
+		core->GetViewUniforms()->Bind(vkCommandBuffer, this->vkPipelineLayout, core->GetVulkanCurrentFrameIndex());
+		const Transform identity;
+		vkCmdPushConstants(vkCommandBuffer, this->vkPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(Transform), &identity);
 	}
 }
 
-bool Pipeline::Init(const VkVertexInputBindingDescription &vertexInputBindingDescription,
-	const std::vector<VkVertexInputAttributeDescription> &vertexInputAttributeDescriptions,
-	const CorePtr core, const std::vector<uint8_t> &vertexShaderCode,
-	const std::vector<uint8_t> &fragmentShaderCode)
+void Pipeline::PushTransform(const Transform &transform) const
+{
+	if (const auto core = this->coreWeak.lock())
+		vkCmdPushConstants(core->GetVulkanCurrentFrameCommandBuffer(), this->vkPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(Transform), &transform);
+}
+
+bool Pipeline::Init(const CorePtr core, const VertexInput &vertexInput,
+	std::span<const uint8_t> vertexShaderCode, std::span<const uint8_t> fragmentShaderCode,
+	const PipelineKey &key)
 {
 	if (!core->GetVulkanDevice())
 		return false;
 
 	this->coreWeak = core;
+	this->key = key;
 	const auto vkDevice = core->GetVulkanDevice();
 
 	const auto vertexShaderModule = CreateShaderModule(vkDevice, vertexShaderCode);
@@ -63,17 +76,43 @@ bool Pipeline::Init(const VkVertexInputBindingDescription &vertexInputBindingDes
 	if (!vertexShaderModule || !fragmentShaderModule)
 		return false;
 
-	const auto shaderStages = GetShadersStageCreateInfo(vertexShaderModule, fragmentShaderModule);
+	// Both stages get the same constants, each declares the ones it uses
+	const auto specializationData = key.GetSpecializationData();
+	const std::array<VkSpecializationMapEntry, 2> specializationMapEntries = {
+		VkSpecializationMapEntry{
+			.constantID = 0,
+			.offset = offsetof(PipelineKey::SpecializationData, curve),
+			.size = sizeof(PipelineKey::SpecializationData::curve)
+		},
+		VkSpecializationMapEntry{
+			.constantID = 1,
+			.offset = offsetof(PipelineKey::SpecializationData, antialiasing),
+			.size = sizeof(PipelineKey::SpecializationData::antialiasing)
+		}
+	};
+	const VkSpecializationInfo specializationInfo = {
+		.mapEntryCount = static_cast<uint32_t>(specializationMapEntries.size()),
+		.pMapEntries = specializationMapEntries.data(),
+		.dataSize = sizeof(specializationData),
+		.pData = &specializationData
+	};
+
+	const auto shaderStages = GetShadersStageCreateInfo(vertexShaderModule, fragmentShaderModule, &specializationInfo);
 	const auto dynamicState = Pipeline::DynamicStateWrapper({VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR});
-	const auto vertexInputState = GetVertexInputStateCreateInfo(vertexInputBindingDescription, vertexInputAttributeDescriptions);
+	const auto vertexInputState = GetVertexInputStateCreateInfo(vertexInput.bindingDescriptions, vertexInput.attributeDescriptions);
 	const auto inputAssemblyState = GetInputAssemblyStateCreateInfo();
 	const auto viewportState = GetViewportStateCreateInfo();
-	const auto rasterizationState = GetRasterizationStateCreateInfo();
-	const auto multisampleState = GetMultisampleStateCreateInfo();
-	const auto colorBlendAttachmentState = GetColorBlendAttachmentState();
+	const auto rasterizationState = GetRasterizationStateCreateInfo(key.cull);
+	// Curves are cut in the fragment shader, without per sample shading every sample of a pixel would get the same answer
+	const bool isSampleShading = key.samples != VK_SAMPLE_COUNT_1_BIT && key.curve == PipelineKey::Curve::Quadratic &&
+		key.antialiasing == PipelineKey::Antialiasing::Multisample && core->GetVulkanEnabledFeatures().sampleRateShading;
+	const auto multisampleState = GetMultisampleStateCreateInfo(key.samples, isSampleShading);
+	const auto colorBlendAttachmentState = GetColorBlendAttachmentState(key.blend);
 	const auto colorBlendState = GetColorBlendStateCreateInfo(&colorBlendAttachmentState);
 
-	this->vkPipelineLayout = CreatePipelineLayout(vkDevice);
+	this->vkPipelineLayout = CreatePipelineLayout(vkDevice, core->GetViewUniforms()->GetDescriptorSetLayout());
+	if (!this->vkPipelineLayout)
+		return false;
 	const auto vkRenderPass = core->GetVulkanRenderPass();
 
 	VkGraphicsPipelineCreateInfo pipelineCreateInfo = {
@@ -98,7 +137,7 @@ bool Pipeline::Init(const VkVertexInputBindingDescription &vertexInputBindingDes
 		.basePipelineIndex = -1
 	};
 
-	if (!CHECK_VK_RESULT(vkCreateGraphicsPipelines(vkDevice, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &this->vkPipeline))) {
+	if (!CHECK_VK_RESULT(vkCreateGraphicsPipelines(vkDevice, core->GetVulkanPipelineCache(), 1, &pipelineCreateInfo, nullptr, &this->vkPipeline))) {
 		std::cerr << "Vulkan: Failed to create pipeline" << std::endl;
 		return false;
 	}
@@ -106,12 +145,25 @@ bool Pipeline::Init(const VkVertexInputBindingDescription &vertexInputBindingDes
 	return true;
 }
 
-Pipeline::ShaderModuleWrapper Pipeline::CreateShaderModule(const VkDevice vkDevice, const std::vector<uint8_t> &code)
+Pipeline::ShaderModuleWrapper Pipeline::CreateShaderModule(const VkDevice vkDevice, std::span<const uint8_t> code)
 {
-	VkShaderModuleCreateInfo createInfo{};
-	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	createInfo.codeSize = code.size();
-	createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+	if (code.empty() || code.size() % sizeof(uint32_t)) {
+		std::cerr << "Vulkan: Shader code size isn't a multiple of 4" << std::endl;
+		return Pipeline::ShaderModuleWrapper(VK_NULL_HANDLE, VK_NULL_HANDLE);
+	}
+	std::vector<uint32_t> alignedCode;
+	if (reinterpret_cast<std::uintptr_t>(code.data()) % alignof(uint32_t)) {
+		alignedCode.resize(code.size() / sizeof(uint32_t));
+		std::memcpy(alignedCode.data(), code.data(), code.size());
+	}
+
+	VkShaderModuleCreateInfo createInfo = {
+		.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.codeSize = code.size(),
+		.pCode = alignedCode.empty() ? reinterpret_cast<const uint32_t*>(code.data()) : alignedCode.data()
+	};
 	VkShaderModule shaderModule;
 	if (!CHECK_VK_RESULT(vkCreateShaderModule(vkDevice, &createInfo, nullptr, &shaderModule))) {
 		std::cerr << "Vulkan: Failed to create shader module" << std::endl;
@@ -120,7 +172,7 @@ Pipeline::ShaderModuleWrapper Pipeline::CreateShaderModule(const VkDevice vkDevi
 
 	return Pipeline::ShaderModuleWrapper(vkDevice, shaderModule);
 }
-constexpr std::array<VkPipelineShaderStageCreateInfo, 2> Pipeline::GetShadersStageCreateInfo(const VkShaderModule vertexShaderModule, const VkShaderModule fragmentShaderModule)
+constexpr std::array<VkPipelineShaderStageCreateInfo, 2> Pipeline::GetShadersStageCreateInfo(const VkShaderModule vertexShaderModule, const VkShaderModule fragmentShaderModule, const VkSpecializationInfo *specializationInfo)
 {
 	return {
 		VkPipelineShaderStageCreateInfo{
@@ -130,7 +182,7 @@ constexpr std::array<VkPipelineShaderStageCreateInfo, 2> Pipeline::GetShadersSta
 			.stage = VK_SHADER_STAGE_VERTEX_BIT,
 			.module = vertexShaderModule,
 			.pName = "main",
-			.pSpecializationInfo = nullptr
+			.pSpecializationInfo = specializationInfo
 		},
 		VkPipelineShaderStageCreateInfo{
 			.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
@@ -139,20 +191,20 @@ constexpr std::array<VkPipelineShaderStageCreateInfo, 2> Pipeline::GetShadersSta
 			.stage = VK_SHADER_STAGE_FRAGMENT_BIT,
 			.module = fragmentShaderModule,
 			.pName = "main",
-			.pSpecializationInfo = nullptr
+			.pSpecializationInfo = specializationInfo
 		}
 	};
 }
 constexpr VkPipelineVertexInputStateCreateInfo Pipeline::GetVertexInputStateCreateInfo(
-		const VkVertexInputBindingDescription &vertexInputBindingDescription,
+		const std::vector<VkVertexInputBindingDescription> &vertexInputBindingDescriptions,
 		const std::vector<VkVertexInputAttributeDescription> &vertexInputAttributeDescriptions)
 {
 	return VkPipelineVertexInputStateCreateInfo{
 		.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
 		.pNext = nullptr,
 		.flags = 0,
-		.vertexBindingDescriptionCount = 1,
-		.pVertexBindingDescriptions = &vertexInputBindingDescription,
+		.vertexBindingDescriptionCount = static_cast<uint32_t>(vertexInputBindingDescriptions.size()),
+		.pVertexBindingDescriptions = vertexInputBindingDescriptions.data(),
 		.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertexInputAttributeDescriptions.size()),
 		.pVertexAttributeDescriptions = vertexInputAttributeDescriptions.data()
 	};
@@ -179,8 +231,14 @@ constexpr VkPipelineViewportStateCreateInfo Pipeline::GetViewportStateCreateInfo
 		.pScissors = nullptr
 	};
 }
-constexpr VkPipelineRasterizationStateCreateInfo Pipeline::GetRasterizationStateCreateInfo()
+constexpr VkPipelineRasterizationStateCreateInfo Pipeline::GetRasterizationStateCreateInfo(const PipelineKey::Cull cull)
 {
+	VkCullModeFlags cullMode = VK_CULL_MODE_NONE;
+	switch (cull) {
+	case PipelineKey::Cull::None: cullMode = VK_CULL_MODE_NONE; break;
+	case PipelineKey::Cull::Back: cullMode = VK_CULL_MODE_BACK_BIT; break;
+	case PipelineKey::Cull::Front: cullMode = VK_CULL_MODE_FRONT_BIT; break;
+	}
 	return VkPipelineRasterizationStateCreateInfo{
 		.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
 		.pNext = nullptr,
@@ -188,7 +246,7 @@ constexpr VkPipelineRasterizationStateCreateInfo Pipeline::GetRasterizationState
 		.depthClampEnable = VK_FALSE,
 		.rasterizerDiscardEnable = VK_FALSE,
 		.polygonMode = VK_POLYGON_MODE_FILL,
-		.cullMode = VK_CULL_MODE_BACK_BIT,
+		.cullMode = cullMode,
 		.frontFace = VK_FRONT_FACE_CLOCKWISE,
 		.depthBiasEnable = VK_FALSE,
 		.depthBiasConstantFactor = 0.0f,
@@ -197,26 +255,33 @@ constexpr VkPipelineRasterizationStateCreateInfo Pipeline::GetRasterizationState
 		.lineWidth = 1.0f
 	};
 }
-constexpr VkPipelineMultisampleStateCreateInfo Pipeline::GetMultisampleStateCreateInfo()
+constexpr VkPipelineMultisampleStateCreateInfo Pipeline::GetMultisampleStateCreateInfo(const VkSampleCountFlagBits samples, const bool isSampleShading)
 {
 	return VkPipelineMultisampleStateCreateInfo{
 		.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
 		.pNext = nullptr,
 		.flags = 0,
-		.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
-		.sampleShadingEnable = VK_FALSE,
-		.minSampleShading = 0.0f,
+		.rasterizationSamples = samples,
+		.sampleShadingEnable = isSampleShading ? VK_TRUE : VK_FALSE,
+		.minSampleShading = isSampleShading ? 1.0f : 0.0f,
 		.pSampleMask = nullptr,
 		.alphaToCoverageEnable = VK_FALSE,
 		.alphaToOneEnable = VK_FALSE
 	};
 }
-constexpr VkPipelineColorBlendAttachmentState Pipeline::GetColorBlendAttachmentState()
+constexpr VkPipelineColorBlendAttachmentState Pipeline::GetColorBlendAttachmentState(const PipelineKey::Blend blend)
 {
+	VkBlendFactor srcColorBlendFactor = VK_BLEND_FACTOR_ONE, dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+	switch (blend) {
+	case PipelineKey::Blend::Opaque: break;
+	case PipelineKey::Blend::Alpha: srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA; dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA; break;
+	case PipelineKey::Blend::Premultiplied: srcColorBlendFactor = VK_BLEND_FACTOR_ONE; dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA; break;
+	case PipelineKey::Blend::Additive: srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA; dstColorBlendFactor = VK_BLEND_FACTOR_ONE; break;
+	}
 	return VkPipelineColorBlendAttachmentState{
-		.blendEnable = VK_TRUE,
-		.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA,
-		.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+		.blendEnable = blend == PipelineKey::Blend::Opaque ? VK_FALSE : VK_TRUE,
+		.srcColorBlendFactor = srcColorBlendFactor,
+		.dstColorBlendFactor = dstColorBlendFactor,
 		.colorBlendOp = VK_BLEND_OP_ADD,
 		.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
 		.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
@@ -238,17 +303,22 @@ constexpr VkPipelineColorBlendStateCreateInfo Pipeline::GetColorBlendStateCreate
 	};
 }
 
-VkPipelineLayout Pipeline::CreatePipelineLayout(const VkDevice vkDevice)
+VkPipelineLayout Pipeline::CreatePipelineLayout(const VkDevice vkDevice, const VkDescriptorSetLayout viewDescriptorSetLayout)
 {
 	VkPipelineLayout pipelineLayout;
+	const VkPushConstantRange pushConstantRange = {
+		.stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+		.offset = 0,
+		.size = sizeof(Transform)
+	};
 	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {
 		.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
 		.pNext = nullptr,
 		.flags = 0,
-		.setLayoutCount = 0,
-		.pSetLayouts = nullptr,
-		.pushConstantRangeCount = 0,
-		.pPushConstantRanges = nullptr
+		.setLayoutCount = 1,
+		.pSetLayouts = &viewDescriptorSetLayout,
+		.pushConstantRangeCount = 1,
+		.pPushConstantRanges = &pushConstantRange
 	};
 	if (!CHECK_VK_RESULT(vkCreatePipelineLayout(vkDevice, &pipelineLayoutInfo, nullptr, &pipelineLayout))) {
 		std::cerr << "Vulkan: Failed to create pipeline layout" << std::endl;
@@ -0,0 +1,75 @@
+#include "pipeline_set.hpp"
+#include <future>
+#include <utility>
+#include <vector>
+
+bool PipelineSet::Init(const CorePtr core, Pipeline::VertexInput &&vertexInput, const std::filesystem::path &vertexShaderFilePath, const std::filesystem::path &fragmentShaderFilePath)
+{
+	this->coreWeak = core;
+	this->vertexInput = std::move(vertexInput);
+	this->vertexShaderFile = FileView::Create(vertexShaderFilePath, FileView::AccessHint::WillNeed);
+	this->fragmentShaderFile = FileView::Create(fragmentShaderFilePath, FileView::AccessHint::WillNeed);
+	return this->vertexShaderFile && this->fragmentShaderFile;
+}
+
+PipelinePtr PipelineSet::Get(const PipelineKey &key)
+{
+	{
+		std::lock_guard lock(this->mutex);
+		const auto it = this->pipelines.find(key);
+		if (it != this->pipelines.end())
+			return it->second;
+	}
+	// Outside of the lock, compiling takes a while
+	auto pipeline = this->CreatePipeline(key);
+	if (!pipeline)
+		return nullptr;
+	return this->Insert(key, std::move(pipeline));
+}
+
+bool PipelineSet::Prepare(std::span<const PipelineKey> keys)
+{
+	std::vector<std::pair<PipelineKey, std::future<PipelinePtr>>> pending;
+	{
+		std::lock_guard lock(this->mutex);
+		for (const auto &key : keys) {
+			if (this->pipelines.contains(key))
+				continue;
+			bool isPending = false;
+			for (const auto &[pendingKey, future] : pending)
+				isPending = isPending || pendingKey == key;
+			if (!isPending)
+				pending.emplace_back(key, std::async(std::launch::async, [this, key]() { return this->CreatePipeline(key); }));
+		}
+	}
+
+	bool isSuccessful = true;
+	for (auto &[key, future] : pending) {
+		auto pipeline = future.get();
+		if (pipeline)
+			this->Insert(key, std::move(pipeline));
+		else
+			isSuccessful = false;
+	}
+	return isSuccessful;
+}
+
+std::size_t PipelineSet::GetCount() const
+{
+	std::lock_guard lock(this->mutex);
+	return this->pipelines.size();
+}
+
+PipelinePtr PipelineSet::CreatePipeline(const PipelineKey &key) const
+{
+	const auto core = this->coreWeak.lock();
+	if (!core)
+		return nullptr;
+	return Pipeline::Create(core, this->vertexInput, this->vertexShaderFile->GetData(), this->fragmentShaderFile->GetData(), key);
+}
+
+PipelinePtr PipelineSet::Insert(const PipelineKey &key, PipelinePtr pipeline)
+{
+	std::lock_guard lock(this->mutex);
+	return this->pipelines.try_emplace(key, std::move(pipeline)).first->second;
+}
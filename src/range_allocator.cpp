@@ -0,0 +1,74 @@
+#include "range_allocator.hpp"
+#include <iterator>
+
+namespace {
+	constexpr uint64_t AlignUp(const uint64_t value, const uint64_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+}
+
+void RangeAllocator::Reset(const uint64_t size)
+{
+	this->size = size;
+	this->usedSize = 0;
+	this->freeRanges.clear();
+	if (size)
+		this->freeRanges.emplace(0, size);
+}
+
+void RangeAllocator::Grow(const uint64_t size)
+{
+	if (size <= this->size)
+		return;
+	const auto oldSize = this->size;
+	this->size = size;
+	// Counted as used by Free
+	this->usedSize += size - oldSize;
+	this->Free(oldSize, size - oldSize);
+}
+
+bool RangeAllocator::Allocate(const uint64_t size, const uint64_t alignment, uint64_t &offset)
+{
+	if (!size || this->GetFreeSize() < size)
+		return false;
+	for (auto it = this->freeRanges.begin(); it != this->freeRanges.end(); ++it) {
+		const auto [rangeOffset, rangeSize] = *it;
+		const auto alignedOffset = AlignUp(rangeOffset, alignment ? alignment : 1);
+		if (alignedOffset + size > rangeOffset + rangeSize)
+			continue;
+
+		this->freeRanges.erase(it);
+		// Alignment padding in front and whatever is left behind stay free
+		if (alignedOffset > rangeOffset)
+			this->freeRanges.emplace(rangeOffset, alignedOffset - rangeOffset);
+		if (alignedOffset + size < rangeOffset + rangeSize)
+			this->freeRanges.emplace(alignedOffset + size, rangeOffset + rangeSize - alignedOffset - size);
+		this->usedSize += size;
+		offset = alignedOffset;
+		return true;
+	}
+	return false;
+}
+
+void RangeAllocator::Free(const uint64_t offset, uint64_t size)
+{
+	if (!size)
+		return;
+	this->usedSize -= size;
+
+	// Merge with the free neighbours on both sides
+	auto next = this->freeRanges.lower_bound(offset);
+	if (next != this->freeRanges.end() && offset + size == next->first) {
+		size += next->second;
+		next = this->freeRanges.erase(next);
+	}
+	if (next != this->freeRanges.begin()) {
+		auto previous = std::prev(next);
+		if (previous->first + previous->second == offset) {
+			previous->second += size;
+			return;
+		}
+	}
+	this->freeRanges.emplace_hint(next, offset, size);
+}
@@ -0,0 +1,351 @@
+#include "staging_buffer.hpp"
+#include "utils.hpp"
+#include <bit>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+namespace {
+	// Keeps memcpy destinations and copy offsets nicely aligned
+	constexpr VkDeviceSize copyAlignment = 16;
+
+	constexpr VkDeviceSize AlignUp(const VkDeviceSize value, const VkDeviceSize alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+}
+
+StagingBuffer::~StagingBuffer()
+{
+	if (!this->vkDevice)
+		return;
+	this->Finish();
+	for (auto &batch : this->batches) {
+		if (batch.fence) {
+			vkDestroyFence(this->vkDevice, batch.fence, nullptr);
+			batch.fence = VK_NULL_HANDLE;
+		}
+	}
+	if (this->vkCommandPool) {
+		vkDestroyCommandPool(this->vkDevice, this->vkCommandPool, nullptr);
+		this->vkCommandPool = VK_NULL_HANDLE;
+	}
+	this->DestroyRing();
+}
+
+bool StagingBuffer::Init(const VkDevice vkDevice, const MemoryAllocatorPtr memoryAllocator, const uint32_t queueFamilyIndex, const VkQueue vkQueue, const VkDeviceSize capacity)
+{
+	this->vkDevice = vkDevice;
+	this->memoryAllocator = memoryAllocator;
+	this->vkQueue = vkQueue;
+
+	VkCommandPoolCreateInfo poolCreateInfo = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+		.queueFamilyIndex = queueFamilyIndex
+	};
+	if (!CHECK_VK_RESULT(vkCreateCommandPool(this->vkDevice, &poolCreateInfo, nullptr, &this->vkCommandPool))) {
+		std::cerr << "Vulkan: Failed to create staging command pool" << std::endl;
+		return false;
+	}
+
+	std::array<VkCommandBuffer, batchCount> commandBuffers;
+	VkCommandBufferAllocateInfo allocInfo = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+		.pNext = nullptr,
+		.commandPool = this->vkCommandPool,
+		.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+		.commandBufferCount = batchCount
+	};
+	if (!CHECK_VK_RESULT(vkAllocateCommandBuffers(this->vkDevice, &allocInfo, commandBuffers.data())))
+		return false;
+
+	for (uint32_t i = 0; i < batchCount; i++) {
+		auto &batch = this->batches[i];
+		batch.commandBuffer = commandBuffers[i];
+		VkFenceCreateInfo fenceCreateInfo = {
+			.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+			.pNext = nullptr,
+			.flags = 0
+		};
+		if (!CHECK_VK_RESULT(vkCreateFence(this->vkDevice, &fenceCreateInfo, nullptr, &batch.fence)))
+			return false;
+		this->freeBatches.push_back(batchCount - 1 - i);
+	}
+
+	return this->CreateRing(capacity);
+}
+
+bool StagingBuffer::CreateRing(const VkDeviceSize capacity)
+{
+	this->capacity = AlignUp(capacity, copyAlignment);
+	this->head = 0;
+	this->used = 0;
+
+	// Host visible blocks of the allocator stay mapped for their whole lifetime
+	if (!this->memoryAllocator->CreateBuffer(this->capacity,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		this->vkBuffer, this->bufferMemory)) {
+		std::cerr << "Vulkan: Failed to create staging buffer" << std::endl;
+		return false;
+	}
+	this->mapped = this->bufferMemory.mapped;
+
+	return true;
+}
+
+void StagingBuffer::DestroyRing()
+{
+	this->mapped = nullptr;
+	this->memoryAllocator->DestroyBuffer(this->vkBuffer, this->bufferMemory);
+}
+
+bool StagingBuffer::Upload(const void *data, const VkDeviceSize size, const VkBuffer dstBuffer, const VkDeviceSize dstOffset)
+{
+	if (!size)
+		return true;
+
+	if (!this->EnsureCapacity(size))
+		return false;
+	VkDeviceSize offset;
+	if (!this->Reserve(size, offset))
+		return false;
+	memcpy(this->mapped + offset, data, static_cast<std::size_t>(size));
+
+	VkBufferCopy copyRegion = {
+		.srcOffset = offset,
+		.dstOffset = dstOffset,
+		.size = size
+	};
+	vkCmdCopyBuffer(this->currentBatch->commandBuffer, this->vkBuffer, dstBuffer, 1, &copyRegion);
+	this->currentBatch->copyCount++;
+
+	return true;
+}
+
+bool StagingBuffer::Copy(const VkBuffer srcBuffer, const VkBuffer dstBuffer, std::span<const VkBufferCopy> regions)
+{
+	if (regions.empty())
+		return true;
+	if (!this->currentBatch && !this->BeginBatch())
+		return false;
+
+	// Source may come from earlier uploads, destination may be written by later ones
+	this->RecordBarrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT);
+	vkCmdCopyBuffer(this->currentBatch->commandBuffer, srcBuffer, dstBuffer, static_cast<uint32_t>(regions.size()), regions.data());
+	this->RecordBarrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT);
+	this->currentBatch->copyCount++;
+
+	return true;
+}
+
+bool StagingBuffer::Move(const VkBuffer buffer, std::span<const VkBufferCopy> regions)
+{
+	if (regions.empty())
+		return true;
+
+	VkDeviceSize size = 0;
+	for (const auto &region : regions)
+		size += AlignUp(region.size, copyAlignment);
+	if (!this->EnsureCapacity(size))
+		return false;
+	VkDeviceSize offset;
+	if (!this->Reserve(size, offset))
+		return false;
+
+	// vkCmdCopyBuffer doesn't allow overlapping regions, so out to the ring and back
+	std::vector<VkBufferCopy> toRing(regions.size()), fromRing(regions.size());
+	for (std::size_t i = 0; i < regions.size(); i++) {
+		toRing[i] = VkBufferCopy{
+			.srcOffset = regions[i].srcOffset,
+			.dstOffset = offset,
+			.size = regions[i].size
+		};
+		fromRing[i] = VkBufferCopy{
+			.srcOffset = offset,
+			.dstOffset = regions[i].dstOffset,
+			.size = regions[i].size
+		};
+		offset += AlignUp(regions[i].size, copyAlignment);
+	}
+	return this->Copy(buffer, this->vkBuffer, toRing) && this->Copy(this->vkBuffer, buffer, fromRing);
+}
+
+void StagingBuffer::Release(VkBuffer buffer, MemoryAllocator::Allocation allocation)
+{
+	if (!this->currentBatch && !this->BeginBatch()) {
+		// Nothing sane left to do, don't leak at least
+		CHECK_VK_RESULT(vkQueueWaitIdle(this->vkQueue));
+		this->memoryAllocator->DestroyBuffer(buffer, allocation);
+		return;
+	}
+	this->currentBatch->releases.emplace_back(buffer, allocation);
+}
+
+bool StagingBuffer::EnsureCapacity(const VkDeviceSize size)
+{
+	if (AlignUp(size, copyAlignment) <= this->capacity)
+		return true;
+
+	// Bigger than the whole ring, replace it with a bigger one once everything in flight is done
+	if (!this->Finish())
+		return false;
+	this->DestroyRing();
+	return this->CreateRing(std::bit_ceil(size));
+}
+
+bool StagingBuffer::Reserve(const VkDeviceSize size, VkDeviceSize &offset)
+{
+	const auto alignedSize = AlignUp(size, copyAlignment);
+	this->Retire(false);
+	while (true) {
+		if (!this->currentBatch && !this->BeginBatch())
+			return false;
+
+		if (!this->used)
+			this->head = 0;
+		// Free space is [head, tail) if the used part wraps around, otherwise [head, capacity) + [0, tail)
+		const auto tail = (this->head + this->capacity - this->used) % this->capacity;
+		if (this->used < this->capacity) {
+			if (tail <= this->head) {
+				if (this->capacity - this->head >= alignedSize) {
+					offset = this->head;
+					this->head += alignedSize;
+					this->used += alignedSize;
+					this->currentBatch->size += alignedSize;
+					return true;
+				}
+				if (tail >= alignedSize) {
+					// Skip the end of the ring
+					const auto padding = this->capacity - this->head;
+					offset = 0;
+					this->head = alignedSize;
+					this->used += padding + alignedSize;
+					this->currentBatch->size += padding + alignedSize;
+					return true;
+				}
+			}
+			else if (tail - this->head >= alignedSize) {
+				offset = this->head;
+				this->head += alignedSize;
+				this->used += alignedSize;
+				this->currentBatch->size += alignedSize;
+				return true;
+			}
+		}
+
+		// Out of space: send what is recorded and wait for the oldest batch
+		if (!this->Flush())
+			return false;
+		if (!this->Retire(true))
+			return false;
+	}
+}
+
+bool StagingBuffer::BeginBatch()
+{
+	if (this->freeBatches.empty() && !this->Retire(true))
+		return false;
+
+	auto &batch = this->batches[this->freeBatches.back()];
+	CHECK_VK_RESULT(vkResetCommandBuffer(batch.commandBuffer, 0));
+	VkCommandBufferBeginInfo beginInfo = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.pNext = nullptr,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+		.pInheritanceInfo = nullptr
+	};
+	if (!CHECK_VK_RESULT(vkBeginCommandBuffer(batch.commandBuffer, &beginInfo)))
+		return false;
+	this->freeBatches.pop_back();
+	batch.size = 0;
+	batch.copyCount = 0;
+	this->currentBatch = &batch;
+
+	// Execution dependency only, writes wait for earlier draws to fetch their vertices (write after read)
+	this->RecordBarrier(VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, VK_PIPELINE_STAGE_TRANSFER_BIT, 0);
+	return true;
+}
+
+void StagingBuffer::RecordBarrier(const VkPipelineStageFlags srcStage, const VkAccessFlags srcAccess, const VkPipelineStageFlags dstStage, const VkAccessFlags dstAccess)
+{
+	VkMemoryBarrier barrier = {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+		.pNext = nullptr,
+		.srcAccessMask = srcAccess,
+		.dstAccessMask = dstAccess
+	};
+	vkCmdPipelineBarrier(this->currentBatch->commandBuffer, srcStage, dstStage, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+bool StagingBuffer::Flush()
+{
+	if (!this->currentBatch || (!this->currentBatch->copyCount && this->currentBatch->releases.empty()))
+		return true;
+	auto &batch = *this->currentBatch;
+
+	// Make the copies visible to everything submitted later on this queue
+	this->RecordBarrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT);
+	if (!CHECK_VK_RESULT(vkEndCommandBuffer(batch.commandBuffer)))
+		return false;
+
+	VkSubmitInfo submitInfo = {
+		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+		.pNext = nullptr,
+		.waitSemaphoreCount = 0,
+		.pWaitSemaphores = nullptr,
+		.pWaitDstStageMask = nullptr,
+		.commandBufferCount = 1,
+		.pCommandBuffers = &batch.commandBuffer,
+		.signalSemaphoreCount = 0,
+		.pSignalSemaphores = nullptr
+	};
+	if (!CHECK_VK_RESULT(vkQueueSubmit(this->vkQueue, 1, &submitInfo, batch.fence)))
+		return false;
+
+	this->inFlight.push_back(static_cast<uint32_t>(&batch - this->batches.data()));
+	this->currentBatch = nullptr;
+	return true;
+}
+
+bool StagingBuffer::Finish()
+{
+	if (!this->Flush())
+		return false;
+	while (!this->inFlight.empty()) {
+		if (!this->Retire(true))
+			return false;
+	}
+	return true;
+}
+
+bool StagingBuffer::Retire(const bool wait)
+{
+	if (wait && this->inFlight.empty()) {
+		std::cerr << "Vulkan: Staging buffer has nothing to wait for" << std::endl;
+		return false;
+	}
+	bool waited = false;
+	while (!this->inFlight.empty()) {
+		auto &batch = this->batches[this->inFlight.front()];
+		if (wait && !waited) {
+			if (!CHECK_VK_RESULT(vkWaitForFences(this->vkDevice, 1, &batch.fence, VK_TRUE, std::numeric_limits<uint64_t>::max())))
+				return false;
+			waited = true;
+		}
+		else if (vkGetFenceStatus(this->vkDevice, batch.fence) != VK_SUCCESS) {
+			break;
+		}
+		CHECK_VK_RESULT(vkResetFences(this->vkDevice, 1, &batch.fence));
+		this->used -= batch.size;
+		batch.size = 0;
+		for (auto &[buffer, allocation] : batch.releases)
+			this->memoryAllocator->DestroyBuffer(buffer, allocation);
+		batch.releases.clear();
+		this->freeBatches.push_back(this->inFlight.front());
+		this->inFlight.pop_front();
+	}
+	return true;
+}
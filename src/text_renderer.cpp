@@ -0,0 +1,156 @@
+#include "core.hpp"
+#include "mesh_bundle.hpp"
+#include "text_renderer.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace {
+	// Guaranteed minimum of maxDrawIndirectCount when multiDrawIndirect is supported
+	constexpr uint32_t maxDrawIndirectCount = 65535;
+}
+
+bool TextRenderer::Init(const CorePtr core)
+{
+	if (!core->GetVulkanDevice())
+		return false;
+
+	this->coreWeak = core;
+	// Glyph meshes are small, a few hundred of them fit into the smallest atlas
+	this->atlas = MeshAtlas::Create<CompactVertex>(core, 16 * 1024, 48 * 1024);
+	if (!this->atlas)
+		return false;
+
+	return true;
+}
+
+bool TextRenderer::AddGlyph(const GlyphId id, const Triangulation::Geometry &geometry)
+{
+	const auto handle = this->atlas->Add<CompactVertex>(geometry);
+	if (handle == MeshAtlas::invalidHandle) {
+		std::cerr << "Vulkan: Failed to add glyph " << id << std::endl;
+		return false;
+	}
+	this->SetGlyph(id, handle);
+	return true;
+}
+
+bool TextRenderer::AddGlyphs(const MeshBundle &bundle)
+{
+	if (bundle.GetVertexFormat() != MeshBundle::Format::CompactVertex) {
+		std::cerr << "Vulkan: Glyph bundles have to be stored as CompactVertex" << std::endl;
+		return false;
+	}
+	for (const auto &entry : bundle.GetEntries()) {
+		const auto handle = this->atlas->Add(bundle.GetVertexData(entry).data(), entry.vertexCount, bundle.GetIndices(entry));
+		if (handle == MeshAtlas::invalidHandle) {
+			std::cerr << "Vulkan: Failed to add glyph " << entry.id << std::endl;
+			return false;
+		}
+		this->SetGlyph(entry.id, handle);
+	}
+	return true;
+}
+
+void TextRenderer::SetGlyph(const GlyphId id, const MeshAtlas::Handle handle)
+{
+	auto [it, isInserted] = this->glyphs.try_emplace(id, handle);
+	if (!isInserted) {
+		this->atlas->Remove(it->second);
+		it->second = handle;
+	}
+	this->statistics.glyphCount = static_cast<uint32_t>(this->glyphs.size());
+}
+
+void TextRenderer::Add(const GlyphId id, const Instance &instance)
+{
+	const auto it = this->glyphs.find(id);
+	if (it == this->glyphs.end())
+		return;
+	this->queued.push_back(Queued{ .handle = it->second, .instance = instance });
+}
+
+void TextRenderer::AddRun(std::span<const Glyph> run, const glm::vec2 origin, const glm::vec2 scale, const glm::vec4 color)
+{
+	this->queued.reserve(this->queued.size() + run.size());
+	for (const auto &glyph : run)
+		this->Add(glyph.id, Instance{ .offset = origin + glyph.offset * scale, .scale = scale, .color = color });
+}
+
+bool TextRenderer::Draw()
+{
+	MyDefer clearQueue([this]() { this->queued.clear(); });
+	this->statistics.instanceCount = 0;
+	this->statistics.drawCount = 0;
+	this->statistics.drawCallCount = 0;
+
+	const auto core = this->coreWeak.lock();
+	if (!core)
+		return false;
+	// Glyphs replaced after they were queued
+	std::erase_if(this->queued, [this](const Queued &queued) { return !this->atlas->IsValid(queued.handle); });
+	if (this->queued.empty())
+		return true;
+
+	std::stable_sort(this->queued.begin(), this->queued.end(), [](const Queued &a, const Queued &b) { return a.handle < b.handle; });
+	uint32_t drawCount = 1;
+	for (size_t i = 1; i < this->queued.size(); i++)
+		drawCount += this->queued[i].handle != this->queued[i - 1].handle;
+
+	const auto instancesSize = sizeof(Instance) * static_cast<VkDeviceSize>(this->queued.size());
+	const auto commandsSize = sizeof(VkDrawIndexedIndirectCommand) * static_cast<VkDeviceSize>(drawCount);
+	// Instances followed by the indirect commands, rewritten every frame so they live in the frame's transient arena
+	Core::TransientAllocation frameData;
+	if (!core->AllocateTransient(instancesSize + commandsSize, alignof(Instance), frameData))
+		return false;
+
+	// Coherent memory, visible to the frame submission without a flush
+	auto instances = reinterpret_cast<Instance*>(frameData.mapped);
+	auto commands = reinterpret_cast<VkDrawIndexedIndirectCommand*>(frameData.mapped + instancesSize);
+	uint32_t commandIndex = 0;
+	for (uint32_t i = 0; i < this->queued.size(); i++) {
+		std::memcpy(instances + i, &this->queued[i].instance, sizeof(Instance));
+		if (i && this->queued[i].handle == this->queued[i - 1].handle) {
+			commands[commandIndex - 1].instanceCount++;
+			continue;
+		}
+		const auto range = this->atlas->GetRange(this->queued[i].handle);
+		commands[commandIndex++] = VkDrawIndexedIndirectCommand{
+			.indexCount = range.indexCount,
+			.instanceCount = 1,
+			.firstIndex = range.firstIndex,
+			.vertexOffset = range.vertexOffset,
+			.firstInstance = i
+		};
+	}
+
+	const auto vkCommandBuffer = core->GetVulkanCurrentFrameCommandBuffer();
+	VkBuffer vertexBuffers[] = { this->atlas->GetVertexBuffer(), frameData.buffer };
+	VkDeviceSize offsets[] = { 0, frameData.offset };
+	vkCmdBindVertexBuffers(vkCommandBuffer, 0, 2, vertexBuffers, offsets);
+	vkCmdBindIndexBuffer(vkCommandBuffer, this->atlas->GetIndexBuffer(), 0, VK_INDEX_TYPE_UINT16);
+
+	// Indirect draws can't start from a non-zero instance without drawIndirectFirstInstance, draw directly then
+	const auto &features = core->GetVulkanEnabledFeatures();
+	if (features.multiDrawIndirect && features.drawIndirectFirstInstance) {
+		for (uint32_t first = 0; first < drawCount; first += maxDrawIndirectCount) {
+			const auto count = std::min(drawCount - first, maxDrawIndirectCount);
+			vkCmdDrawIndexedIndirect(vkCommandBuffer, frameData.buffer, frameData.offset + instancesSize + sizeof(VkDrawIndexedIndirectCommand) * first, count, sizeof(VkDrawIndexedIndirectCommand));
+			this->statistics.drawCallCount++;
+		}
+	}
+	else if (features.drawIndirectFirstInstance) {
+		for (uint32_t i = 0; i < drawCount; i++)
+			vkCmdDrawIndexedIndirect(vkCommandBuffer, frameData.buffer, frameData.offset + instancesSize + sizeof(VkDrawIndexedIndirectCommand) * i, 1, sizeof(VkDrawIndexedIndirectCommand));
+		this->statistics.drawCallCount += drawCount;
+	}
+	else {
+		for (uint32_t i = 0; i < drawCount; i++)
+			vkCmdDrawIndexed(vkCommandBuffer, commands[i].indexCount, commands[i].instanceCount, commands[i].firstIndex, commands[i].vertexOffset, commands[i].firstInstance);
+		this->statistics.drawCallCount += drawCount;
+	}
+
+	this->statistics.instanceCount = static_cast<uint32_t>(this->queued.size());
+	this->statistics.drawCount = drawCount;
+	return true;
+}
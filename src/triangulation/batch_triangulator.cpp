@@ -0,0 +1,76 @@
+#include "triangulation/batch_triangulator.hpp"
+#include <algorithm>
+#include <iostream>
+#include <limits>
+
+namespace Triangulation {
+
+BatchTriangulator::BatchTriangulator(TaskPool &pool, const Triangulator::Options &options) : pool(pool), options(options)
+{
+}
+
+bool BatchTriangulator::Triangulate(std::span<const Outline> outlines, Geometry &geometry, std::vector<Range> &ranges)
+{
+	geometry.Clear();
+	ranges.assign(outlines.size(), Range{});
+	this->locations.resize(outlines.size());
+	this->threadData.resize(this->pool.GetThreadCount());
+	for (auto &data : this->threadData) {
+		data.triangulator.SetOptions(this->options);
+		data.geometry.Clear();
+	}
+
+	// Each outline is written by exactly one thread, into that thread's own buffers
+	this->pool.ParallelFor(outlines.size(), [this, &outlines, &ranges](const std::size_t index, const uint32_t thread) {
+		auto &data = this->threadData[thread];
+		const auto firstVertex = data.geometry.vertices.size();
+		const auto firstIndex = data.geometry.indices.size();
+		data.outline.Clear();
+		const auto isValid = data.triangulator.Triangulate(outlines[index], data.outline);
+		if (isValid) {
+			data.geometry.vertices.insert(data.geometry.vertices.end(), data.outline.vertices.begin(), data.outline.vertices.end());
+			data.geometry.indices.insert(data.geometry.indices.end(), data.outline.indices.begin(), data.outline.indices.end());
+		}
+		this->locations[index] = Location{
+			.thread = thread,
+			.firstVertex = static_cast<uint32_t>(firstVertex),
+			.firstIndex = static_cast<uint32_t>(firstIndex)
+		};
+		ranges[index] = Range{
+			.vertexCount = static_cast<uint32_t>(data.geometry.vertices.size() - firstVertex),
+			.indexCount = static_cast<uint32_t>(data.geometry.indices.size() - firstIndex),
+			.isValid = isValid
+		};
+	});
+
+	// Output offsets in outline order
+	uint64_t vertexCount = 0, indexCount = 0;
+	bool isValid = true;
+	for (auto &range : ranges) {
+		range.firstVertex = static_cast<uint32_t>(vertexCount);
+		range.firstIndex = static_cast<uint32_t>(indexCount);
+		vertexCount += range.vertexCount;
+		indexCount += range.indexCount;
+		isValid = isValid && range.isValid;
+	}
+	if (vertexCount > std::numeric_limits<uint32_t>::max() || indexCount > std::numeric_limits<uint32_t>::max()) {
+		std::cerr << "Triangulation: batch output doesn't fit into 32-bit offsets" << std::endl;
+		ranges.clear();
+		return false;
+	}
+	geometry.vertices.resize(vertexCount);
+	geometry.indices.resize(indexCount);
+
+	// Ranges don't overlap, so the copies need no synchronization either
+	this->pool.ParallelFor(outlines.size(), [this, &geometry, &ranges](const std::size_t index, const uint32_t) {
+		const auto &range = ranges[index];
+		const auto &location = this->locations[index];
+		const auto &source = this->threadData[location.thread].geometry;
+		std::copy_n(source.vertices.begin() + location.firstVertex, range.vertexCount, geometry.vertices.begin() + range.firstVertex);
+		std::copy_n(source.indices.begin() + location.firstIndex, range.indexCount, geometry.indices.begin() + range.firstIndex);
+	});
+
+	return isValid;
+}
+
+}
@@ -0,0 +1,87 @@
+#include "triangulation/bezier.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace Triangulation {
+
+uint32_t GetInflections(const CubicBezier &curve, std::array<float, 2> &inflections)
+{
+	// Zeroes of cross(B'(t), B''(t)), which is a quadratic in t
+	const auto a = curve[1] - curve[0];
+	const auto b = curve[2] - curve[1] - a;
+	const auto c = curve[3] - curve[0] - (curve[2] - curve[1]) * 3.0f;
+	const auto cross = [](const glm::vec2 &l, const glm::vec2 &r) { return l.x * r.y - l.y * r.x; };
+	const auto qa = cross(b, c);
+	const auto qb = cross(a, c);
+	const auto qc = cross(a, b);
+
+	uint32_t count = 0;
+	const auto add = [&inflections, &count](const float t) {
+		if (t > 0.0f && t < 1.0f)
+			inflections[count++] = t;
+	};
+	const auto scale = std::max({ std::abs(qa), std::abs(qb), std::abs(qc) });
+	if (scale == 0.0f)
+		return 0;
+	if (std::abs(qa) <= scale * 1e-6f) {
+		if (std::abs(qb) > scale * 1e-6f)
+			add(-qc / qb);
+		return count;
+	}
+	const auto discriminant = qb * qb - 4.0f * qa * qc;
+	if (discriminant < 0.0f)
+		return 0;
+	const auto root = std::sqrt(discriminant);
+	add((-qb - root) / (2.0f * qa));
+	add((-qb + root) / (2.0f * qa));
+	if (count == 2 && inflections[0] > inflections[1])
+		std::swap(inflections[0], inflections[1]);
+	return count;
+}
+
+namespace {
+	void ApproximateCubicPiece(const CubicBezier &curve, const float tolerance, std::vector<QuadraticBezier> &quadratics, const uint32_t maxPieceCount)
+	{
+		// Midpoint quadratic of a cubic is off by at most sqrt(3)/36 * |p3 - 3p2 + 3p1 - p0|,
+		// splitting into n equal pieces divides the third difference by n^3
+		const auto thirdDifference = glm::length(curve[3] - curve[2] * 3.0f + curve[1] * 3.0f - curve[0]);
+		const auto error = std::sqrt(3.0f) / 36.0f * thirdDifference;
+		uint32_t pieceCount = 1;
+		if (tolerance > 0.0f && error > tolerance)
+			pieceCount = static_cast<uint32_t>(std::ceil(std::cbrt(error / tolerance)));
+		pieceCount = std::clamp(pieceCount, 1u, std::max(maxPieceCount, 1u));
+
+		auto remaining = curve;
+		for (uint32_t i = 0; i < pieceCount; i++) {
+			CubicBezier piece = remaining;
+			if (i + 1 < pieceCount) {
+				const auto halves = Split(remaining, 1.0f / static_cast<float>(pieceCount - i));
+				piece = halves[0];
+				remaining = halves[1];
+			}
+			const auto control = ((piece[1] + piece[2]) * 3.0f - piece[0] - piece[3]) * 0.25f;
+			quadratics.push_back(QuadraticBezier{ piece[0], control, piece[3] });
+		}
+		// Keep the end point exact, it's shared with the next segment
+		quadratics.back()[2] = curve[3];
+	}
+}
+
+void ApproximateCubic(const CubicBezier &curve, const float tolerance, std::vector<QuadraticBezier> &quadratics, const uint32_t maxPieceCount)
+{
+	// Pieces between inflections bend one way, so every quadratic is either convex or concave
+	std::array<float, 2> inflections;
+	const auto inflectionCount = GetInflections(curve, inflections);
+
+	auto remaining = curve;
+	float start = 0.0f;
+	for (uint32_t i = 0; i < inflectionCount; i++) {
+		const auto halves = Split(remaining, (inflections[i] - start) / (1.0f - start));
+		ApproximateCubicPiece(halves[0], tolerance, quadratics, maxPieceCount);
+		remaining = halves[1];
+		start = inflections[i];
+	}
+	ApproximateCubicPiece(remaining, tolerance, quadratics, maxPieceCount);
+}
+
+}
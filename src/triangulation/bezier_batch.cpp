@@ -0,0 +1,172 @@
+#include "triangulation/bezier_batch.hpp"
+#include "simd.hpp"
+#include <algorithm>
+#include <array>
+
+namespace Triangulation {
+
+namespace {
+	using Simd::Float;
+
+	// Same operation order as Evaluate, so each lane rounds like the scalar version
+	struct QuadraticLanes {
+		Float x[3], y[3];
+
+		void Evaluate(const Float t, float *outX, float *outY) const
+		{
+			const auto mt = Float::Set(1.0f) - t;
+			const auto w0 = mt * mt;
+			const auto w1 = Float::Set(2.0f) * mt * t;
+			const auto w2 = t * t;
+			(this->x[0] * w0 + this->x[1] * w1 + this->x[2] * w2).Store(outX);
+			(this->y[0] * w0 + this->y[1] * w1 + this->y[2] * w2).Store(outY);
+		}
+	};
+	struct CubicLanes {
+		Float x[4], y[4];
+
+		void Evaluate(const Float t, float *outX, float *outY) const
+		{
+			const auto mt = Float::Set(1.0f) - t;
+			const auto three = Float::Set(3.0f);
+			const auto w0 = mt * mt * mt;
+			const auto w1 = three * mt * mt * t;
+			const auto w2 = three * mt * t * t;
+			const auto w3 = t * t * t;
+			(this->x[0] * w0 + this->x[1] * w1 + this->x[2] * w2 + this->x[3] * w3).Store(outX);
+			(this->y[0] * w0 + this->y[1] * w1 + this->y[2] * w2 + this->y[3] * w3).Store(outY);
+		}
+	};
+
+	// The same curve in every lane
+	template <typename Lanes, typename Curve>
+	Lanes Broadcast(const Curve &curve)
+	{
+		Lanes lanes;
+		for (std::size_t i = 0; i < curve.size(); i++) {
+			lanes.x[i] = Float::Set(curve[i].x);
+			lanes.y[i] = Float::Set(curve[i].y);
+		}
+		return lanes;
+	}
+	// A different curve in every lane, curves must hold at least Float::width items
+	template <typename Lanes, typename Curve>
+	Lanes Transpose(const Curve *curves)
+	{
+		constexpr auto pointCount = std::tuple_size_v<Curve>;
+		std::array<std::array<float, Float::width>, pointCount> x, y;
+		for (std::size_t lane = 0; lane < Float::width; lane++) {
+			for (std::size_t i = 0; i < pointCount; i++) {
+				x[i][lane] = curves[lane][i].x;
+				y[i][lane] = curves[lane][i].y;
+			}
+		}
+		Lanes lanes;
+		for (std::size_t i = 0; i < pointCount; i++) {
+			lanes.x[i] = Float::Load(x[i].data());
+			lanes.y[i] = Float::Load(y[i].data());
+		}
+		return lanes;
+	}
+
+	template <typename Lanes, typename Curve>
+	std::size_t EvaluateCurve(const Curve &curve, std::span<const float> t, std::span<float> x, std::span<float> y)
+	{
+		const auto count = t.size();
+		if (x.size() < count || y.size() < count)
+			return 0;
+		const auto lanes = Broadcast<Lanes>(curve);
+		std::size_t i = 0;
+		for (; i + Float::width <= count; i += Float::width)
+			lanes.Evaluate(Float::Load(t.data() + i), x.data() + i, y.data() + i);
+		for (; i < count; i++) {
+			const auto point = Triangulation::Evaluate(curve, t[i]);
+			x[i] = point.x;
+			y[i] = point.y;
+		}
+		return count;
+	}
+
+	template <typename Lanes, typename Curve>
+	std::size_t EvaluateCurveSteps(const Curve &curve, std::span<float> x, std::span<float> y)
+	{
+		const auto count = std::min(x.size(), y.size());
+		if (!count)
+			return 0;
+		const auto lanes = Broadcast<Lanes>(curve);
+		const auto step = 1.0f / static_cast<float>(count);
+		const auto stepLanes = Float::Set(step);
+		std::size_t i = 0;
+		for (; i + Float::width <= count; i += Float::width)
+			lanes.Evaluate(Float::Sequence(static_cast<float>(i + 1)) * stepLanes, x.data() + i, y.data() + i);
+		for (; i < count; i++) {
+			const auto point = Triangulation::Evaluate(curve, static_cast<float>(i + 1) * step);
+			x[i] = point.x;
+			y[i] = point.y;
+		}
+		// Exact end point, like the other tessellators
+		x[count - 1] = curve.back().x;
+		y[count - 1] = curve.back().y;
+		return count;
+	}
+
+	template <typename Lanes, typename Curve>
+	std::size_t EvaluateCurves(std::span<const Curve> curves, const float t, std::span<float> x, std::span<float> y)
+	{
+		const auto count = curves.size();
+		if (x.size() < count || y.size() < count)
+			return 0;
+		const auto tLanes = Float::Set(t);
+		std::size_t i = 0;
+		for (; i + Float::width <= count; i += Float::width)
+			Transpose<Lanes>(curves.data() + i).Evaluate(tLanes, x.data() + i, y.data() + i);
+		for (; i < count; i++) {
+			const auto point = Triangulation::Evaluate(curves[i], t);
+			x[i] = point.x;
+			y[i] = point.y;
+		}
+		return count;
+	}
+}
+
+std::size_t EvaluateBatch(const QuadraticBezier &curve, std::span<const float> t, std::span<float> x, std::span<float> y)
+{
+	return EvaluateCurve<QuadraticLanes>(curve, t, x, y);
+}
+std::size_t EvaluateBatch(const CubicBezier &curve, std::span<const float> t, std::span<float> x, std::span<float> y)
+{
+	return EvaluateCurve<CubicLanes>(curve, t, x, y);
+}
+
+std::size_t EvaluateSteps(const QuadraticBezier &curve, std::span<float> x, std::span<float> y)
+{
+	return EvaluateCurveSteps<QuadraticLanes>(curve, x, y);
+}
+std::size_t EvaluateSteps(const CubicBezier &curve, std::span<float> x, std::span<float> y)
+{
+	return EvaluateCurveSteps<CubicLanes>(curve, x, y);
+}
+
+std::size_t EvaluateBatch(std::span<const QuadraticBezier> curves, const float t, std::span<float> x, std::span<float> y)
+{
+	return EvaluateCurves<QuadraticLanes>(curves, t, x, y);
+}
+std::size_t EvaluateBatch(std::span<const CubicBezier> curves, const float t, std::span<float> x, std::span<float> y)
+{
+	return EvaluateCurves<CubicLanes>(curves, t, x, y);
+}
+
+const char* GetBatchInstructionSet()
+{
+#if defined(TRIANGULATION_SIMD_AVX)
+	return "AVX";
+#elif defined(TRIANGULATION_SIMD_SSE2)
+	return "SSE2";
+#elif defined(TRIANGULATION_SIMD_NEON)
+	return "NEON";
+#else
+	return "scalar";
+#endif
+}
+
+}
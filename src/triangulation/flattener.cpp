@@ -0,0 +1,110 @@
+#include "triangulation/flattener.hpp"
+#include "triangulation/bezier_batch.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace Triangulation {
+
+namespace {
+	// Wang's formula: n = sqrt(d * (d - 1) / 8 * max|second difference| / tolerance)
+	uint32_t GetWangSegmentCount(const float degreeFactor, const float maxSecondDifference, const float scaledTolerance)
+	{
+		if (scaledTolerance <= 0.0f)
+			return Flattener::maxSegmentCount;
+		const auto count = std::ceil(std::sqrt(degreeFactor * maxSecondDifference / scaledTolerance));
+		if (!(count < static_cast<float>(Flattener::maxSegmentCount)))
+			return Flattener::maxSegmentCount;
+		return std::max(1u, static_cast<uint32_t>(count));
+	}
+}
+
+Flattener::Flattener(const glm::mat3 &transform, const float tolerance) : scale(GetTransformScale(transform)), tolerance(tolerance)
+{
+}
+
+float Flattener::GetTransformScale(const glm::mat3 &transform)
+{
+	// Wang's bound is measured in outline units and scaled by it
+	const auto a = transform[0][0], b = transform[1][0], c = transform[0][1], d = transform[1][1];
+	const auto sum = a * a + b * b + c * c + d * d;
+	const auto determinant = a * d - b * c;
+	return std::sqrt((sum + std::sqrt(std::max(0.0f, sum * sum - 4.0f * determinant * determinant))) * 0.5f);
+}
+
+uint32_t Flattener::GetSegmentCount(const QuadraticBezier &curve) const
+{
+	const auto secondDifference = glm::length(curve[0] - curve[1] * 2.0f + curve[2]);
+	return GetWangSegmentCount(2.0f / 8.0f, secondDifference * this->scale, this->tolerance);
+}
+uint32_t Flattener::GetSegmentCount(const CubicBezier &curve) const
+{
+	const auto secondDifference = std::max(
+		glm::length(curve[0] - curve[1] * 2.0f + curve[2]),
+		glm::length(curve[1] - curve[2] * 2.0f + curve[3]));
+	return GetWangSegmentCount(6.0f / 8.0f, secondDifference * this->scale, this->tolerance);
+}
+
+std::size_t Flattener::Flatten(const QuadraticBezier &curve, std::span<glm::vec2> output) const
+{
+	const auto count = this->GetSegmentCount(curve);
+	if (output.size() < count)
+		return 0;
+
+	// Forward differencing, the second difference of a quadratic is constant
+	const auto step = 1.0f / static_cast<float>(count);
+	const auto a = (curve[0] - curve[1] * 2.0f + curve[2]) * (step * step);
+	const auto b = (curve[1] - curve[0]) * (2.0f * step);
+	auto point = curve[0];
+	auto firstDifference = a + b;
+	const auto secondDifference = a * 2.0f;
+	for (uint32_t i = 0; i + 1 < count; i++) {
+		point += firstDifference;
+		firstDifference += secondDifference;
+		output[i] = point;
+	}
+	output[count - 1] = curve[2];
+	return count;
+}
+std::size_t Flattener::Flatten(const CubicBezier &curve, std::span<glm::vec2> output) const
+{
+	const auto count = this->GetSegmentCount(curve);
+	if (output.size() < count)
+		return 0;
+
+	// Forward differencing, the third difference of a cubic is constant
+	const auto step = 1.0f / static_cast<float>(count);
+	const auto step2 = step * step;
+	const auto step3 = step2 * step;
+	const auto a = curve[3] - curve[2] * 3.0f + curve[1] * 3.0f - curve[0];
+	const auto b = (curve[2] - curve[1] * 2.0f + curve[0]) * 3.0f;
+	const auto c = (curve[1] - curve[0]) * 3.0f;
+	auto point = curve[0];
+	auto firstDifference = a * step3 + b * step2 + c * step;
+	auto secondDifference = a * (6.0f * step3) + b * (2.0f * step2);
+	const auto thirdDifference = a * (6.0f * step3);
+	for (uint32_t i = 0; i + 1 < count; i++) {
+		point += firstDifference;
+		firstDifference += secondDifference;
+		secondDifference += thirdDifference;
+		output[i] = point;
+	}
+	output[count - 1] = curve[3];
+	return count;
+}
+
+std::size_t Flattener::Flatten(const QuadraticBezier &curve, std::span<float> x, std::span<float> y) const
+{
+	const auto count = this->GetSegmentCount(curve);
+	if (x.size() < count || y.size() < count)
+		return 0;
+	return EvaluateSteps(curve, x.first(count), y.first(count));
+}
+std::size_t Flattener::Flatten(const CubicBezier &curve, std::span<float> x, std::span<float> y) const
+{
+	const auto count = this->GetSegmentCount(curve);
+	if (x.size() < count || y.size() < count)
+		return 0;
+	return EvaluateSteps(curve, x.first(count), y.first(count));
+}
+
+}
@@ -0,0 +1,90 @@
+#include "triangulation/outline.hpp"
+#include <iostream>
+
+namespace Triangulation {
+
+void Contour::MoveTo(const glm::vec2 &point)
+{
+	this->commands.clear();
+	this->points.clear();
+	this->isClosed = false;
+	this->commands.push_back(Command::Move);
+	this->points.push_back(point);
+}
+void Contour::LineTo(const glm::vec2 &point)
+{
+	if (this->commands.empty()) {
+		std::cerr << "Triangulation: Contour::LineTo without MoveTo" << std::endl;
+		return;
+	}
+	this->commands.push_back(Command::Line);
+	this->points.push_back(point);
+}
+void Contour::QuadTo(const glm::vec2 &control, const glm::vec2 &point)
+{
+	if (this->commands.empty()) {
+		std::cerr << "Triangulation: Contour::QuadTo without MoveTo" << std::endl;
+		return;
+	}
+	this->commands.push_back(Command::Quad);
+	this->points.push_back(control);
+	this->points.push_back(point);
+}
+void Contour::CubicTo(const glm::vec2 &control1, const glm::vec2 &control2, const glm::vec2 &point)
+{
+	if (this->commands.empty()) {
+		std::cerr << "Triangulation: Contour::CubicTo without MoveTo" << std::endl;
+		return;
+	}
+	this->commands.push_back(Command::Cubic);
+	this->points.push_back(control1);
+	this->points.push_back(control2);
+	this->points.push_back(point);
+}
+
+void Outline::MoveTo(const glm::vec2 &point)
+{
+	this->contours.emplace_back().MoveTo(point);
+	this->isClosed = false;
+}
+void Outline::LineTo(const glm::vec2 &point)
+{
+	this->GetCurrentContour().LineTo(point);
+}
+void Outline::QuadTo(const glm::vec2 &control, const glm::vec2 &point)
+{
+	this->GetCurrentContour().QuadTo(control, point);
+}
+void Outline::CubicTo(const glm::vec2 &control1, const glm::vec2 &control2, const glm::vec2 &point)
+{
+	this->GetCurrentContour().CubicTo(control1, control2, point);
+}
+void Outline::Close()
+{
+	if (!this->isClosed && !this->contours.empty())
+		this->contours.back().Close();
+	this->isClosed = true;
+}
+bool Outline::IsEmpty() const
+{
+	for (const auto &contour : this->contours) {
+		if (!contour.IsEmpty())
+			return false;
+	}
+	return true;
+}
+
+Contour& Outline::GetCurrentContour()
+{
+	// Drawing after Close() continues from the start point of the previous contour, like in svg
+	if (this->isClosed) {
+		const auto start = this->contours.empty() || this->contours.back().GetPoints().empty()
+			? glm::vec2(0.0f, 0.0f)
+			: this->contours.back().GetPoints().front();
+		this->contours.emplace_back().MoveTo(start);
+		this->isClosed = false;
+	}
+	return this->contours.back();
+}
+
+}
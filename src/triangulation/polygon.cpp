@@ -0,0 +1,558 @@
+#include "polygon.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+namespace Triangulation {
+
+namespace {
+	constexpr uint32_t invalidNode = std::numeric_limits<uint32_t>::max();
+
+	// Ear clipping over a circular doubly linked list, holes are bridged into the outer ring
+	// (port of the mapbox earcut approach, without z-order hashing)
+	class EarClipper {
+		struct Node {
+			uint32_t index;
+			glm::vec2 p;
+			uint32_t prev = invalidNode;
+			uint32_t next = invalidNode;
+			bool steiner = false;
+		};
+	public:
+		EarClipper(const std::vector<glm::vec2> &points, const float epsilon, std::vector<uint32_t> &triangles) : points(points), epsilon(epsilon), triangles(triangles) {}
+
+		// Returns false if part of the polygon couldn't be clipped, the triangles of the rest are appended anyway
+		bool Triangulate(const Ring &outer, const std::vector<const Ring*> &holes)
+		{
+			this->nodes.clear();
+			auto outerNode = this->LinkedList(outer, true);
+			if (outerNode == invalidNode || this->nodes[outerNode].next == this->nodes[outerNode].prev)
+				return true;
+			if (!holes.empty())
+				outerNode = this->EliminateHoles(holes, outerNode);
+			return this->EarcutLinked(outerNode, 0);
+		}
+
+	private:
+		Node& N(const uint32_t i) { return this->nodes[i]; }
+		static float Area(const glm::vec2 &p, const glm::vec2 &q, const glm::vec2 &r) {
+			return (q.y - p.y) * (r.x - q.x) - (q.x - p.x) * (r.y - q.y);
+		}
+		float Area(const uint32_t p, const uint32_t q, const uint32_t r) { return Area(N(p).p, N(q).p, N(r).p); }
+		// Within the snap distance, so rounding doesn't leave zero length edges that self-intersect
+		bool Equals(const uint32_t a, const uint32_t b) {
+			const auto delta = N(a).p - N(b).p;
+			return glm::dot(delta, delta) <= this->epsilon * this->epsilon;
+		}
+		static bool PointInTriangle(const glm::vec2 &a, const glm::vec2 &b, const glm::vec2 &c, const glm::vec2 &p) {
+			return (c.x - p.x) * (a.y - p.y) >= (a.x - p.x) * (c.y - p.y) &&
+				(a.x - p.x) * (b.y - p.y) >= (b.x - p.x) * (a.y - p.y) &&
+				(b.x - p.x) * (c.y - p.y) >= (c.x - p.x) * (b.y - p.y);
+		}
+
+		uint32_t InsertNode(const uint32_t index, const uint32_t last)
+		{
+			const auto node = static_cast<uint32_t>(this->nodes.size());
+			this->nodes.push_back(Node{ .index = index, .p = this->points[index] });
+			if (last == invalidNode) {
+				N(node).prev = node;
+				N(node).next = node;
+			}
+			else {
+				N(node).next = N(last).next;
+				N(node).prev = last;
+				N(N(last).next).prev = node;
+				N(last).next = node;
+			}
+			return node;
+		}
+		void RemoveNode(const uint32_t node)
+		{
+			N(N(node).next).prev = N(node).prev;
+			N(N(node).prev).next = N(node).next;
+		}
+		uint32_t LinkedList(const Ring &ring, const bool counterClockwise)
+		{
+			uint32_t last = invalidNode;
+			if (counterClockwise == (GetSignedArea(this->points, ring) > 0.0f)) {
+				for (auto it = ring.begin(); it != ring.end(); ++it)
+					last = this->InsertNode(*it, last);
+			}
+			else {
+				for (auto it = ring.rbegin(); it != ring.rend(); ++it)
+					last = this->InsertNode(*it, last);
+			}
+			if (last != invalidNode && this->Equals(last, N(last).next)) {
+				this->RemoveNode(last);
+				last = N(last).next;
+			}
+			return last;
+		}
+		uint32_t FilterPoints(const uint32_t start, uint32_t end = invalidNode)
+		{
+			if (start == invalidNode)
+				return start;
+			if (end == invalidNode)
+				end = start;
+
+			auto p = start;
+			bool again;
+			do {
+				again = false;
+				if (!N(p).steiner && (this->Equals(p, N(p).next) || this->Area(N(p).prev, p, N(p).next) == 0.0f)) {
+					this->RemoveNode(p);
+					p = end = N(p).prev;
+					if (p == N(p).next)
+						break;
+					again = true;
+				}
+				else {
+					p = N(p).next;
+				}
+			} while (again || p != end);
+			return end;
+		}
+
+		bool EarcutLinked(uint32_t ear, const int pass)
+		{
+			if (ear == invalidNode)
+				return true;
+			auto stop = ear;
+			while (N(ear).prev != N(ear).next) {
+				const auto prev = N(ear).prev;
+				const auto next = N(ear).next;
+				if (this->IsEar(ear)) {
+					this->triangles.push_back(N(prev).index);
+					this->triangles.push_back(N(ear).index);
+					this->triangles.push_back(N(next).index);
+					this->RemoveNode(ear);
+					ear = N(next).next;
+					stop = N(next).next;
+					continue;
+				}
+				ear = next;
+				if (ear == stop) {
+					// No ears left: first drop degenerate points, then cure small self-intersections,
+					// and as the last resort split the polygon in two
+					if (pass == 0)
+						return this->EarcutLinked(this->FilterPoints(ear), 1);
+					if (pass == 1)
+						return this->EarcutLinked(this->CureLocalIntersections(this->FilterPoints(ear)), 2);
+					return this->SplitEarcut(ear);
+				}
+			}
+			return true;
+		}
+		bool IsEar(const uint32_t ear)
+		{
+			const auto a = N(ear).prev;
+			const auto b = ear;
+			const auto c = N(ear).next;
+			if (this->Area(a, b, c) >= 0.0f)
+				return false; // reflex
+
+			auto p = N(c).next;
+			while (p != a) {
+				if (PointInTriangle(N(a).p, N(b).p, N(c).p, N(p).p) && this->Area(N(p).prev, p, N(p).next) >= 0.0f)
+					return false;
+				p = N(p).next;
+			}
+			return true;
+		}
+		uint32_t CureLocalIntersections(uint32_t start)
+		{
+			auto p = start;
+			do {
+				const auto a = N(p).prev;
+				const auto b = N(N(p).next).next;
+				if (!this->Equals(a, b) && this->Intersects(a, p, N(p).next, b) && this->LocallyInside(a, b) && this->LocallyInside(b, a)) {
+					this->triangles.push_back(N(a).index);
+					this->triangles.push_back(N(p).index);
+					this->triangles.push_back(N(b).index);
+					this->RemoveNode(N(p).next);
+					this->RemoveNode(p);
+					p = start = b;
+				}
+				p = N(p).next;
+			} while (p != start);
+			return this->FilterPoints(p);
+		}
+		bool SplitEarcut(const uint32_t start)
+		{
+			auto a = start;
+			do {
+				auto b = N(N(a).next).next;
+				while (b != N(a).prev) {
+					if (N(a).index != N(b).index && this->IsValidDiagonal(a, b)) {
+						auto c = this->SplitPolygon(a, b);
+						a = this->FilterPoints(a, N(a).next);
+						c = this->FilterPoints(c, N(c).next);
+						// Both halves, even if the first one fails
+						const bool isFirstClipped = this->EarcutLinked(a, 0);
+						return this->EarcutLinked(c, 0) && isFirstClipped;
+					}
+					b = N(b).next;
+				}
+				a = N(a).next;
+			} while (a != start);
+			std::cerr << "Triangulation: Failed to split polygon" << std::endl;
+			return false;
+		}
+
+		uint32_t EliminateHoles(const std::vector<const Ring*> &holes, uint32_t outerNode)
+		{
+			std::vector<uint32_t> queue;
+			queue.reserve(holes.size());
+			for (const auto hole : holes) {
+				const auto list = this->LinkedList(*hole, false);
+				if (list == invalidNode)
+					continue;
+				if (list == N(list).next)
+					N(list).steiner = true;
+				queue.push_back(this->GetLeftmost(list));
+			}
+			std::sort(queue.begin(), queue.end(), [this](const uint32_t a, const uint32_t b) {
+				return N(a).p.x < N(b).p.x;
+			});
+			for (const auto hole : queue)
+				outerNode = this->EliminateHole(hole, outerNode);
+			return outerNode;
+		}
+		uint32_t EliminateHole(const uint32_t hole, const uint32_t outerNode)
+		{
+			const auto bridge = this->FindHoleBridge(hole, outerNode);
+			if (bridge == invalidNode)
+				return outerNode;
+			const auto bridgeReverse = this->SplitPolygon(bridge, hole);
+			this->FilterPoints(bridgeReverse, N(bridgeReverse).next);
+			return this->FilterPoints(bridge, N(bridge).next);
+		}
+		uint32_t FindHoleBridge(const uint32_t hole, const uint32_t outerNode)
+		{
+			const auto h = N(hole).p;
+			auto qx = -std::numeric_limits<float>::infinity();
+			auto m = invalidNode;
+
+			// Find the segment of the outer ring that is closest to the hole point on the left
+			auto p = outerNode;
+			do {
+				const auto &a = N(p).p;
+				const auto &b = N(N(p).next).p;
+				if (h.y <= a.y && h.y >= b.y && b.y != a.y) {
+					const auto x = a.x + (h.y - a.y) * (b.x - a.x) / (b.y - a.y);
+					if (x <= h.x && x > qx) {
+						qx = x;
+						m = a.x < b.x ? p : N(p).next;
+						if (x == h.x)
+							return m;
+					}
+				}
+				p = N(p).next;
+			} while (p != outerNode);
+			if (m == invalidNode)
+				return invalidNode;
+
+			// Look for points inside the triangle of hole point, segment intersection and endpoint,
+			// if any is found, connect to the one with the minimum angle to the ray instead
+			const auto stop = m;
+			const auto mp = N(m).p;
+			auto tanMin = std::numeric_limits<float>::infinity();
+			p = m;
+			do {
+				const auto pp = N(p).p;
+				if (h.x >= pp.x && pp.x >= mp.x && h.x != pp.x &&
+					PointInTriangle({ h.y < mp.y ? h.x : qx, h.y }, mp, { h.y < mp.y ? qx : h.x, h.y }, pp)) {
+					const auto tan = std::abs(h.y - pp.y) / (h.x - pp.x);
+					if (this->LocallyInside(p, hole) &&
+						(tan < tanMin || (tan == tanMin && (pp.x > N(m).p.x || (pp.x == N(m).p.x && this->SectorContainsSector(m, p)))))) {
+						m = p;
+						tanMin = tan;
+					}
+				}
+				p = N(p).next;
+			} while (p != stop);
+			return m;
+		}
+		uint32_t GetLeftmost(const uint32_t start)
+		{
+			auto p = start;
+			auto leftmost = start;
+			do {
+				if (N(p).p.x < N(leftmost).p.x || (N(p).p.x == N(leftmost).p.x && N(p).p.y < N(leftmost).p.y))
+					leftmost = p;
+				p = N(p).next;
+			} while (p != start);
+			return leftmost;
+		}
+
+		bool SectorContainsSector(const uint32_t m, const uint32_t p)
+		{
+			return this->Area(N(m).prev, m, N(p).prev) < 0.0f && this->Area(N(p).next, m, N(m).next) < 0.0f;
+		}
+		bool IsValidDiagonal(const uint32_t a, const uint32_t b)
+		{
+			return N(N(a).next).index != N(b).index && N(N(a).prev).index != N(b).index && !this->IntersectsPolygon(a, b) &&
+				((this->LocallyInside(a, b) && this->LocallyInside(b, a) && this->MiddleInside(a, b) &&
+					(this->Area(N(a).prev, a, N(b).prev) != 0.0f || this->Area(a, N(b).prev, b) != 0.0f)) ||
+				(this->Equals(a, b) && this->Area(N(a).prev, a, N(a).next) > 0.0f && this->Area(N(b).prev, b, N(b).next) > 0.0f));
+		}
+		static int Sign(const float value) { return (value > 0.0f) - (value < 0.0f); }
+		static bool OnSegment(const glm::vec2 &p, const glm::vec2 &q, const glm::vec2 &r) {
+			return q.x <= std::max(p.x, r.x) && q.x >= std::min(p.x, r.x) && q.y <= std::max(p.y, r.y) && q.y >= std::min(p.y, r.y);
+		}
+		bool Intersects(const uint32_t p1, const uint32_t q1, const uint32_t p2, const uint32_t q2)
+		{
+			const auto o1 = Sign(this->Area(p1, q1, p2));
+			const auto o2 = Sign(this->Area(p1, q1, q2));
+			const auto o3 = Sign(this->Area(p2, q2, p1));
+			const auto o4 = Sign(this->Area(p2, q2, q1));
+			if (o1 != o2 && o3 != o4)
+				return true;
+			if (o1 == 0 && OnSegment(N(p1).p, N(p2).p, N(q1).p))
+				return true;
+			if (o2 == 0 && OnSegment(N(p1).p, N(q2).p, N(q1).p))
+				return true;
+			if (o3 == 0 && OnSegment(N(p2).p, N(p1).p, N(q2).p))
+				return true;
+			if (o4 == 0 && OnSegment(N(p2).p, N(q1).p, N(q2).p))
+				return true;
+			return false;
+		}
+		bool IntersectsPolygon(const uint32_t a, const uint32_t b)
+		{
+			auto p = a;
+			do {
+				const auto next = N(p).next;
+				if (N(p).index != N(a).index && N(next).index != N(a).index && N(p).index != N(b).index && N(next).index != N(b).index &&
+					this->Intersects(p, next, a, b))
+					return true;
+				p = next;
+			} while (p != a);
+			return false;
+		}
+		bool LocallyInside(const uint32_t a, const uint32_t b)
+		{
+			return this->Area(N(a).prev, a, N(a).next) < 0.0f
+				? this->Area(a, b, N(a).next) >= 0.0f && this->Area(a, N(a).prev, b) >= 0.0f
+				: this->Area(a, b, N(a).prev) < 0.0f || this->Area(a, N(a).next, b) < 0.0f;
+		}
+		bool MiddleInside(const uint32_t a, const uint32_t b)
+		{
+			auto p = a;
+			bool inside = false;
+			const auto middle = (N(a).p + N(b).p) * 0.5f;
+			do {
+				const auto &pp = N(p).p;
+				const auto &np = N(N(p).next).p;
+				if (((pp.y > middle.y) != (np.y > middle.y)) && np.y != pp.y &&
+					(middle.x < (np.x - pp.x) * (middle.y - pp.y) / (np.y - pp.y) + pp.x))
+					inside = !inside;
+				p = N(p).next;
+			} while (p != a);
+			return inside;
+		}
+		uint32_t SplitPolygon(const uint32_t a, const uint32_t b)
+		{
+			const auto a2 = static_cast<uint32_t>(this->nodes.size());
+			this->nodes.push_back(Node{ .index = N(a).index, .p = N(a).p });
+			const auto b2 = static_cast<uint32_t>(this->nodes.size());
+			this->nodes.push_back(Node{ .index = N(b).index, .p = N(b).p });
+			const auto an = N(a).next;
+			const auto bp = N(b).prev;
+
+			N(a).next = b;
+			N(b).prev = a;
+			N(a2).next = an;
+			N(an).prev = a2;
+			N(b2).next = a2;
+			N(a2).prev = b2;
+			N(bp).next = b2;
+			N(b2).prev = bp;
+			return b2;
+		}
+
+		const std::vector<glm::vec2> &points;
+		const float epsilon;
+		std::vector<uint32_t> &triangles;
+		std::vector<Node> nodes;
+	};
+
+	bool ContainsPoint(const std::vector<glm::vec2> &points, const Ring &ring, const glm::vec2 &point)
+	{
+		bool inside = false;
+		for (std::size_t i = 0, j = ring.size() - 1; i < ring.size(); j = i++) {
+			const auto &a = points[ring[i]];
+			const auto &b = points[ring[j]];
+			if (((a.y > point.y) != (b.y > point.y)) && (point.x < (b.x - a.x) * (point.y - a.y) / (b.y - a.y) + a.x))
+				inside = !inside;
+		}
+		return inside;
+	}
+	// Most points decide, the ones on the edges of the outer ring could go either way
+	bool ContainsRing(const std::vector<glm::vec2> &points, const Ring &outer, const Ring &inner)
+	{
+		int64_t balance = 0;
+		for (const auto index : inner)
+			balance += ContainsPoint(points, outer, points[index]) ? 1 : -1;
+		return balance > 0;
+	}
+
+	struct Bounds {
+		glm::vec2 min = glm::vec2(std::numeric_limits<float>::max());
+		glm::vec2 max = glm::vec2(std::numeric_limits<float>::lowest());
+
+		void Add(const glm::vec2 &point) { min = glm::min(min, point); max = glm::max(max, point); }
+		bool Overlaps(const Bounds &other) const { return min.x <= other.max.x && other.min.x <= max.x && min.y <= other.max.y && other.min.y <= max.y; }
+		bool Contains(const Bounds &other) const { return min.x <= other.min.x && min.y <= other.min.y && other.max.x <= max.x && other.max.y <= max.y; }
+	};
+	Bounds GetBounds(const std::vector<glm::vec2> &points, const Ring &ring)
+	{
+		Bounds bounds;
+		for (const auto index : ring)
+			bounds.Add(points[index]);
+		return bounds;
+	}
+	float Cross(const glm::vec2 &a, const glm::vec2 &b, const glm::vec2 &c)
+	{
+		return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+	}
+	// Proper crossings only, rings touching at a point or along an edge (glyphs do that) don't cross
+	bool RingsCross(const std::vector<glm::vec2> &points, const Ring &a, const Ring &b, const Bounds &boundsB)
+	{
+		for (std::size_t i = 0, j = a.size() - 1; i < a.size(); j = i++) {
+			const auto &p = points[a[j]];
+			const auto &q = points[a[i]];
+			Bounds edge;
+			edge.Add(p);
+			edge.Add(q);
+			if (!edge.Overlaps(boundsB))
+				continue;
+			for (std::size_t k = 0, l = b.size() - 1; k < b.size(); l = k++) {
+				const auto &r = points[b[l]];
+				const auto &s = points[b[k]];
+				const auto d1 = Cross(p, q, r), d2 = Cross(p, q, s);
+				if (!((d1 > 0.0f && d2 < 0.0f) || (d1 < 0.0f && d2 > 0.0f)))
+					continue;
+				const auto d3 = Cross(r, s, p), d4 = Cross(r, s, q);
+				if ((d3 > 0.0f && d4 < 0.0f) || (d3 < 0.0f && d4 > 0.0f))
+					return true;
+			}
+		}
+		return false;
+	}
+}
+
+float GetSignedArea(const std::vector<glm::vec2> &points, const Ring &ring)
+{
+	float area = 0.0f;
+	for (std::size_t i = 0, j = ring.size() - 1; i < ring.size(); j = i++) {
+		const auto &a = points[ring[j]];
+		const auto &b = points[ring[i]];
+		area += a.x * b.y - b.x * a.y;
+	}
+	return area * 0.5f;
+}
+
+bool GetRingNesting(const std::vector<glm::vec2> &points, const std::vector<Ring> &rings, const FillRule fillRule, std::vector<RingNesting> &nesting)
+{
+	nesting.assign(rings.size(), RingNesting{});
+	std::vector<Bounds> bounds(rings.size());
+	std::vector<int32_t> directions(rings.size(), 0);
+	for (std::size_t i = 0; i < rings.size(); i++) {
+		if (rings[i].size() < 3)
+			continue;
+		const auto area = GetSignedArea(points, rings[i]);
+		nesting[i].area = std::abs(area);
+		directions[i] = area > 0.0f ? 1 : -1;
+		bounds[i] = GetBounds(points, rings[i]);
+	}
+
+	// Containment only means something for rings that don't cross
+	for (std::size_t i = 0; i < rings.size(); i++) {
+		if (nesting[i].area == 0.0f)
+			continue;
+		for (std::size_t j = i + 1; j < rings.size(); j++) {
+			if (nesting[j].area != 0.0f && bounds[i].Overlaps(bounds[j]) && RingsCross(points, rings[i], rings[j], bounds[j])) {
+				std::cerr << "Triangulation: Contours cross each other, only nested or separate contours are supported" << std::endl;
+				return false;
+			}
+		}
+	}
+
+	for (std::size_t i = 0; i < rings.size(); i++) {
+		if (nesting[i].area == 0.0f)
+			continue;
+		for (std::size_t j = 0; j < rings.size(); j++) {
+			if (i == j || nesting[j].area <= nesting[i].area || !bounds[j].Contains(bounds[i]))
+				continue;
+			// The smallest container is the direct parent
+			const auto parent = nesting[i].parent;
+			if ((parent < 0 || nesting[j].area < nesting[parent].area) && ContainsRing(points, rings[j], rings[i]))
+				nesting[i].parent = static_cast<int32_t>(j);
+		}
+	}
+
+	// Containers first, the winding inside a ring is the one around it plus its own direction
+	std::vector<uint32_t> order(rings.size());
+	for (uint32_t i = 0; i < order.size(); i++)
+		order[i] = i;
+	std::sort(order.begin(), order.end(), [&nesting](const uint32_t a, const uint32_t b) { return nesting[a].area > nesting[b].area; });
+	const auto isFilled = [fillRule](const int32_t winding) {
+		return fillRule == FillRule::NonZero ? winding != 0 : (winding % 2) != 0;
+	};
+	for (const auto i : order) {
+		auto &ring = nesting[i];
+		if (ring.area == 0.0f)
+			continue;
+		const auto outside = ring.parent < 0 ? 0 : nesting[ring.parent].winding;
+		ring.winding = outside + directions[i];
+		ring.isFilled = isFilled(ring.winding);
+		ring.isBoundary = ring.isFilled != isFilled(outside);
+	}
+	for (auto &ring : nesting) {
+		auto parent = ring.parent;
+		while (parent >= 0 && !nesting[parent].isBoundary)
+			parent = nesting[parent].parent;
+		ring.boundaryParent = parent;
+	}
+	return true;
+}
+
+bool TriangulatePolygon(const std::vector<glm::vec2> &points, const std::vector<Ring> &rings, const FillRule fillRule, std::vector<uint32_t> &triangles)
+{
+	std::vector<RingNesting> nesting;
+	if (!GetRingNesting(points, rings, fillRule, nesting))
+		return false;
+	return TriangulatePolygon(points, rings, nesting, triangles);
+}
+
+bool TriangulatePolygon(const std::vector<glm::vec2> &points, const std::vector<Ring> &rings, const std::vector<RingNesting> &nesting, std::vector<uint32_t> &triangles)
+{
+	glm::vec2 boundsMin = glm::vec2(std::numeric_limits<float>::max());
+	glm::vec2 boundsMax = glm::vec2(std::numeric_limits<float>::lowest());
+	for (const auto &point : points) {
+		boundsMin = glm::min(boundsMin, point);
+		boundsMax = glm::max(boundsMax, point);
+	}
+	const auto epsilon = points.empty() ? 0.0f : std::max(boundsMax.x - boundsMin.x, boundsMax.y - boundsMin.y) * snapTolerance;
+
+	EarClipper earClipper(points, epsilon, triangles);
+	std::vector<const Ring*> holes;
+	bool isComplete = true;
+	for (std::size_t i = 0; i < rings.size(); i++) {
+		if (!nesting[i].isBoundary || !nesting[i].isFilled)
+			continue;
+		holes.clear();
+		for (std::size_t j = 0; j < rings.size(); j++) {
+			if (nesting[j].isBoundary && !nesting[j].isFilled && nesting[j].boundaryParent == static_cast<int32_t>(i))
+				holes.push_back(&rings[j]);
+		}
+		if (!earClipper.Triangulate(rings[i], holes))
+			isComplete = false;
+	}
+
+	return isComplete;
+}
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "triangulation/triangulator.hpp"
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace Triangulation {
+	// Closed ring of indices into a shared point array
+	typedef std::vector<uint32_t> Ring;
+
+	typedef Triangulator::FillRule FillRule;
+
+	// Points closer than this times the extent of the outline are the same point, float rounding leaves
+	// the end of a closed contour a few ulps off its start
+	constexpr float snapTolerance = 1e-5f;
+
+	struct RingNesting {
+		float area = 0.0f; // absolute, zero for degenerate rings
+		int32_t parent = -1; // smallest ring containing this one
+		int32_t winding = 0; // winding number just inside the ring, counter-clockwise rings add one
+		bool isFilled = false; // by the fill rule, just inside the ring
+		bool isBoundary = false; // the fill changes across the ring: an outer boundary if isFilled, a hole otherwise
+		int32_t boundaryParent = -1; // smallest boundary containing this one, what a hole is cut out of
+	};
+	// Returns false if two rings cross each other, their nesting (and the fill) isn't defined by containment then
+	bool GetRingNesting(const std::vector<glm::vec2> &points, const std::vector<Ring> &rings, const FillRule fillRule, std::vector<RingNesting> &nesting);
+
+	// Groups boundary rings into outer boundaries and their holes and ear clips every group, rings the fill doesn't change across are skipped.
+	// Appends triangles (indices into points) with positive signed area to the triangles array.
+	// Returns false if some part couldn't be triangulated (crossing or self-intersecting rings), the triangles array is incomplete then
+	bool TriangulatePolygon(const std::vector<glm::vec2> &points, const std::vector<Ring> &rings, const FillRule fillRule, std::vector<uint32_t> &triangles);
+	bool TriangulatePolygon(const std::vector<glm::vec2> &points, const std::vector<Ring> &rings, const std::vector<RingNesting> &nesting, std::vector<uint32_t> &triangles);
+
+	// Signed area of the ring, positive for counter-clockwise rings
+	float GetSignedArea(const std::vector<glm::vec2> &points, const Ring &ring);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+
+// Widest float vector the compiler was allowed to use, there is no runtime dispatch
+#if defined(__AVX__)
+#include <immintrin.h>
+#define TRIANGULATION_SIMD_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TRIANGULATION_SIMD_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define TRIANGULATION_SIMD_NEON
+#endif
+
+namespace Triangulation::Simd {
+	// Only plain multiply/add/subtract, so the kernels round exactly like the scalar code written in the same order
+	struct Float {
+#if defined(TRIANGULATION_SIMD_AVX)
+		static constexpr std::size_t width = 8;
+		__m256 value;
+
+		static Float Set(const float x) { return { _mm256_set1_ps(x) }; }
+		static Float Load(const float *data) { return { _mm256_loadu_ps(data) }; }
+		// Lanes are first, first + 1, ...
+		static Float Sequence(const float first) { return { _mm256_add_ps(_mm256_set1_ps(first), _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f)) }; }
+		void Store(float *data) const { _mm256_storeu_ps(data, value); }
+		friend Float operator+(const Float a, const Float b) { return { _mm256_add_ps(a.value, b.value) }; }
+		friend Float operator-(const Float a, const Float b) { return { _mm256_sub_ps(a.value, b.value) }; }
+		friend Float operator*(const Float a, const Float b) { return { _mm256_mul_ps(a.value, b.value) }; }
+#elif defined(TRIANGULATION_SIMD_SSE2)
+		static constexpr std::size_t width = 4;
+		__m128 value;
+
+		static Float Set(const float x) { return { _mm_set1_ps(x) }; }
+		static Float Load(const float *data) { return { _mm_loadu_ps(data) }; }
+		static Float Sequence(const float first) { return { _mm_add_ps(_mm_set1_ps(first), _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f)) }; }
+		void Store(float *data) const { _mm_storeu_ps(data, value); }
+		friend Float operator+(const Float a, const Float b) { return { _mm_add_ps(a.value, b.value) }; }
+		friend Float operator-(const Float a, const Float b) { return { _mm_sub_ps(a.value, b.value) }; }
+		friend Float operator*(const Float a, const Float b) { return { _mm_mul_ps(a.value, b.value) }; }
+#elif defined(TRIANGULATION_SIMD_NEON)
+		static constexpr std::size_t width = 4;
+		float32x4_t value;
+
+		static Float Set(const float x) { return { vdupq_n_f32(x) }; }
+		static Float Load(const float *data) { return { vld1q_f32(data) }; }
+		static Float Sequence(const float first)
+		{
+			static const float offsets[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+			return { vaddq_f32(vdupq_n_f32(first), vld1q_f32(offsets)) };
+		}
+		void Store(float *data) const { vst1q_f32(data, value); }
+		friend Float operator+(const Float a, const Float b) { return { vaddq_f32(a.value, b.value) }; }
+		friend Float operator-(const Float a, const Float b) { return { vsubq_f32(a.value, b.value) }; }
+		friend Float operator*(const Float a, const Float b) { return { vmulq_f32(a.value, b.value) }; }
+#else
+		static constexpr std::size_t width = 1;
+		float value;
+
+		static Float Set(const float x) { return { x }; }
+		static Float Load(const float *data) { return { *data }; }
+		static Float Sequence(const float first) { return { first }; }
+		void Store(float *data) const { *data = value; }
+		friend Float operator+(const Float a, const Float b) { return { a.value + b.value }; }
+		friend Float operator-(const Float a, const Float b) { return { a.value - b.value }; }
+		friend Float operator*(const Float a, const Float b) { return { a.value * b.value }; }
+#endif
+	};
+}
@@ -0,0 +1,366 @@
+#include "triangulation/stroker.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <numbers>
+
+namespace Triangulation {
+
+namespace {
+	float Cross(const glm::vec2 &a, const glm::vec2 &b)
+	{
+		return a.x * b.y - a.y * b.x;
+	}
+	glm::vec2 GetLeftNormal(const glm::vec2 &direction)
+	{
+		return { -direction.y, direction.x };
+	}
+
+	// Directions closer than this are treated as a straight continuation
+	constexpr float straightEpsilon = 1e-6f;
+	constexpr uint32_t maxArcSegmentCount = 256;
+}
+
+bool Stroker::Stroke(const Outline &outline, Geometry &geometry)
+{
+	this->flattener = Flattener(this->options.transform, this->options.tolerance);
+	this->halfWidth = this->options.width * 0.5f;
+	// Arc segments whose sagitta stays within tolerance on screen
+	const auto radius = this->halfWidth * this->flattener.GetScale();
+	this->maxArcStep = radius > this->options.tolerance
+		? 2.0f * std::acos(1.0f - this->options.tolerance / radius)
+		: std::numbers::pi_v<float>;
+
+	const auto vertexCount = geometry.vertices.size();
+	const auto indexCount = geometry.indices.size();
+	if (this->halfWidth <= 0.0f)
+		return true;
+
+	for (const auto &contour : outline.GetContours()) {
+		if (contour.GetCommands().empty())
+			continue;
+		this->Flatten(contour);
+		// Closing point duplicates the start
+		const bool isClosed = contour.IsClosed() && this->points.size() > 2;
+		if (isClosed && this->points.back() == this->points.front())
+			this->points.pop_back();
+
+		if (this->options.dashes.empty())
+			this->StrokePolyline(this->points, isClosed, geometry);
+		else
+			this->StrokeDashed(isClosed, geometry);
+	}
+
+	if (geometry.vertices.size() > std::numeric_limits<Indices::value_type>::max() + std::size_t(1)) {
+		std::cerr << "Triangulation: Stroke has too many vertices for 16-bit indices" << std::endl;
+		geometry.vertices.resize(vertexCount);
+		geometry.indices.resize(indexCount);
+		return false;
+	}
+	return true;
+}
+
+void Stroker::Flatten(const Contour &contour)
+{
+	// Consecutive duplicates are dropped, segments always have a direction
+	this->points.clear();
+	const auto addPoint = [this](const glm::vec2 &point) {
+		if (this->points.empty() || this->points.back() != point)
+			this->points.push_back(point);
+	};
+	// Evaluated with the batch kernels into the x/y scratch buffers
+	const auto addCurve = [this, &addPoint](const auto &curve) {
+		const auto count = this->flattener.GetSegmentCount(curve);
+		this->curveX.resize(count);
+		this->curveY.resize(count);
+		this->flattener.Flatten(curve, std::span(this->curveX), std::span(this->curveY));
+		for (std::size_t i = 0; i < count; i++)
+			addPoint(glm::vec2(this->curveX[i], this->curveY[i]));
+	};
+
+	const auto &contourPoints = contour.GetPoints();
+	std::size_t pointIndex = 0;
+	glm::vec2 current = { 0.0f, 0.0f };
+	for (const auto command : contour.GetCommands()) {
+		switch (command) {
+		case Contour::Command::Move:
+		case Contour::Command::Line:
+			current = contourPoints[pointIndex];
+			addPoint(current);
+			break;
+		case Contour::Command::Quad: {
+			const QuadraticBezier curve = { current, contourPoints[pointIndex], contourPoints[pointIndex + 1] };
+			addCurve(curve);
+			current = curve[2];
+			break;
+		}
+		case Contour::Command::Cubic: {
+			const CubicBezier curve = { current, contourPoints[pointIndex], contourPoints[pointIndex + 1], contourPoints[pointIndex + 2] };
+			addCurve(curve);
+			current = curve[3];
+			break;
+		}
+		}
+		pointIndex += Contour::GetPointCount(command);
+	}
+}
+
+void Stroker::StrokeDashed(const bool isClosed, Geometry &geometry)
+{
+	const auto &dashes = this->options.dashes;
+	// Odd patterns are repeated twice, so dashes and gaps alternate
+	const auto patternCount = dashes.size() % 2 ? dashes.size() * 2 : dashes.size();
+	float patternLength = 0.0f;
+	for (const auto dash : dashes) {
+		if (dash < 0.0f) {
+			this->StrokePolyline(this->points, isClosed, geometry);
+			return;
+		}
+		patternLength += dash;
+	}
+	patternLength *= static_cast<float>(patternCount / dashes.size());
+	if (patternLength <= 0.0f) {
+		this->StrokePolyline(this->points, isClosed, geometry);
+		return;
+	}
+
+	// Where in the pattern the contour starts
+	std::size_t dashIndex = 0;
+	auto remaining = std::fmod(this->options.dashOffset, patternLength);
+	if (remaining < 0.0f)
+		remaining += patternLength;
+	while (remaining >= dashes[dashIndex % dashes.size()]) {
+		remaining -= dashes[dashIndex % dashes.size()];
+		dashIndex = (dashIndex + 1) % patternCount;
+	}
+	remaining = dashes[dashIndex % dashes.size()] - remaining;
+
+	this->dashPoints.clear();
+	if (dashIndex % 2 == 0)
+		this->dashPoints.push_back(this->points.front());
+	const auto segmentCount = isClosed ? this->points.size() : this->points.size() - 1;
+	for (std::size_t i = 0; i < segmentCount; i++) {
+		auto start = this->points[i];
+		const auto &end = this->points[(i + 1) % this->points.size()];
+		auto length = glm::length(end - start);
+		while (length > remaining) {
+			// Dash or gap ends within the segment
+			start += (end - start) * (remaining / length);
+			length -= remaining;
+			if (dashIndex % 2 == 0) {
+				if (this->dashPoints.back() != start)
+					this->dashPoints.push_back(start);
+				this->StrokePolyline(this->dashPoints, false, geometry);
+				this->dashPoints.clear();
+			} else {
+				this->dashPoints.push_back(start);
+			}
+			dashIndex = (dashIndex + 1) % patternCount;
+			remaining = dashes[dashIndex % dashes.size()];
+		}
+		remaining -= length;
+		if (dashIndex % 2 == 0 && this->dashPoints.back() != end)
+			this->dashPoints.push_back(end);
+	}
+	if (dashIndex % 2 == 0 && !this->dashPoints.empty())
+		this->StrokePolyline(this->dashPoints, false, geometry);
+}
+
+void Stroker::StrokePolyline(std::span<const glm::vec2> points, const bool isClosed, Geometry &geometry)
+{
+	if (points.empty())
+		return;
+	// Zero length, only caps that stick out draw anything (like svg)
+	if (points.size() == 1) {
+		if (this->options.cap == Cap::Butt)
+			return;
+		const glm::vec2 direction = { 1.0f, 0.0f };
+		const auto normal = GetLeftNormal(direction) * this->halfWidth;
+		const auto left = this->AddVertex(points[0] + normal, geometry);
+		const auto right = this->AddVertex(points[0] - normal, geometry);
+		this->EmitCap(points[0], -direction, left, right, geometry);
+		this->EmitCap(points[0], direction, left, right, geometry);
+		return;
+	}
+
+	const auto segmentCount = isClosed ? points.size() : points.size() - 1;
+	const auto getDirection = [&points](const std::size_t segment, float &length) {
+		const auto edge = points[(segment + 1) % points.size()] - points[segment];
+		length = glm::length(edge);
+		return edge / length;
+	};
+
+	// Vertices across the start of the current segment, and across the end of the last one when closed
+	uint32_t start[2], closing[2] = { 0, 0 };
+	float length = 0.0f;
+	auto direction = getDirection(0, length);
+	if (isClosed) {
+		float lastLength = 0.0f;
+		const auto lastDirection = getDirection(segmentCount - 1, lastLength);
+		this->EmitJoin(points[0], lastDirection, direction, lastLength, length, geometry, closing, start);
+	} else {
+		const auto normal = GetLeftNormal(direction) * this->halfWidth;
+		start[0] = this->AddVertex(points[0] + normal, geometry);
+		start[1] = this->AddVertex(points[0] - normal, geometry);
+		this->EmitCap(points[0], -direction, start[0], start[1], geometry);
+	}
+
+	for (std::size_t i = 0; i < segmentCount; i++) {
+		uint32_t end[2] = { 0, 0 }, next[2] = { 0, 0 };
+		const auto endPoint = points[(i + 1) % points.size()];
+		float nextLength = 0.0f;
+		glm::vec2 nextDirection = direction;
+		if (i + 1 == segmentCount) {
+			if (isClosed) {
+				end[0] = closing[0];
+				end[1] = closing[1];
+			} else {
+				const auto normal = GetLeftNormal(direction) * this->halfWidth;
+				end[0] = this->AddVertex(endPoint + normal, geometry);
+				end[1] = this->AddVertex(endPoint - normal, geometry);
+				this->EmitCap(endPoint, direction, end[0], end[1], geometry);
+			}
+		} else {
+			nextDirection = getDirection(i + 1, nextLength);
+			this->EmitJoin(endPoint, direction, nextDirection, length, nextLength, geometry, end, next);
+		}
+
+		this->AddTriangle(start[0], start[1], end[1], geometry);
+		this->AddTriangle(start[0], end[1], end[0], geometry);
+
+		start[0] = next[0];
+		start[1] = next[1];
+		direction = nextDirection;
+		length = nextLength;
+	}
+}
+
+void Stroker::EmitJoin(const glm::vec2 &point, const glm::vec2 &directionIn, const glm::vec2 &directionOut, const float lengthIn, const float lengthOut,
+	Geometry &geometry, uint32_t (&in)[2], uint32_t (&out)[2])
+{
+	const auto normalIn = GetLeftNormal(directionIn);
+	const auto normalOut = GetLeftNormal(directionOut);
+	const auto turn = Cross(directionIn, directionOut);
+	if (std::abs(turn) <= straightEpsilon && glm::dot(directionIn, directionOut) > 0.0f) {
+		in[0] = out[0] = this->AddVertex(point + normalIn * this->halfWidth, geometry);
+		in[1] = out[1] = this->AddVertex(point - normalIn * this->halfWidth, geometry);
+		return;
+	}
+
+	// The outer side is away from the turn, index 0 is left and 1 is right
+	const auto outerSide = turn > 0.0f ? 1 : 0;
+	const auto sign = turn > 0.0f ? -1.0f : 1.0f;
+	const auto outerIn = this->AddVertex(point + normalIn * (sign * this->halfWidth), geometry);
+	const auto outerOut = this->AddVertex(point + normalOut * (sign * this->halfWidth), geometry);
+
+	// Bisector of the normals, the miter on the outer side and the intersection of the offset lines on the inner one
+	const auto sum = normalIn + normalOut;
+	const auto sumLength = glm::length(sum);
+	const auto bisector = sumLength > straightEpsilon ? sum / sumLength : glm::vec2(0.0f);
+	const auto cosine = glm::dot(bisector, normalIn);
+	const auto tangent = cosine > straightEpsilon ? std::sqrt(std::max(0.0f, 1.0f - cosine * cosine)) / cosine : std::numeric_limits<float>::max();
+
+	// The inner corner is shared by both segments unless it goes past half of either of them,
+	// then they overlap around the point and the join is fanned from the point itself
+	uint32_t pivot;
+	if (this->halfWidth * tangent <= std::min(lengthIn, lengthOut) * 0.5f) {
+		pivot = this->AddVertex(point - bisector * (sign * this->halfWidth / cosine), geometry);
+		in[1 - outerSide] = out[1 - outerSide] = pivot;
+	} else {
+		pivot = this->AddVertex(point, geometry);
+		in[1 - outerSide] = this->AddVertex(point - normalIn * (sign * this->halfWidth), geometry);
+		out[1 - outerSide] = this->AddVertex(point - normalOut * (sign * this->halfWidth), geometry);
+	}
+	in[outerSide] = outerIn;
+	out[outerSide] = outerOut;
+
+	switch (this->options.join) {
+	case Join::Miter:
+		if (cosine > straightEpsilon && 1.0f / cosine <= this->options.miterLimit) {
+			const auto miter = this->AddVertex(point + bisector * (sign * this->halfWidth / cosine), geometry);
+			this->AddTriangle(pivot, outerIn, miter, geometry);
+			this->AddTriangle(pivot, miter, outerOut, geometry);
+			break;
+		}
+		[[fallthrough]];
+	case Join::Bevel:
+		this->AddTriangle(pivot, outerIn, outerOut, geometry);
+		break;
+	case Join::Round: {
+		const auto from = normalIn * (sign * this->halfWidth);
+		const auto to = normalOut * (sign * this->halfWidth);
+		this->EmitArc(point, pivot, outerIn, from, std::atan2(Cross(from, to), glm::dot(from, to)), outerOut, geometry);
+		break;
+	}
+	}
+}
+
+void Stroker::EmitCap(const glm::vec2 &point, const glm::vec2 &direction, const uint32_t left, const uint32_t right, Geometry &geometry)
+{
+	switch (this->options.cap) {
+	case Cap::Butt:
+		break;
+	case Cap::Square: {
+		// Copied, adding vertices moves them
+		const auto extension = direction * this->halfWidth;
+		const auto leftOuterPosition = glm::vec2(geometry.vertices[left].position) + extension;
+		const auto rightOuterPosition = glm::vec2(geometry.vertices[right].position) + extension;
+		const auto leftOuter = this->AddVertex(leftOuterPosition, geometry);
+		const auto rightOuter = this->AddVertex(rightOuterPosition, geometry);
+		this->AddTriangle(left, right, rightOuter, geometry);
+		this->AddTriangle(left, rightOuter, leftOuter, geometry);
+		break;
+	}
+	case Cap::Round: {
+		// Half turn from the left side through the direction to the right side
+		const auto from = glm::vec2(geometry.vertices[left].position) - point;
+		const auto angle = Cross(from, direction) > 0.0f ? std::numbers::pi_v<float> : -std::numbers::pi_v<float>;
+		this->EmitArc(point, this->AddVertex(point, geometry), left, from, angle, right, geometry);
+		break;
+	}
+	}
+}
+
+void Stroker::EmitArc(const glm::vec2 &center, const uint32_t pivot, const uint32_t from, const glm::vec2 &fromOffset, const float angle, const uint32_t to, Geometry &geometry)
+{
+	const auto count = std::clamp(static_cast<uint32_t>(std::ceil(std::abs(angle) / this->maxArcStep)), 1u, maxArcSegmentCount);
+	// Rotated step by step instead of calling sin/cos per point
+	const auto step = angle / static_cast<float>(count);
+	const auto cosine = std::cos(step), sine = std::sin(step);
+	auto offset = fromOffset;
+	auto previous = from;
+	for (uint32_t i = 1; i < count; i++) {
+		offset = { offset.x * cosine - offset.y * sine, offset.x * sine + offset.y * cosine };
+		const auto current = this->AddVertex(center + offset, geometry);
+		this->AddTriangle(pivot, previous, current, geometry);
+		previous = current;
+	}
+	this->AddTriangle(pivot, previous, to, geometry);
+}
+
+uint32_t Stroker::AddVertex(const glm::vec2 &position, Geometry &geometry) const
+{
+	const auto index = static_cast<uint32_t>(geometry.vertices.size());
+	geometry.vertices.push_back(Vertex{
+		.position = { position.x, position.y, CurveSign::Solid },
+		.color = this->options.color,
+		.uv = { 0.0f, 0.0f }
+	});
+	return index;
+}
+
+void Stroker::AddTriangle(const uint32_t a, const uint32_t b, const uint32_t c, Geometry &geometry) const
+{
+	// Every triangle is turned to the requested winding, degenerate ones are dropped
+	const auto pa = glm::vec2(geometry.vertices[a].position);
+	const auto area = Cross(glm::vec2(geometry.vertices[b].position) - pa, glm::vec2(geometry.vertices[c].position) - pa);
+	if (area == 0.0f)
+		return;
+	const bool flip = (area > 0.0f) != (this->options.winding == Triangulator::Winding::CounterClockwise);
+	geometry.indices.push_back(static_cast<Indices::value_type>(a));
+	geometry.indices.push_back(static_cast<Indices::value_type>(flip ? c : b));
+	geometry.indices.push_back(static_cast<Indices::value_type>(flip ? b : c));
+}
+
+}
@@ -0,0 +1,140 @@
+#include "triangulation/task_pool.hpp"
+#include <algorithm>
+#include <iostream>
+#include <limits>
+
+namespace Triangulation {
+
+TaskPool::TaskPool(const uint32_t threadCount)
+{
+	this->threadCount = threadCount ? threadCount : std::max(1u, std::thread::hardware_concurrency());
+	this->ranges = std::make_unique<Range[]>(this->threadCount);
+	for (uint32_t i = 0; i < this->threadCount; i++)
+		this->ranges[i].bounds.store(0, std::memory_order_relaxed);
+
+	this->threads.reserve(this->threadCount - 1);
+	for (uint32_t i = 1; i < this->threadCount; i++)
+		this->threads.emplace_back(&TaskPool::WorkerLoop, this, i);
+}
+
+TaskPool::~TaskPool()
+{
+	{
+		std::lock_guard lock(this->mutex);
+		this->isStopping = true;
+	}
+	this->startCondition.notify_all();
+	for (auto &thread : this->threads)
+		thread.join();
+}
+
+void TaskPool::ParallelFor(const std::size_t count, const Function &function)
+{
+	if (!count)
+		return;
+	if (count > std::numeric_limits<uint32_t>::max()) {
+		std::cerr << "Triangulation: too many tasks for one ParallelFor call" << std::endl;
+		return;
+	}
+	if (this->threadCount == 1 || count == 1) {
+		for (std::size_t i = 0; i < count; i++)
+			function(i, 0);
+		return;
+	}
+
+	// Even split to start with, stealing evens out the rest
+	const auto itemCount = static_cast<uint32_t>(count);
+	for (uint32_t i = 0; i < this->threadCount; i++) {
+		const auto begin = static_cast<uint32_t>(static_cast<uint64_t>(itemCount) * i / this->threadCount);
+		const auto end = static_cast<uint32_t>(static_cast<uint64_t>(itemCount) * (i + 1) / this->threadCount);
+		this->ranges[i].bounds.store(Pack(begin, end), std::memory_order_relaxed);
+	}
+	{
+		std::lock_guard lock(this->mutex);
+		this->function = &function;
+		this->busyCount = this->threadCount - 1;
+		this->generation++;
+	}
+	this->startCondition.notify_all();
+
+	this->Work(0);
+
+	std::unique_lock lock(this->mutex);
+	this->doneCondition.wait(lock, [this] { return this->busyCount == 0; });
+	this->function = nullptr;
+}
+
+void TaskPool::WorkerLoop(const uint32_t threadIndex)
+{
+	uint64_t lastGeneration = 0;
+	while (true) {
+		{
+			std::unique_lock lock(this->mutex);
+			this->startCondition.wait(lock, [this, lastGeneration] { return this->isStopping || this->generation != lastGeneration; });
+			if (this->isStopping)
+				return;
+			lastGeneration = this->generation;
+		}
+
+		this->Work(threadIndex);
+
+		bool isLast;
+		{
+			std::lock_guard lock(this->mutex);
+			isLast = --this->busyCount == 0;
+		}
+		if (isLast)
+			this->doneCondition.notify_one();
+	}
+}
+
+void TaskPool::Work(const uint32_t threadIndex)
+{
+	// Items are only ever owned by one range or one thread, so once nothing is left to pop
+	// or steal everything this thread could help with is already being worked on
+	uint32_t index;
+	do {
+		while (this->Pop(threadIndex, index))
+			(*this->function)(index, threadIndex);
+	} while (this->Steal(threadIndex));
+}
+
+bool TaskPool::Pop(const uint32_t threadIndex, uint32_t &index)
+{
+	auto &bounds = this->ranges[threadIndex].bounds;
+	auto current = bounds.load(std::memory_order_acquire);
+	while (true) {
+		const auto begin = static_cast<uint32_t>(current);
+		const auto end = static_cast<uint32_t>(current >> 32);
+		if (begin >= end)
+			return false;
+		if (bounds.compare_exchange_weak(current, Pack(begin + 1, end), std::memory_order_acq_rel, std::memory_order_acquire)) {
+			index = begin;
+			return true;
+		}
+	}
+}
+
+bool TaskPool::Steal(const uint32_t threadIndex)
+{
+	for (uint32_t offset = 1; offset < this->threadCount; offset++) {
+		auto &bounds = this->ranges[(threadIndex + offset) % this->threadCount].bounds;
+		auto current = bounds.load(std::memory_order_acquire);
+		while (true) {
+			const auto begin = static_cast<uint32_t>(current);
+			const auto end = static_cast<uint32_t>(current >> 32);
+			if (begin >= end)
+				break;
+			// Back half, rounded up so the last item can be stolen too
+			const auto middle = end - (end - begin + 1) / 2;
+			if (bounds.compare_exchange_weak(current, Pack(begin, middle), std::memory_order_acq_rel, std::memory_order_acquire)) {
+				// Own range is empty here, others only compare-exchange non-empty ranges
+				this->ranges[threadIndex].bounds.store(Pack(middle, end), std::memory_order_release);
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+}
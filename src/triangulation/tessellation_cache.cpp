@@ -0,0 +1,224 @@
+#include "triangulation/tessellation_cache.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+namespace Triangulation {
+
+namespace {
+	// FNV-1a, 64-bit
+	constexpr uint64_t hashOffset = 14695981039346656037ull;
+	constexpr uint64_t hashPrime = 1099511628211ull;
+
+	void HashBytes(uint64_t &hash, const void *data, const std::size_t size)
+	{
+		const auto bytes = static_cast<const uint8_t*>(data);
+		for (std::size_t i = 0; i < size; i++) {
+			hash ^= bytes[i];
+			hash *= hashPrime;
+		}
+	}
+	template <typename T>
+	void HashValue(uint64_t &hash, const T &value)
+	{
+		HashBytes(hash, &value, sizeof(T));
+	}
+
+	constexpr int32_t invalidBucket = std::numeric_limits<int32_t>::min();
+
+	// The fringe is triangulated in outline space (fringeWidth / scale), quantized finer than the tolerance,
+	// a few percent of a pixel wide fringe isn't visible
+	constexpr int32_t fringeBucketsPerOctave = 16;
+	int32_t GetFringeBucket(const Triangulator::Options &options)
+	{
+		const auto scale = Flattener::GetTransformScale(options.transform);
+		if (!(options.fringeWidth > 0.0f) || !(scale > 0.0f) || !std::isfinite(options.fringeWidth / scale))
+			return invalidBucket;
+		return static_cast<int32_t>(std::round(std::log2(options.fringeWidth / scale) * fringeBucketsPerOctave));
+	}
+	float GetBucketFringeWidth(const int32_t fringeBucket, const Triangulator::Options &options)
+	{
+		if (fringeBucket == invalidBucket)
+			return options.fringeWidth;
+		return std::exp2(static_cast<float>(fringeBucket) / fringeBucketsPerOctave) * Flattener::GetTransformScale(options.transform);
+	}
+}
+
+std::size_t TessellationCache::KeyHash::operator()(const Key &key) const
+{
+	return static_cast<std::size_t>(key.outlineHash ^ (key.optionsHash * hashPrime) ^ (static_cast<uint64_t>(static_cast<uint32_t>(key.toleranceBucket)) << 17));
+}
+
+uint64_t TessellationCache::Hash(const Outline &outline)
+{
+	uint64_t hash = hashOffset;
+	for (const auto &contour : outline.GetContours()) {
+		const auto &commands = contour.GetCommands();
+		const auto &points = contour.GetPoints();
+		HashValue(hash, commands.size());
+		HashBytes(hash, commands.data(), commands.size() * sizeof(Contour::Command));
+		// Bit patterns, so -0.0 and 0.0 differ, which only costs a miss
+		for (const auto &point : points) {
+			HashValue(hash, std::bit_cast<uint32_t>(point.x));
+			HashValue(hash, std::bit_cast<uint32_t>(point.y));
+		}
+	}
+	return hash;
+}
+
+int32_t TessellationCache::GetToleranceBucket(const Triangulator::Options &options)
+{
+	const auto scale = Flattener::GetTransformScale(options.transform);
+	if (!(options.tolerance > 0.0f) || !(scale > 0.0f) || !std::isfinite(options.tolerance / scale))
+		return invalidBucket;
+	return static_cast<int32_t>(std::floor(std::log2(options.tolerance / scale) * bucketsPerOctave));
+}
+
+float TessellationCache::GetBucketTolerance(const int32_t toleranceBucket, const Triangulator::Options &options)
+{
+	if (toleranceBucket == invalidBucket)
+		return options.tolerance;
+	// Lower edge of the bucket, at most the requested tolerance
+	return std::exp2(static_cast<float>(toleranceBucket) / bucketsPerOctave) * Flattener::GetTransformScale(options.transform);
+}
+
+TessellationCache::Key TessellationCache::MakeKey(const Outline &outline, const Triangulator::Options &options)
+{
+	// Everything but the tolerance, the fringe width and the transform changes the output as is
+	uint64_t optionsHash = hashOffset;
+	HashValue(optionsHash, options.mode);
+	HashValue(optionsHash, options.maxCurveSubdivisions);
+	HashValue(optionsHash, options.winding);
+	HashValue(optionsHash, options.fillRule);
+	HashValue(optionsHash, GetFringeBucket(options));
+	for (int i = 0; i < 4; i++)
+		HashValue(optionsHash, std::bit_cast<uint32_t>(options.color[i]));
+
+	return Key{
+		.outlineHash = Hash(outline),
+		.optionsHash = optionsHash,
+		.toleranceBucket = GetToleranceBucket(options)
+	};
+}
+
+TessellationCache::GeometryPtr TessellationCache::Triangulate(const Outline &outline, const Triangulator::Options &options)
+{
+	const auto key = MakeKey(outline, options);
+	if (auto geometry = this->Find(key, outline))
+		return geometry;
+
+	// Outside of the lock, other threads keep reading meanwhile
+	auto bucketOptions = options;
+	bucketOptions.tolerance = GetBucketTolerance(key.toleranceBucket, options);
+	bucketOptions.fringeWidth = GetBucketFringeWidth(GetFringeBucket(options), options);
+	Triangulator triangulator(bucketOptions);
+	Geometry geometry;
+	if (!triangulator.Triangulate(outline, geometry))
+		return nullptr;
+	return this->Insert(key, outline, std::move(geometry));
+}
+
+TessellationCache::GeometryPtr TessellationCache::Find(const Key &key, const Outline &outline)
+{
+	std::shared_lock lock(this->mutex);
+	const auto it = this->entries.find(key);
+	// Another outline with the same hash is a miss too
+	if (it == this->entries.end() || it->second.outline != outline) {
+		this->missCount.fetch_add(1, std::memory_order_relaxed);
+		return nullptr;
+	}
+	this->hitCount.fetch_add(1, std::memory_order_relaxed);
+	it->second.lastUse.store(this->useClock.fetch_add(1, std::memory_order_relaxed), std::memory_order_relaxed);
+	return it->second.geometry;
+}
+
+TessellationCache::GeometryPtr TessellationCache::Insert(const Key &key, const Outline &outline, Geometry &&geometry)
+{
+	std::unique_lock lock(this->mutex);
+	auto [it, isInserted] = this->entries.try_emplace(key);
+	auto &entry = it->second;
+	if (!isInserted) {
+		// Hash collision, the entry stays and this geometry isn't cached
+		if (entry.outline != outline)
+			return std::make_shared<const Geometry>(std::move(geometry));
+		entry.lastUse.store(this->useClock.fetch_add(1, std::memory_order_relaxed), std::memory_order_relaxed);
+		return entry.geometry;
+	}
+
+	entry.lastUse.store(this->useClock.fetch_add(1, std::memory_order_relaxed), std::memory_order_relaxed);
+	entry.outline = outline;
+	entry.size = GetMemorySize(geometry) + GetMemorySize(outline);
+	entry.geometry = std::make_shared<const Geometry>(std::move(geometry));
+	this->memorySize += entry.size;
+	// The caller gets the geometry even if it's bigger than the whole budget
+	auto result = entry.geometry;
+	this->Evict();
+	return result;
+}
+
+void TessellationCache::Clear()
+{
+	std::unique_lock lock(this->mutex);
+	this->entries.clear();
+	this->memorySize = 0;
+}
+
+void TessellationCache::SetMemoryBudget(const std::size_t memoryBudget)
+{
+	std::unique_lock lock(this->mutex);
+	this->memoryBudget = memoryBudget;
+	this->Evict();
+}
+
+TessellationCache::Statistics TessellationCache::GetStatistics() const
+{
+	std::shared_lock lock(this->mutex);
+	return Statistics{
+		.hitCount = this->hitCount.load(std::memory_order_relaxed),
+		.missCount = this->missCount.load(std::memory_order_relaxed),
+		.evictionCount = this->evictionCount,
+		.entryCount = this->entries.size(),
+		.memorySize = this->memorySize,
+		.memoryBudget = this->memoryBudget
+	};
+}
+
+std::size_t TessellationCache::GetMemorySize(const Geometry &geometry)
+{
+	return sizeof(Geometry) + sizeof(Vertex) * geometry.vertices.capacity() + sizeof(Indices::value_type) * geometry.indices.capacity();
+}
+
+std::size_t TessellationCache::GetMemorySize(const Outline &outline)
+{
+	auto size = sizeof(Outline) + sizeof(Contour) * outline.GetContours().capacity();
+	for (const auto &contour : outline.GetContours())
+		size += sizeof(Contour::Command) * contour.GetCommands().capacity() + sizeof(glm::vec2) * contour.GetPoints().capacity();
+	return size;
+}
+
+void TessellationCache::Evict()
+{
+	if (this->memorySize <= this->memoryBudget)
+		return;
+
+	// Sorting on every insert would be wasteful, go an eighth under the budget so the next inserts don't evict again
+	const auto targetSize = this->memoryBudget - this->memoryBudget / 8;
+	std::vector<std::pair<uint64_t, decltype(this->entries)::iterator>> candidates;
+	candidates.reserve(this->entries.size());
+	for (auto it = this->entries.begin(); it != this->entries.end(); ++it)
+		candidates.emplace_back(it->second.lastUse.load(std::memory_order_relaxed), it);
+	std::sort(candidates.begin(), candidates.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+
+	for (const auto &[lastUse, it] : candidates) {
+		if (this->memorySize <= targetSize)
+			break;
+		this->memorySize -= it->second.size;
+		this->entries.erase(it);
+		this->evictionCount++;
+	}
+}
+
+}
@@ -0,0 +1,561 @@
+#include "triangulation/triangulator.hpp"
+#include "polygon.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+namespace Triangulation {
+
+namespace {
+	float Cross(const glm::vec2 &a, const glm::vec2 &b)
+	{
+		return a.x * b.y - a.y * b.x;
+	}
+
+	// Control point (almost) on the chord, the curve is a line
+	bool IsFlat(const QuadraticBezier &curve)
+	{
+		const auto chord = curve[2] - curve[0];
+		return std::abs(Cross(chord, curve[1] - curve[0])) <= 1e-6f * glm::dot(chord, chord);
+	}
+
+	// Convex hull of a segment: triangle for curves, two points for lines
+	struct Hull {
+		std::array<glm::vec2, 3> points;
+		uint32_t count;
+	};
+	Hull GetHull(const QuadraticBezier &points, const bool isCurve)
+	{
+		if (isCurve)
+			return Hull{ .points = points, .count = 3 };
+		return Hull{ .points = { points[0], points[2], points[2] }, .count = 2 };
+	}
+	// Separating axis test, touching hulls (shared end points, collinear edges) don't overlap
+	bool Overlaps(const Hull &a, const Hull &b, const float epsilon)
+	{
+		for (const auto hull : { &a, &b }) {
+			const uint32_t edgeCount = hull->count == 2 ? 1 : hull->count;
+			for (uint32_t i = 0; i < edgeCount; i++) {
+				const auto edge = hull->points[(i + 1) % hull->count] - hull->points[i];
+				const auto edgeLength = glm::length(edge);
+				if (edgeLength <= 0.0f)
+					continue;
+				const auto axis = glm::vec2(-edge.y, edge.x) / edgeLength;
+
+				auto minA = std::numeric_limits<float>::max(), maxA = std::numeric_limits<float>::lowest();
+				for (uint32_t j = 0; j < a.count; j++) {
+					const auto projection = glm::dot(axis, a.points[j]);
+					minA = std::min(minA, projection);
+					maxA = std::max(maxA, projection);
+				}
+				auto minB = std::numeric_limits<float>::max(), maxB = std::numeric_limits<float>::lowest();
+				for (uint32_t j = 0; j < b.count; j++) {
+					const auto projection = glm::dot(axis, b.points[j]);
+					minB = std::min(minB, projection);
+					maxB = std::max(maxB, projection);
+				}
+				if (maxA <= minB + epsilon || maxB <= minA + epsilon)
+					return false;
+			}
+		}
+		return true;
+	}
+
+	// Distance under which points of the outline are merged, relative to its extent
+	float GetSnapEpsilon(const Outline &outline)
+	{
+		glm::vec2 boundsMin = glm::vec2(std::numeric_limits<float>::max());
+		glm::vec2 boundsMax = glm::vec2(std::numeric_limits<float>::lowest());
+		for (const auto &contour : outline.GetContours()) {
+			for (const auto &point : contour.GetPoints()) {
+				boundsMin = glm::min(boundsMin, point);
+				boundsMax = glm::max(boundsMax, point);
+			}
+		}
+		if (boundsMin.x > boundsMax.x)
+			return 0.0f;
+		return std::max(boundsMax.x - boundsMin.x, boundsMax.y - boundsMin.y) * snapTolerance;
+	}
+	bool IsNear(const glm::vec2 &a, const glm::vec2 &b, const float epsilon)
+	{
+		const auto delta = a - b;
+		return glm::dot(delta, delta) <= epsilon * epsilon;
+	}
+
+	// Miters longer than this many half widths are cut, so sharp spikes don't grow long fringes
+	constexpr float fringeMiterLimit = 4.0f;
+
+	// Per point offset from the edge to the outer side of the fringe (Flatten mode insets the interior by the same offset).
+	// Rings enclosing nothing or with fill on both sides get no offset, they get no fringes.
+	// isFringed tells per point whether the edge to the next point has a fringe, empty for all of them
+	void ComputeFringeOffsets(const std::vector<glm::vec2> &points, const std::vector<Ring> &rings, const std::vector<RingNesting> &nesting, const std::vector<bool> &isFringed,
+		const float halfWidth, std::vector<glm::vec2> &offsets)
+	{
+		offsets.assign(points.size(), glm::vec2(0.0f));
+		const auto getNormal = [](const glm::vec2 &from, const glm::vec2 &to, const bool fillOnLeft) {
+			const auto edge = to - from;
+			const auto length = glm::length(edge);
+			if (length <= 0.0f)
+				return glm::vec2(0.0f);
+			const auto right = glm::vec2(edge.y, -edge.x) / length;
+			return fillOnLeft ? right : -right;
+		};
+		for (std::size_t i = 0; i < rings.size(); i++) {
+			const auto &ring = rings[i];
+			if (!nesting[i].isBoundary || ring.size() < 3)
+				continue;
+			const bool fillOnLeft = (GetSignedArea(points, ring) > 0.0f) == nesting[i].isFilled;
+			for (std::size_t j = 0; j < ring.size(); j++) {
+				const auto previousIndex = ring[(j + ring.size() - 1) % ring.size()];
+				const auto &previous = points[previousIndex];
+				const auto &current = points[ring[j]];
+				const auto &next = points[ring[(j + 1) % ring.size()]];
+				// An edge without fringe doesn't bend the offset, the fringe ends square to its own edge there
+				auto normalIn = isFringed.empty() || isFringed[previousIndex] ? getNormal(previous, current, fillOnLeft) : glm::vec2(0.0f);
+				auto normalOut = isFringed.empty() || isFringed[ring[j]] ? getNormal(current, next, fillOnLeft) : glm::vec2(0.0f);
+				if (normalIn == glm::vec2(0.0f))
+					normalIn = normalOut;
+				if (normalOut == glm::vec2(0.0f))
+					normalOut = normalIn;
+
+				// Miter keeps the fringe halfWidth away from both edges
+				const auto sum = normalIn + normalOut;
+				const auto sumLength = glm::length(sum);
+				if (sumLength <= 0.0f) {
+					// Edge doubles back on itself
+					offsets[ring[j]] = normalIn * halfWidth;
+					continue;
+				}
+				const auto miter = sum / sumLength;
+				const auto cosine = glm::dot(miter, normalIn);
+				offsets[ring[j]] = miter * (halfWidth * std::min(1.0f / std::max(cosine, 1e-6f), fringeMiterLimit));
+			}
+		}
+	}
+}
+
+bool Triangulator::Triangulate(const Outline &outline, Geometry &geometry)
+{
+	this->flattener = Flattener(this->options.transform, this->options.tolerance);
+	this->snapEpsilon = GetSnapEpsilon(outline);
+	switch (this->options.mode) {
+	case Mode::Curves:
+		return this->TriangulateCurves(outline, geometry);
+	default:
+	case Mode::Flatten:
+		return this->TriangulateFlattened(outline, geometry);
+	}
+}
+
+bool Triangulator::TriangulateFlattened(const Outline &outline, Geometry &geometry)
+{
+	this->points.clear();
+	this->rings.clear();
+	this->triangles.clear();
+
+	for (const auto &contour : outline.GetContours()) {
+		if (!contour.IsEmpty())
+			this->Flatten(contour);
+	}
+	if (this->options.fringeWidth <= 0.0f) {
+		if (!TriangulatePolygon(this->points, this->rings, this->options.fillRule, this->triangles))
+			return false;
+		return this->EmitInterior(geometry, 0);
+	}
+
+	std::vector<RingNesting> nesting;
+	if (!GetRingNesting(this->points, this->rings, this->options.fillRule, nesting))
+		return false;
+	if (!TriangulatePolygon(this->points, this->rings, nesting, this->triangles))
+		return false;
+	// Interior shrinks by half of the fringe, so the two don't overlap
+	const auto halfWidth = this->options.fringeWidth * 0.5f / this->flattener.GetScale();
+	this->isFringed.clear();
+	ComputeFringeOffsets(this->points, this->rings, nesting, this->isFringed, halfWidth, this->fringeOffsets);
+	for (std::size_t i = 0; i < this->points.size(); i++) {
+		this->points[i] -= this->fringeOffsets[i];
+		this->fringeOffsets[i] *= 2.0f;
+	}
+	if (!this->EmitInterior(geometry, this->points.size() * 2))
+		return false;
+	this->EmitFringes(geometry, nesting, -halfWidth, halfWidth);
+
+	return true;
+}
+
+bool Triangulator::TriangulateCurves(const Outline &outline, Geometry &geometry)
+{
+	this->segments.clear();
+	uint32_t contourCount = 0;
+	for (const auto &contour : outline.GetContours()) {
+		if (!contour.IsEmpty())
+			this->CollectSegments(contour, contourCount++);
+	}
+
+	this->ResolveCurveOverlaps();
+	if (!this->ClassifyCurves(contourCount))
+		return false;
+
+	// Interior polygon goes through the end points, and through the control points of concave curves
+	// (the edge from a point is straight if it is a line segment, only those get fringes)
+	this->points.clear();
+	this->rings.clear();
+	this->triangles.clear();
+	this->isFringed.clear();
+	std::size_t curveCount = 0;
+	for (std::size_t i = 0; i < this->segments.size(); i++) {
+		const auto &segment = this->segments[i];
+		if (i == 0 || this->segments[i - 1].contour != segment.contour)
+			this->rings.emplace_back();
+		auto &ring = this->rings.back();
+		ring.push_back(static_cast<uint32_t>(this->points.size()));
+		this->points.push_back(segment.points[0]);
+		this->isFringed.push_back(!segment.isCurve);
+		if (segment.isCurve) {
+			curveCount++;
+			if (segment.isConcave) {
+				ring.push_back(static_cast<uint32_t>(this->points.size()));
+				this->points.push_back(segment.points[1]);
+				this->isFringed.push_back(false);
+			}
+		}
+	}
+	std::vector<RingNesting> nesting;
+	if (!GetRingNesting(this->points, this->rings, this->options.fillRule, nesting))
+		return false;
+	if (!TriangulatePolygon(this->points, this->rings, nesting, this->triangles))
+		return false;
+	const bool hasFringes = this->options.fringeWidth > 0.0f;
+	if (!this->EmitInterior(geometry, curveCount * 3 + (hasFringes ? this->points.size() * 2 : 0)))
+		return false;
+	if (hasFringes) {
+		// Curve triangles share the points of the interior, so it stays where it is and the fringes only get their outer half
+		const auto halfWidth = this->options.fringeWidth * 0.5f / this->flattener.GetScale();
+		ComputeFringeOffsets(this->points, this->rings, nesting, this->isFringed, halfWidth, this->fringeOffsets);
+		this->EmitFringes(geometry, nesting, 0.0f, halfWidth);
+	}
+
+	// Curve triangles
+	const bool counterClockwise = this->options.winding == Winding::CounterClockwise;
+	constexpr std::array<glm::vec2, 3> curveUVs = { glm::vec2{ 0.0f, 0.0f }, glm::vec2{ 0.5f, 0.0f }, glm::vec2{ 1.0f, 1.0f } };
+	for (const auto &segment : this->segments) {
+		if (!segment.isCurve)
+			continue;
+		const auto baseVertex = static_cast<Indices::value_type>(geometry.vertices.size());
+		const auto sign = segment.isConcave ? CurveSign::Concave : CurveSign::Convex;
+		for (std::size_t i = 0; i < 3; i++) {
+			geometry.vertices.push_back(Vertex{
+				.position = { segment.points[i].x, segment.points[i].y, sign },
+				.color = this->options.color,
+				.uv = curveUVs[i]
+			});
+		}
+		const bool isCounterClockwise = Cross(segment.points[1] - segment.points[0], segment.points[2] - segment.points[0]) > 0.0f;
+		geometry.indices.push_back(baseVertex);
+		geometry.indices.push_back(baseVertex + (isCounterClockwise == counterClockwise ? 1 : 2));
+		geometry.indices.push_back(baseVertex + (isCounterClockwise == counterClockwise ? 2 : 1));
+	}
+
+	return true;
+}
+
+bool Triangulator::EmitInterior(Geometry &geometry, const std::size_t extraVertexCount)
+{
+	const auto baseVertex = geometry.vertices.size();
+	if (baseVertex + this->points.size() + extraVertexCount > std::numeric_limits<Indices::value_type>::max() + std::size_t(1)) {
+		std::cerr << "Triangulation: Outline has too many vertices for 16-bit indices" << std::endl;
+		return false;
+	}
+
+	geometry.vertices.reserve(baseVertex + this->points.size() + extraVertexCount);
+	for (const auto &point : this->points) {
+		geometry.vertices.push_back(Vertex{
+			.position = { point.x, point.y, CurveSign::Solid },
+			.color = this->options.color,
+			.uv = { 0.0f, 0.0f }
+		});
+	}
+	geometry.indices.reserve(geometry.indices.size() + this->triangles.size() + extraVertexCount);
+	const bool flip = this->options.winding == Winding::Clockwise;
+	for (std::size_t i = 0; i + 2 < this->triangles.size(); i += 3) {
+		geometry.indices.push_back(static_cast<Indices::value_type>(baseVertex + this->triangles[i + 0]));
+		geometry.indices.push_back(static_cast<Indices::value_type>(baseVertex + this->triangles[i + (flip ? 2 : 1)]));
+		geometry.indices.push_back(static_cast<Indices::value_type>(baseVertex + this->triangles[i + (flip ? 1 : 2)]));
+	}
+
+	return true;
+}
+
+void Triangulator::EmitFringes(Geometry &geometry, const std::vector<RingNesting> &nesting, const float innerDistance, const float outerDistance)
+{
+	// Inner vertex per point where the interior ends, outer vertex at its fringe offset
+	const auto baseVertex = geometry.vertices.size();
+	for (std::size_t i = 0; i < this->points.size(); i++) {
+		geometry.vertices.push_back(Vertex{
+			.position = { this->points[i].x, this->points[i].y, CurveSign::Fringe },
+			.color = this->options.color,
+			.uv = { innerDistance, 0.0f }
+		});
+		const auto outer = this->points[i] + this->fringeOffsets[i];
+		geometry.vertices.push_back(Vertex{
+			.position = { outer.x, outer.y, CurveSign::Fringe },
+			.color = this->options.color,
+			.uv = { outerDistance, 0.0f }
+		});
+	}
+
+	// Two triangles per edge
+	const bool counterClockwise = this->options.winding == Winding::CounterClockwise;
+	const auto emitTriangle = [&](const uint32_t a, const uint32_t b, const uint32_t c) {
+		const auto &pa = geometry.vertices[baseVertex + a].position;
+		const auto &pb = geometry.vertices[baseVertex + b].position;
+		const auto &pc = geometry.vertices[baseVertex + c].position;
+		const bool isCounterClockwise = Cross(glm::vec2(pb) - glm::vec2(pa), glm::vec2(pc) - glm::vec2(pa)) > 0.0f;
+		geometry.indices.push_back(static_cast<Indices::value_type>(baseVertex + a));
+		geometry.indices.push_back(static_cast<Indices::value_type>(baseVertex + (isCounterClockwise == counterClockwise ? b : c)));
+		geometry.indices.push_back(static_cast<Indices::value_type>(baseVertex + (isCounterClockwise == counterClockwise ? c : b)));
+	};
+	geometry.indices.reserve(geometry.indices.size() + this->points.size() * 6);
+	for (std::size_t i = 0; i < this->rings.size(); i++) {
+		const auto &ring = this->rings[i];
+		if (!nesting[i].isBoundary || ring.size() < 3)
+			continue;
+		for (std::size_t j = 0; j < ring.size(); j++) {
+			if (!this->isFringed.empty() && !this->isFringed[ring[j]])
+				continue;
+			const auto current = ring[j] * 2, next = ring[(j + 1) % ring.size()] * 2;
+			emitTriangle(current, current + 1, next + 1);
+			emitTriangle(current, next + 1, next);
+		}
+	}
+}
+
+void Triangulator::Flatten(const Contour &contour)
+{
+	auto &ring = this->rings.emplace_back();
+	const auto addPoint = [this, &ring](const glm::vec2 &point) {
+		if (!ring.empty() && IsNear(this->points[ring.back()], point, this->snapEpsilon))
+			return;
+		ring.push_back(static_cast<uint32_t>(this->points.size()));
+		this->points.push_back(point);
+	};
+	// Evaluated with the batch kernels into the x/y scratch buffers, then appended
+	const auto addCurve = [this, &ring](const auto &curve) {
+		const auto count = this->flattener.GetSegmentCount(curve);
+		this->curveX.resize(count);
+		this->curveY.resize(count);
+		this->flattener.Flatten(curve, std::span(this->curveX), std::span(this->curveY));
+		for (std::size_t i = 0; i < count; i++) {
+			ring.push_back(static_cast<uint32_t>(this->points.size()));
+			this->points.emplace_back(this->curveX[i], this->curveY[i]);
+		}
+	};
+
+	const auto &contourPoints = contour.GetPoints();
+	std::size_t pointIndex = 0;
+	glm::vec2 current = { 0.0f, 0.0f };
+	for (const auto command : contour.GetCommands()) {
+		switch (command) {
+		case Contour::Command::Move:
+		case Contour::Command::Line:
+			current = contourPoints[pointIndex];
+			addPoint(current);
+			break;
+		case Contour::Command::Quad: {
+			const QuadraticBezier curve = { current, contourPoints[pointIndex], contourPoints[pointIndex + 1] };
+			addCurve(curve);
+			current = curve[2];
+			break;
+		}
+		case Contour::Command::Cubic: {
+			const CubicBezier curve = { current, contourPoints[pointIndex], contourPoints[pointIndex + 1], contourPoints[pointIndex + 2] };
+			addCurve(curve);
+			current = curve[3];
+			break;
+		}
+		}
+		pointIndex += Contour::GetPointCount(command);
+	}
+
+	// Closing point duplicates the start, up to rounding
+	if (ring.size() > 1 && IsNear(this->points[ring.back()], this->points[ring.front()], this->snapEpsilon)) {
+		ring.pop_back();
+		this->points.pop_back();
+	}
+}
+
+void Triangulator::CollectSegments(const Contour &contour, const uint32_t contourIndex)
+{
+	const auto firstSegment = this->segments.size();
+	const auto addSegment = [this, contourIndex](const QuadraticBezier &points, const bool isCurve) {
+		if (IsNear(points[0], points[2], this->snapEpsilon) && (!isCurve || IsNear(points[0], points[1], this->snapEpsilon)))
+			return;
+		const auto curve = isCurve && !IsFlat(points);
+		this->segments.push_back(Segment{
+			.points = curve ? points : QuadraticBezier{ points[0], (points[0] + points[2]) * 0.5f, points[2] },
+			.contour = contourIndex,
+			.isCurve = curve,
+			.isConcave = false
+		});
+	};
+
+	const auto &contourPoints = contour.GetPoints();
+	const auto start = contourPoints.front();
+	std::size_t pointIndex = 0;
+	glm::vec2 current = start;
+	for (const auto command : contour.GetCommands()) {
+		switch (command) {
+		case Contour::Command::Move:
+			break;
+		case Contour::Command::Line:
+			addSegment({ current, current, contourPoints[pointIndex] }, false);
+			current = contourPoints[pointIndex];
+			break;
+		case Contour::Command::Quad:
+			addSegment({ current, contourPoints[pointIndex], contourPoints[pointIndex + 1] }, true);
+			current = contourPoints[pointIndex + 1];
+			break;
+		case Contour::Command::Cubic: {
+			// Cubics become quadratics within tolerance, so they still get curve triangles
+			const CubicBezier curve = { current, contourPoints[pointIndex], contourPoints[pointIndex + 1], contourPoints[pointIndex + 2] };
+			this->quadratics.clear();
+			ApproximateCubic(curve, this->flattener.GetTolerance() / this->flattener.GetScale(), this->quadratics);
+			for (const auto &quadratic : this->quadratics)
+				addSegment(quadratic, true);
+			current = curve[3];
+			break;
+		}
+		}
+		pointIndex += Contour::GetPointCount(command);
+	}
+	// Implicit closing line, or if the contour already ends (up to rounding) at its start, snap it there
+	if (this->segments.size() > firstSegment && IsNear(current, start, this->snapEpsilon)) {
+		auto &last = this->segments.back();
+		last.points[2] = start;
+		if (!last.isCurve)
+			last.points[1] = (last.points[0] + start) * 0.5f;
+	}
+	else {
+		addSegment({ current, current, start }, false);
+	}
+
+	// Contours of less than two segments enclose nothing
+	if (this->segments.size() - firstSegment < 2)
+		this->segments.resize(firstSegment);
+}
+
+void Triangulator::ResolveCurveOverlaps()
+{
+	// Overlapping curve triangles would fill each other's gaps, halve them until they are apart
+	glm::vec2 boundsMin = glm::vec2(std::numeric_limits<float>::max());
+	glm::vec2 boundsMax = glm::vec2(std::numeric_limits<float>::lowest());
+	for (const auto &segment : this->segments) {
+		for (const auto &point : segment.points) {
+			boundsMin = glm::min(boundsMin, point);
+			boundsMax = glm::max(boundsMax, point);
+		}
+	}
+	const auto epsilon = std::max(boundsMax.x - boundsMin.x, boundsMax.y - boundsMin.y) * 1e-6f;
+
+	// Sweep over the hulls sorted by their left side, only pairs whose bounds overlap get the separating axis test.
+	// Disjoint bounds mean disjoint hulls, so this finds the same overlaps as testing every pair
+	std::vector<Hull> hulls;
+	std::vector<std::array<glm::vec2, 2>> hullBounds;
+	std::vector<uint32_t> order;
+	std::vector<bool> overlapping;
+	for (uint32_t level = 0; level < this->options.maxCurveSubdivisions; level++) {
+		hulls.clear();
+		hullBounds.clear();
+		for (const auto &segment : this->segments) {
+			const auto &hull = hulls.emplace_back(GetHull(segment.points, segment.isCurve));
+			auto &bounds = hullBounds.emplace_back(std::array{ hull.points[0], hull.points[0] });
+			for (uint32_t i = 1; i < hull.count; i++) {
+				bounds[0] = glm::min(bounds[0], hull.points[i]);
+				bounds[1] = glm::max(bounds[1], hull.points[i]);
+			}
+		}
+		order.resize(this->segments.size());
+		for (uint32_t i = 0; i < order.size(); i++)
+			order[i] = i;
+		std::sort(order.begin(), order.end(), [&hullBounds](const uint32_t a, const uint32_t b) { return hullBounds[a][0].x < hullBounds[b][0].x; });
+
+		overlapping.assign(this->segments.size(), false);
+		bool anyOverlap = false;
+		for (std::size_t i = 0; i < order.size(); i++) {
+			const auto a = order[i];
+			for (std::size_t j = i + 1; j < order.size() && hullBounds[order[j]][0].x <= hullBounds[a][1].x; j++) {
+				const auto b = order[j];
+				// Lines never need splitting, and neither does a pair that is marked already
+				if ((!this->segments[a].isCurve || overlapping[a]) && (!this->segments[b].isCurve || overlapping[b]))
+					continue;
+				if (hullBounds[b][0].y > hullBounds[a][1].y || hullBounds[a][0].y > hullBounds[b][1].y)
+					continue;
+				if (Overlaps(hulls[a], hulls[b], epsilon)) {
+					overlapping[a] = this->segments[a].isCurve;
+					overlapping[b] = this->segments[b].isCurve;
+					anyOverlap = true;
+				}
+			}
+		}
+		if (!anyOverlap)
+			break;
+
+		this->splitSegments.clear();
+		for (std::size_t i = 0; i < this->segments.size(); i++) {
+			const auto &segment = this->segments[i];
+			if (!overlapping[i]) {
+				this->splitSegments.push_back(segment);
+				continue;
+			}
+			for (const auto &half : Split(segment.points, 0.5f)) {
+				this->splitSegments.push_back(Segment{
+					.points = half,
+					.contour = segment.contour,
+					.isCurve = !IsFlat(half),
+					.isConcave = false
+				});
+			}
+		}
+		std::swap(this->segments, this->splitSegments);
+	}
+}
+
+bool Triangulator::ClassifyCurves(const uint32_t contourCount)
+{
+	// Control polygon of every contour tells on which side of it the fill is
+	this->points.clear();
+	this->rings.assign(contourCount, {});
+	for (const auto &segment : this->segments) {
+		auto &ring = this->rings[segment.contour];
+		ring.push_back(static_cast<uint32_t>(this->points.size()));
+		this->points.push_back(segment.points[0]);
+		if (segment.isCurve) {
+			ring.push_back(static_cast<uint32_t>(this->points.size()));
+			this->points.push_back(segment.points[1]);
+		}
+	}
+	std::vector<RingNesting> nesting;
+	if (!GetRingNesting(this->points, this->rings, this->options.fillRule, nesting))
+		return false;
+	std::vector<bool> fillOnLeft(contourCount);
+	for (uint32_t i = 0; i < contourCount; i++)
+		fillOnLeft[i] = (GetSignedArea(this->points, this->rings[i]) > 0.0f) == nesting[i].isFilled;
+
+	// Concave curves bulge into the fill, their control point is inside
+	for (auto &segment : this->segments) {
+		if (!segment.isCurve)
+			continue;
+		// Fill on both sides, the contour isn't drawn and its curves are covered by the one around it
+		if (!nesting[segment.contour].isBoundary) {
+			segment.isCurve = false;
+			continue;
+		}
+		const bool controlOnLeft = Cross(segment.points[2] - segment.points[0], segment.points[1] - segment.points[0]) > 0.0f;
+		segment.isConcave = controlOnLeft == fillOnLeft[segment.contour];
+	}
+	return true;
+}
+
+}
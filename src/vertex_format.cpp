@@ -0,0 +1,53 @@
+#include "vertex_format.hpp"
+#include <cmath>
+#include <iostream>
+
+namespace {
+	constexpr float epsilon = 1e-4f;
+
+	bool ToCode(const float value, const float scale, const float min, const float max, int32_t &code)
+	{
+		const auto scaled = value * scale;
+		if (!(scaled >= min * scale - epsilon && scaled <= max * scale + epsilon))
+			return false;
+		code = static_cast<int32_t>(std::lround(scaled));
+		return true;
+	}
+}
+
+bool CompactVertex::FromVertex(const Triangulation::Vertex &vertex, CompactVertex &compact)
+{
+	int32_t x, y, u, v, sign;
+	if (!ToCode(vertex.position.x, 32767.0f, -1.0f, 1.0f, x) || !ToCode(vertex.position.y, 32767.0f, -1.0f, 1.0f, y))
+		return false;
+	if (vertex.position.z == Triangulation::CurveSign::Fringe) {
+		// The shader divides the distance by its own gradient, so only the side of the edge is kept:
+		// all fringe vertices of a geometry are the same distance away from it
+		if (vertex.uv.y != 0.0f)
+			return false;
+		u = vertex.uv.x > 0.0f ? 1 : vertex.uv.x < 0.0f ? -1 : 0;
+		v = 0;
+		sign = static_cast<int32_t>(Triangulation::CurveSign::Fringe);
+	}
+	// Codes have to be exact, an interpolated uv would change the curve
+	else if (!ToCode(vertex.uv.x, 2.0f, 0.0f, 1.0f, u) || std::abs(vertex.uv.x * 2.0f - u) > epsilon ||
+		!ToCode(vertex.uv.y, 2.0f, 0.0f, 1.0f, v) || std::abs(vertex.uv.y * 2.0f - v) > epsilon ||
+		!ToCode(vertex.position.z, 1.0f, -1.0f, 1.0f, sign) || std::abs(vertex.position.z - sign) > epsilon)
+		return false;
+
+	compact.position[0] = static_cast<int16_t>(x);
+	compact.position[1] = static_cast<int16_t>(y);
+	for (int i = 0; i < 4; i++)
+		compact.color[i] = static_cast<uint8_t>(std::lround(std::fmin(std::fmax(vertex.color[i], 0.0f), 1.0f) * 255.0f));
+	compact.curve[0] = static_cast<int8_t>(u);
+	compact.curve[1] = static_cast<int8_t>(v);
+	compact.curve[2] = static_cast<int8_t>(sign);
+	compact.curve[3] = 0;
+	return true;
+}
+
+void ReportUnconvertibleVertex(const size_t index, const Triangulation::Vertex &vertex)
+{
+	std::cerr << "Vertex " << index << " (" << vertex.position.x << ", " << vertex.position.y << ", " << vertex.position.z
+		<< "; uv " << vertex.uv.x << ", " << vertex.uv.y << ") doesn't fit into the vertex format" << std::endl;
+}
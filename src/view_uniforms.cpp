@@ -0,0 +1,133 @@
+#include "view_uniforms.hpp"
+#include "utils.hpp"
+#include <cstring>
+#include <iostream>
+
+ViewUniforms::~ViewUniforms()
+{
+	if (!this->vkDevice)
+		return;
+	if (this->buffer)
+		this->memoryAllocator->DestroyBuffer(this->buffer, this->memory);
+	if (this->vkDescriptorPool) {
+		vkDestroyDescriptorPool(this->vkDevice, this->vkDescriptorPool, nullptr);
+		this->vkDescriptorPool = VK_NULL_HANDLE;
+	}
+	if (this->vkDescriptorSetLayout) {
+		vkDestroyDescriptorSetLayout(this->vkDevice, this->vkDescriptorSetLayout, nullptr);
+		this->vkDescriptorSetLayout = VK_NULL_HANDLE;
+	}
+}
+
+bool ViewUniforms::Init(const VkDevice vkDevice, const MemoryAllocatorPtr memoryAllocator, const VkDeviceSize minUniformBufferOffsetAlignment)
+{
+	this->vkDevice = vkDevice;
+	this->memoryAllocator = memoryAllocator;
+	const auto alignment = minUniformBufferOffsetAlignment ? minUniformBufferOffsetAlignment : 1;
+	this->sliceSize = (sizeof(Data) + alignment - 1) / alignment * alignment;
+
+	const VkDescriptorSetLayoutBinding binding = {
+		.binding = 0,
+		.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+		.descriptorCount = 1,
+		.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+		.pImmutableSamplers = nullptr
+	};
+	VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.bindingCount = 1,
+		.pBindings = &binding
+	};
+	if (!CHECK_VK_RESULT(vkCreateDescriptorSetLayout(this->vkDevice, &layoutCreateInfo, nullptr, &this->vkDescriptorSetLayout))) {
+		std::cerr << "Vulkan: Failed to create view descriptor set layout" << std::endl;
+		return false;
+	}
+
+	const VkDescriptorPoolSize poolSize = {
+		.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+		.descriptorCount = 1
+	};
+	VkDescriptorPoolCreateInfo poolCreateInfo = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.maxSets = 1,
+		.poolSizeCount = 1,
+		.pPoolSizes = &poolSize
+	};
+	if (!CHECK_VK_RESULT(vkCreateDescriptorPool(this->vkDevice, &poolCreateInfo, nullptr, &this->vkDescriptorPool))) {
+		std::cerr << "Vulkan: Failed to create view descriptor pool" << std::endl;
+		return false;
+	}
+
+	VkDescriptorSetAllocateInfo allocateInfo = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+		.pNext = nullptr,
+		.descriptorPool = this->vkDescriptorPool,
+		.descriptorSetCount = 1,
+		.pSetLayouts = &this->vkDescriptorSetLayout
+	};
+	if (!CHECK_VK_RESULT(vkAllocateDescriptorSets(this->vkDevice, &allocateInfo, &this->vkDescriptorSet))) {
+		std::cerr << "Vulkan: Failed to allocate view descriptor set" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool ViewUniforms::SetFrameCount(const uint32_t frameCount)
+{
+	if (frameCount <= this->frameCount)
+		return true;
+
+	if (this->buffer)
+		this->memoryAllocator->DestroyBuffer(this->buffer, this->memory);
+	this->frameCount = 0;
+	// Coherent, so Update needs no flush
+	if (!this->memoryAllocator->CreateBuffer(this->sliceSize * frameCount, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, this->buffer, this->memory)) {
+		std::cerr << "Vulkan: Failed to create view uniform buffer" << std::endl;
+		return false;
+	}
+	this->frameCount = frameCount;
+
+	// The range covers one slice, the dynamic offset picks which
+	const VkDescriptorBufferInfo bufferInfo = {
+		.buffer = this->buffer,
+		.offset = 0,
+		.range = sizeof(Data)
+	};
+	const VkWriteDescriptorSet write = {
+		.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+		.pNext = nullptr,
+		.dstSet = this->vkDescriptorSet,
+		.dstBinding = 0,
+		.dstArrayElement = 0,
+		.descriptorCount = 1,
+		.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+		.pImageInfo = nullptr,
+		.pBufferInfo = &bufferInfo,
+		.pTexelBufferView = nullptr
+	};
+	vkUpdateDescriptorSets(this->vkDevice, 1, &write, 0, nullptr);
+
+	return true;
+}
+
+void ViewUniforms::Update(const uint32_t frameIndex, const uint32_t width, const uint32_t height)
+{
+	if (frameIndex >= this->frameCount)
+		return;
+	this->data.viewportSize = { static_cast<float>(width), static_cast<float>(height) };
+	std::memcpy(this->memory.mapped + this->sliceSize * frameIndex, &this->data, sizeof(Data));
+}
+
+void ViewUniforms::Bind(const VkCommandBuffer vkCommandBuffer, const VkPipelineLayout vkPipelineLayout, const uint32_t frameIndex) const
+{
+	if (frameIndex >= this->frameCount)
+		return;
+	const auto offset = static_cast<uint32_t>(this->sliceSize * frameIndex);
+	vkCmdBindDescriptorSets(vkCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vkPipelineLayout, 0, 1, &this->vkDescriptorSet, 1, &offset);
+}
@@ -0,0 +1,124 @@
+// Compares the batch curve evaluation (and the flattener built on it) with the scalar Evaluate
+#include "triangulation/bezier_batch.hpp"
+#include "triangulation/flattener.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace Triangulation;
+
+namespace {
+	// Relative to the size of the curve. The kernels round like Evaluate, but the compiler may still contract
+	// multiply-adds into FMA in one of them
+	constexpr float batchTolerance = 1e-6f;
+	// Forward differencing accumulates the rounding error over up to Flattener::maxSegmentCount steps
+	constexpr float forwardDifferencingTolerance = 1e-4f;
+
+	int failureCount = 0;
+
+	template <typename Curve>
+	float GetSize(const Curve &curve)
+	{
+		float size = 0.0f;
+		for (const auto &point : curve)
+			size = std::max(size, glm::length(point - curve[0]));
+		return std::max(size, 1.0f);
+	}
+
+	void Check(const char *name, const glm::vec2 &expected, const float x, const float y, const float tolerance)
+	{
+		const auto error = std::max(std::abs(expected.x - x), std::abs(expected.y - y));
+		if (error > tolerance) {
+			if (failureCount++ < 16)
+				std::cerr << name << ": expected (" << expected.x << ", " << expected.y << "), got (" << x << ", " << y << ")" << std::endl;
+		}
+	}
+
+	template <typename Curve>
+	Curve RandomCurve(std::mt19937 &random)
+	{
+		std::uniform_real_distribution<float> coordinate(-1000.0f, 1000.0f);
+		Curve curve;
+		for (auto &point : curve)
+			point = { coordinate(random), coordinate(random) };
+		return curve;
+	}
+
+	template <typename Curve>
+	void TestCurve(const Curve &curve, std::mt19937 &random)
+	{
+		const auto tolerance = GetSize(curve) * batchTolerance;
+
+		// Odd counts, so the scalar tail is covered too
+		std::uniform_real_distribution<float> parameter(0.0f, 1.0f);
+		std::vector<float> t(37), x(t.size()), y(t.size());
+		for (auto &value : t)
+			value = parameter(random);
+		if (EvaluateBatch(curve, t, x, y) != t.size())
+			failureCount++;
+		for (std::size_t i = 0; i < t.size(); i++)
+			Check("EvaluateBatch", Evaluate(curve, t[i]), x[i], y[i], tolerance);
+
+		for (const std::size_t count : { 1, 3, 8, 13, 64, 1023 }) {
+			x.assign(count, 0.0f);
+			y.assign(count, 0.0f);
+			if (EvaluateSteps(curve, x, y) != count)
+				failureCount++;
+			for (std::size_t i = 0; i + 1 < count; i++)
+				Check("EvaluateSteps", Evaluate(curve, static_cast<float>(i + 1) / static_cast<float>(count)), x[i], y[i], tolerance);
+			Check("EvaluateSteps end point", curve.back(), x[count - 1], y[count - 1], 0.0f);
+		}
+
+		// Both flattener outputs have the same segments
+		for (const float pixelTolerance : { 0.25f, 0.001f }) {
+			const Flattener flattener(glm::mat3(1.0f), pixelTolerance);
+			const auto count = flattener.GetSegmentCount(curve);
+			std::vector<glm::vec2> points(count);
+			x.assign(count, 0.0f);
+			y.assign(count, 0.0f);
+			if (flattener.Flatten(curve, points) != count || flattener.Flatten(curve, x, y) != count)
+				failureCount++;
+			for (std::size_t i = 0; i < count; i++)
+				Check("Flattener", points[i], x[i], y[i], GetSize(curve) * forwardDifferencingTolerance);
+		}
+	}
+
+	template <typename Curve>
+	void TestCurves(const std::vector<Curve> &curves, const float t)
+	{
+		std::vector<float> x(curves.size()), y(curves.size());
+		if (EvaluateBatch(std::span(curves), t, x, y) != curves.size())
+			failureCount++;
+		for (std::size_t i = 0; i < curves.size(); i++)
+			Check("EvaluateBatch of curves", Evaluate(curves[i], t), x[i], y[i], GetSize(curves[i]) * batchTolerance);
+	}
+}
+
+int main()
+{
+	std::cout << "Batch instruction set: " << GetBatchInstructionSet() << std::endl;
+
+	std::mt19937 random(1);
+	std::vector<QuadraticBezier> quadratics;
+	std::vector<CubicBezier> cubics;
+	for (int i = 0; i < 101; i++) {
+		quadratics.push_back(RandomCurve<QuadraticBezier>(random));
+		cubics.push_back(RandomCurve<CubicBezier>(random));
+		TestCurve(quadratics.back(), random);
+		TestCurve(cubics.back(), random);
+	}
+	for (const float t : { 0.0f, 0.3f, 0.5f, 1.0f }) {
+		TestCurves(quadratics, t);
+		TestCurves(cubics, t);
+	}
+
+	if (failureCount) {
+		std::cerr << failureCount << " checks failed" << std::endl;
+		return 1;
+	}
+	std::cout << "All checks passed" << std::endl;
+	return 0;
+}
@@ -0,0 +1,213 @@
+// Triangulates simple outlines in every mode and compares the filled area with the exact one
+#include "triangulation/triangulator.hpp"
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <numbers>
+#include <vector>
+
+using namespace Triangulation;
+
+namespace {
+	// Relative to the exact area. Flattening cuts off up to the tolerance along every curve
+	constexpr float polygonTolerance = 1e-5f;
+	constexpr float curveTolerance = 1e-2f;
+
+	int failureCount = 0;
+
+	void Check(const char *name, const bool condition)
+	{
+		if (!condition) {
+			if (failureCount++ < 16)
+				std::cerr << name << ": failed" << std::endl;
+		}
+	}
+
+	void Check(const char *name, const float expected, const float value, const float tolerance)
+	{
+		if (std::abs(expected - value) > tolerance) {
+			if (failureCount++ < 16)
+				std::cerr << name << ": expected " << expected << ", got " << value << std::endl;
+		}
+	}
+
+	// Area covered by the triangles of one kind, counted negative for clockwise ones
+	float GetArea(const Geometry &geometry, const float sign)
+	{
+		float area = 0.0f;
+		for (std::size_t i = 0; i + 2 < geometry.indices.size(); i += 3) {
+			const auto &a = geometry.vertices[geometry.indices[i]].position;
+			const auto &b = geometry.vertices[geometry.indices[i + 1]].position;
+			const auto &c = geometry.vertices[geometry.indices[i + 2]].position;
+			if (a.z != sign || b.z != sign || c.z != sign)
+				continue;
+			area += ((b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y)) * 0.5f;
+		}
+		return area;
+	}
+
+	void AddSquare(Outline &outline, const glm::vec2 &min, const glm::vec2 &max, const bool counterClockwise)
+	{
+		outline.MoveTo(min);
+		if (counterClockwise) {
+			outline.LineTo({ max.x, min.y });
+			outline.LineTo(max);
+			outline.LineTo({ min.x, max.y });
+		}
+		else {
+			outline.LineTo({ min.x, max.y });
+			outline.LineTo(max);
+			outline.LineTo({ max.x, min.y });
+		}
+		outline.Close();
+	}
+
+	float Cross(const glm::vec2 &a, const glm::vec2 &b)
+	{
+		return a.x * b.y - a.y * b.x;
+	}
+
+	// Exact area enclosed by a contour of quadratics: the polygon of their end points plus two thirds of every control triangle
+	float GetOutlineArea(const Outline &outline)
+	{
+		float area = 0.0f;
+		for (const auto &contour : outline.GetContours()) {
+			const auto &points = contour.GetPoints();
+			for (std::size_t i = 1; i + 1 < points.size(); i += 2) {
+				area += Cross(points[i - 1], points[i + 1]) * 0.5f;
+				area += Cross(points[i] - points[i - 1], points[i + 1] - points[i - 1]) / 3.0f;
+			}
+			area += Cross(points.back(), points.front()) * 0.5f;
+		}
+		return area;
+	}
+
+	// Quadratics through points computed with sin and cos, so the end doesn't land exactly on the start
+	Outline MakeCircle(const float radius, const uint32_t quadCount)
+	{
+		const auto step = 2.0f * std::numbers::pi_v<float> / static_cast<float>(quadCount);
+		const auto controlRadius = radius / std::cos(step * 0.5f);
+		Outline outline;
+		outline.MoveTo({ radius, 0.0f });
+		for (uint32_t i = 0; i < quadCount; i++) {
+			const auto angle = step * static_cast<float>(i);
+			outline.QuadTo(glm::vec2(std::cos(angle + step * 0.5f), std::sin(angle + step * 0.5f)) * controlRadius,
+				glm::vec2(std::cos(angle + step), std::sin(angle + step)) * radius);
+		}
+		outline.Close();
+		return outline;
+	}
+
+	// Returns the solid area
+	float Triangulate(const Outline &outline, const Triangulator::Options &options, const char *name, Geometry &geometry)
+	{
+		Triangulator triangulator(options);
+		const bool isTriangulated = triangulator.Triangulate(outline, geometry);
+		Check(name, isTriangulated);
+		return GetArea(geometry, CurveSign::Solid);
+	}
+	float Triangulate(const Outline &outline, const Triangulator::Options &options, const char *name)
+	{
+		Geometry geometry;
+		return Triangulate(outline, options, name, geometry);
+	}
+
+	void TestCircle()
+	{
+		constexpr float radius = 100.0f;
+		for (const uint32_t quadCount : { 4, 8, 13 }) {
+			const auto circle = MakeCircle(radius, quadCount);
+			const auto area = GetOutlineArea(circle);
+
+			Triangulator::Options options;
+			Check("Flattened circle", area, Triangulate(circle, options, "Flattened circle"), area * curveTolerance);
+
+			// The solid part ends half the fringe inside the edge
+			options.fringeWidth = 2.0f;
+			const auto insetArea = area * (radius - 1.0f) * (radius - 1.0f) / (radius * radius);
+			Check("Flattened circle with fringe", insetArea, Triangulate(circle, options, "Flattened circle with fringe"), insetArea * curveTolerance);
+
+			// Only the interior polygon is solid there, the curve triangles fill the rest.
+			// The shader antialiases them, there's no straight edge for a fringe
+			options.mode = Triangulator::Mode::Curves;
+			Geometry geometry;
+			Check("Circle of curves", Triangulate(circle, options, "Circle of curves", geometry) > 0.0f);
+			Check("Circle of curves has no fringe", GetArea(geometry, CurveSign::Fringe) == 0.0f);
+		}
+	}
+
+	void TestSquareWithHole()
+	{
+		for (const auto fillRule : { Triangulator::FillRule::EvenOdd, Triangulator::FillRule::NonZero }) {
+			Outline outline;
+			AddSquare(outline, { 0.0f, 0.0f }, { 100.0f, 100.0f }, true);
+			AddSquare(outline, { 25.0f, 25.0f }, { 75.0f, 75.0f }, false);
+			for (const auto mode : { Triangulator::Mode::Flatten, Triangulator::Mode::Curves }) {
+				const Triangulator::Options options = { .mode = mode, .fillRule = fillRule };
+				Check("Square with hole", 7500.0f, Triangulate(outline, options, "Square with hole"), 7500.0f * polygonTolerance);
+			}
+		}
+	}
+
+	void TestFringes()
+	{
+		Outline outline;
+		AddSquare(outline, { 0.0f, 0.0f }, { 100.0f, 100.0f }, true);
+		Triangulator::Options options = { .fringeWidth = 2.0f };
+
+		// Half of the fringe inside the edge, half outside
+		Geometry geometry;
+		Check("Flattened square with fringe", 98.0f * 98.0f, Triangulate(outline, options, "Flattened square with fringe", geometry), 10000.0f * polygonTolerance);
+		Check("Fringe of flattened square", 102.0f * 102.0f - 98.0f * 98.0f, GetArea(geometry, CurveSign::Fringe), 10000.0f * polygonTolerance);
+
+		// The interior keeps its size, the curve triangles share its points
+		options.mode = Triangulator::Mode::Curves;
+		geometry.Clear();
+		Check("Square of curves with fringe", 10000.0f, Triangulate(outline, options, "Square of curves with fringe", geometry), 10000.0f * polygonTolerance);
+		Check("Fringe of square of curves", 102.0f * 102.0f - 10000.0f, GetArea(geometry, CurveSign::Fringe), 10000.0f * polygonTolerance);
+
+		// Only the line of a half disc gets a fringe, ending square at the curve
+		Outline halfDisc;
+		halfDisc.MoveTo({ -50.0f, 0.0f });
+		halfDisc.LineTo({ 50.0f, 0.0f });
+		halfDisc.QuadTo({ 50.0f, 50.0f }, { 0.0f, 50.0f });
+		halfDisc.QuadTo({ -50.0f, 50.0f }, { -50.0f, 0.0f });
+		geometry.Clear();
+		Triangulate(halfDisc, options, "Half disc of curves with fringe", geometry);
+		Check("Fringe of half disc of curves", 100.0f, GetArea(geometry, CurveSign::Fringe), 10000.0f * polygonTolerance);
+	}
+
+	void TestFillRules()
+	{
+		// Both squares counter-clockwise, the inner one is a hole only for even-odd
+		Outline outline;
+		AddSquare(outline, { 0.0f, 0.0f }, { 100.0f, 100.0f }, true);
+		AddSquare(outline, { 25.0f, 25.0f }, { 75.0f, 75.0f }, true);
+		const Triangulator::Options evenOdd = { .fillRule = Triangulator::FillRule::EvenOdd };
+		Check("Even-odd fill", 7500.0f, Triangulate(outline, evenOdd, "Even-odd fill"), 7500.0f * polygonTolerance);
+		const Triangulator::Options nonZero = { .fillRule = Triangulator::FillRule::NonZero };
+		Check("Nonzero fill", 10000.0f, Triangulate(outline, nonZero, "Nonzero fill"), 10000.0f * polygonTolerance);
+
+		// Overlapping squares of the same direction, which the fill rules may not cross
+		Outline crossing;
+		AddSquare(crossing, { 0.0f, 0.0f }, { 100.0f, 100.0f }, true);
+		AddSquare(crossing, { 50.0f, 50.0f }, { 150.0f, 150.0f }, true);
+		Geometry geometry;
+		Check("Crossing contours are rejected", !Triangulator(nonZero).Triangulate(crossing, geometry) && geometry.indices.empty());
+	}
+}
+
+int main()
+{
+	TestCircle();
+	TestSquareWithHole();
+	TestFringes();
+	TestFillRules();
+
+	if (failureCount) {
+		std::cerr << failureCount << " checks failed" << std::endl;
+		return 1;
+	}
+	std::cout << "All checks passed" << std::endl;
+	return 0;
+}